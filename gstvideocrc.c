@@ -13,6 +13,128 @@
  * The default polynomial used is 0X04c11db7U but it can be changed before processing using crc-mask property.
  * CRC values can be saved to file by the location property
  * CRC values can also be printed on terminal using --gst-debug=videocrc:4
+ * When the frames go nowhere after hashing, videocrcsink logs the same CRCs
+ * without transform semantics and gives buffers back as soon as they are
+ * hashed.
+ *
+ * <refsect2>
+ * <title>Hashing</title>
+ * The CRC kernels and plane walks live in libvideocrc (videocrc.h), which
+ * videocrc-file uses to produce the same logs from raw YUV or Y4M files.
+ * On AArch64 the CRC uses PMULL folding, or the CRC32 instructions for the
+ * crc32 and crc32c algorithms, when the CPU reports them in HWCAP. Large
+ * planes can be split in bands hashed by worker threads; with autotune the
+ * first frames of a stream pick the engine, thread count and chunk size,
+ * and the choice is cached for later pipelines and reported in stats.
+ * algorithm=fingerprint logs a perceptual hash of the luma instead
+ * ("VideoFrame N fingerprint HEX"), which survives re-encoding, so frames
+ * of a transcoding ladder can be matched.
+ * The element only reads frames and runs in passthrough, so a buffer that
+ * is not writable is never copied. Past the first frame nothing is
+ * allocated per frame except messages and debug output; videocrc-bench
+ * prints what the bookkeeping costs and counts allocations with -a.
+ * enabled, algorithm, crc-mask, the roi-* rectangle and sample-interval can
+ * be changed while PLAYING; they take effect from the next frame. A disabled
+ * element only counts frames, and the hash-frames action signal hashes the
+ * next N frames whatever the settings, e.g. to spot-check a live pipeline.
+ * </refsect2>
+ * <refsect2>
+ * <title>Statistics and monitoring</title>
+ * Per-frame timing of the map, hash and log phases is available through the
+ * read-only stats property, or by sending a custom query whose structure is
+ * named "videocrc-stats" to the element, along with hardware counters when
+ * perf-counters is enabled. USDT probes (provider videocrc) mark the same
+ * phases, see gstvideocrcprobes.h. Records can also be published in shared
+ * memory for videocrc-shm-reader (shm-name) or sent to videocrc-collector
+ * (socket-path); neither ever waits on the reader.
+ * </refsect2>
+ * <refsect2>
+ * <title>QoS</title>
+ * With qos (on by default), lateness reported in downstream QoS events, or a
+ * frame cost above cpu-budget, makes the element hash only one frame in
+ * qos-sample-interval and then none at all rather than delay the stream.
+ * Frames that are not hashed are logged as "VideoFrame N skipped". Full
+ * hashing resumes once the load has stayed low for a while.
+ * </refsect2>
+ * <refsect2>
+ * <title>Verification and detection</title>
+ * With reference set to a log of an earlier run each frame is verified:
+ * CRCs must be equal, fingerprints at most max-distance bits apart.
+ * Mismatches are marked in the log and posted as "videocrc-mismatch"
+ * element messages. detect=true judges every hashed frame without reading
+ * it again and flags duplicate, frozen and black frames on the log line;
+ * every alarm that is raised or cleared is posted as a "videocrc-alarm"
+ * element message.
+ * </refsect2>
+ * <refsect2>
+ * <title>Reference store</title>
+ * reference-store instead names a store of the CRCs of many streams, mapped
+ * read-only so all the elements of a host share one copy in the page cache.
+ * The CRCs of the first frames identify the stream, which is logged as
+ * "reference NAME frames N" and posted as a "videocrc-reference" element
+ * message, and the frames are verified against it from there on. A stream
+ * that is not in the store, or whose first frames were not all hashed, is
+ * not verified.
+ * </refsect2>
+ * <refsect2>
+ * <title>History and digests</title>
+ * digests adds more digests to the end of each crc line, computed in the
+ * same pass so the frame is read from memory once. hash-chain=true makes
+ * the log tamper-evident: every frame is chained into a SHA-256 that is
+ * logged as "VideoFrame N chain HEX", and at EOS the SHA-256 of all records
+ * is logged as "chain sha256 HEX frames N" and posted as a "videocrc-chain"
+ * element message. Re-running the same recording reproduces the values.
+ * The last history-size hashed frames are kept in memory; the get-history
+ * action signal returns those in a PTS range as packed
+ * GstVideocrcHistoryRecord, so recent CRCs can be fetched after the fact
+ * without a log file.
+ * </refsect2>
+ * <refsect2>
+ * <title>Indexes</title>
+ * merkle-index=FILE writes a Merkle tree over the frames next to the log:
+ * every frame's hash-chain record, less its PTS, is a leaf. Frames left out
+ * by sampling or QoS are leaves too, so leaf N is frame N of the log. At
+ * EOS the root is logged as "merkle root HEX frames N".
+ * videocrc-merkle-diff compares two indexes top-down and finds the first
+ * frame where two multi-hour recordings differ in a few dozen node reads.
+ * </refsect2>
+ * <refsect2>
+ * <title>Encoded streams and buffer lists</title>
+ * encoded-granularity=nal splits H.264/H.265 byte-streams and AV1 OBU
+ * streams into NAL units or OBUs and logs each as "VideoFrame N unit I type
+ * T size S crc X" before the buffer's line, so bitstream differences can
+ * be localised.
+ * Buffer lists, as pushed by RTP depayloaders, are handled in one call
+ * while the element is in passthrough: their lines are collected, up to
+ * 4 KiB, and written to the log at the end of the list, and the list goes
+ * downstream as a whole. A buffer whose transform fails ends the list there.
+ * </refsect2>
+ * <refsect2>
+ * <title>Subframes and multiview</title>
+ * subframes=true is for low-latency decoders and sources that push a frame
+ * in parts (slices), the last flagged GST_VIDEO_BUFFER_FLAG_MARKER. Each
+ * part continues the running CRC as it arrives and the frame's crc line is
+ * logged with the last part, so hashing overlaps decoding. Sampling and QoS
+ * decide per frame; ROI, fingerprints, detection and plane digests do not
+ * apply.
+ * With multiview-mode side-by-side or top-bottom caps, the crc line of a
+ * buffer mapped whole also carries a CRC per view, "views LEFT RIGHT" (top
+ * and bottom), in storage order, from the same walk over the rows. A view's
+ * CRC is what the element logs for the view split off into a buffer whose
+ * rows have no padding. With frame-by-frame caps every buffer is a view and
+ * the line says "view N", counted from the buffer flagged FIRST_IN_BUNDLE.
+ * </refsect2>
+ * <refsect2>
+ * <title>Latency</title>
+ * Two elements with the same latency-group measure the latency between
+ * them, through encoders, queues or a network loopback, without marking
+ * the video: the upstream tap notes the CLOCK_MONOTONIC time each frame
+ * arrived under its digest, and the downstream one looks its frames up.
+ * Matched frames get "latency Nus" on their line, stats get the count,
+ * minimum, mean, maximum and a histogram in powers of two of microseconds,
+ * and at EOS the summary is logged and posted as a "videocrc-latency"
+ * element message.
+ * </refsect2>
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -26,22 +148,55 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "gstvideocrc.h"
+#include "gstvideocrcprobes.h"
+#include "gstvideocrcsink.h"
 #ifdef QCOM_HARDWARE
 #include "../../gst-libs/gst/ionbuf/gstionbuf_meta.h"
 #endif
 
-#define WIDTH  (8 * sizeof(gint))
-#define TOPBIT (1 << (WIDTH - 1))
-#define ALIGN4K 4096
-#define ALIGN128 128
-#define ALIGN32 32
-#define ALIGN16 16
-#define ALIGN( num, to ) (((num) + (to-1)) & (~(to-1)))
-
 #define GST_VIDEO_DEFAULT_CRC_MASK 0x04C11DB7L
 
+#define GST_VIDEOCRC_STATS_NAME "videocrc-stats"
+
+#define DEFAULT_SOCKET_BATCH 32
+#define DEFAULT_AUTOTUNE TRUE
+#define DEFAULT_N_THREADS 0
+#define DEFAULT_CPU_BUDGET 0
+#define DEFAULT_QOS_INTERVAL 4
+#define DEFAULT_ENABLED TRUE
+#define DEFAULT_ALGORITHM GST_VIDEOCRC_ALGORITHM_LEGACY
+#define DEFAULT_SAMPLE_INTERVAL 1
+#define DEFAULT_FINGERPRINT_BITS 64
+#define DEFAULT_MAX_DISTANCE 0
+#define DEFAULT_DETECT FALSE
+#define DEFAULT_BLACK_LEVEL 24
+#define DEFAULT_FROZEN_FRAMES 25
+#define DEFAULT_HISTORY_SIZE 1024
+#define DEFAULT_GRANULARITY GST_VIDEOCRC_GRANULARITY_BUFFER
+#define DEFAULT_EXCLUDE 0
+#define DEFAULT_DIGESTS 0
+#define DEFAULT_HASH_CHAIN FALSE
+#define DEFAULT_CHAIN_INTERVAL 100
+#define DEFAULT_SUBFRAMES FALSE
+#define DEFAULT_LATENCY_TAP GST_VIDEOCRC_LATENCY_TAP_NONE
+#define GST_VIDEOCRC_SOCKET_RETRY (1 * GST_SECOND)
+
+/* flat buffers are cut in this many rows to spread them over threads */
+#define GST_VIDEOCRC_FLAT_ROWS 64
+
+/* frames the load has to stay low before hashing one level more */
+#define GST_VIDEOCRC_QOS_HOLD 60
+
 #define GST_CAT_DEFAULT gst_videocrc_debug
 
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -60,9 +215,51 @@ enum
 {
   PROP_0,
   PROP_LOCATION,
-  PROP_CRC_MASK
+  PROP_CRC_MASK,
+  PROP_STATS,
+  PROP_PERF_COUNTERS,
+  PROP_SHM_NAME,
+  PROP_SOCKET_PATH,
+  PROP_SOCKET_BATCH,
+  PROP_AUTOTUNE,
+  PROP_N_THREADS,
+  PROP_CPU_BUDGET,
+  PROP_QOS_INTERVAL,
+  PROP_ENABLED,
+  PROP_ALGORITHM,
+  PROP_ROI_X,
+  PROP_ROI_Y,
+  PROP_ROI_WIDTH,
+  PROP_ROI_HEIGHT,
+  PROP_SAMPLE_INTERVAL,
+  PROP_FINGERPRINT_BITS,
+  PROP_REFERENCE,
+  PROP_REFERENCE_STORE,
+  PROP_MAX_DISTANCE,
+  PROP_DETECT,
+  PROP_BLACK_LEVEL,
+  PROP_FROZEN_FRAMES,
+  PROP_HISTORY_SIZE,
+  PROP_ENCODED_GRANULARITY,
+  PROP_ENCODED_EXCLUDE,
+  PROP_DIGESTS,
+  PROP_HASH_CHAIN,
+  PROP_HASH_CHAIN_INTERVAL,
+  PROP_SUBFRAMES,
+  PROP_LATENCY_GROUP,
+  PROP_LATENCY_TAP,
+  PROP_MERKLE_INDEX
+};
+
+enum
+{
+  SIGNAL_HASH_FRAMES,
+  SIGNAL_GET_HISTORY,
+  LAST_SIGNAL
 };
 
+static guint gst_videocrc_signals[LAST_SIGNAL] = { 0 };
+
 #define parent_class gst_videocrc_parent_class
 G_DEFINE_TYPE (GstVideocrc, gst_videocrc, GST_TYPE_VIDEO_FILTER);
 
@@ -73,7 +270,7 @@ static void gst_videocrc_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static GstFlowReturn gst_videocrc_transform_frame_ip (GstBaseTransform * trans,
         GstBuffer * buf);
-static void gst_videocrc_init_crc32bit_table (GstVideocrc * videocrc);
+static void gst_videocrc_init_crc_kernel (GstVideocrc * videocrc);
 static gboolean gst_videocrc_set_info (GstVideoFilter * filter, GstCaps * incaps,
             GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info);
 static gboolean
@@ -82,6 +279,132 @@ static gboolean
 gst_videocrc_stop (GstBaseTransform * trans);
 static gboolean
 gst_videocrc_set_location (GstVideocrc * videocrc, const gchar * location);
+static gboolean
+gst_videocrc_query (GstBaseTransform * trans, GstPadDirection direction,
+    GstQuery * query);
+static void
+gst_videocrc_fill_stats (GstVideocrc * videocrc, GstStructure * s);
+static void
+gst_videocrc_log_flush (GstVideocrc * videocrc);
+static void
+gst_videocrc_log_line (GstVideocrc * videocrc, const gchar * format, ...)
+    G_GNUC_PRINTF (2, 3);
+static gboolean
+gst_videocrc_hashes_flat (GstVideocrc * videocrc,
+    const GstVideocrcConfig * config);
+static gboolean
+gst_videocrc_sink_event (GstBaseTransform * trans, GstEvent * event);
+static gboolean
+gst_videocrc_src_event (GstBaseTransform * trans, GstEvent * event);
+static void
+gst_videocrc_hash_frames (GstVideocrc * videocrc, guint n_frames);
+static GBytes *gst_videocrc_get_history (GstVideocrc * videocrc,
+    guint64 start, guint64 stop);
+static GstFlowReturn gst_videocrc_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
+
+GType
+gst_videocrc_algorithm_get_type (void)
+{
+  static gsize algorithm_type = 0;
+  static const GEnumValue algorithms[] = {
+    {GST_VIDEOCRC_ALGORITHM_LEGACY,
+        "MSB-first CRC with crc-mask and initial value 0", "legacy"},
+    {GST_VIDEOCRC_ALGORITHM_CRC32, "CRC-32 (IEEE 802.3)", "crc32"},
+    {GST_VIDEOCRC_ALGORITHM_CRC32C, "CRC-32C (Castagnoli)", "crc32c"},
+    {GST_VIDEOCRC_ALGORITHM_FINGERPRINT,
+        "Perceptual fingerprint of the luma plane", "fingerprint"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&algorithm_type)) {
+    GType type = g_enum_register_static ("GstVideocrcAlgorithm", algorithms);
+
+    g_once_init_leave (&algorithm_type, type);
+  }
+
+  return (GType) algorithm_type;
+}
+
+GType
+gst_videocrc_granularity_get_type (void)
+{
+  static gsize granularity_type = 0;
+  static const GEnumValue granularities[] = {
+    {GST_VIDEOCRC_GRANULARITY_BUFFER, "One CRC per buffer", "buffer"},
+    {GST_VIDEOCRC_GRANULARITY_NAL, "One CRC per NAL unit or OBU", "nal"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&granularity_type)) {
+    GType type = g_enum_register_static ("GstVideocrcGranularity",
+        granularities);
+
+    g_once_init_leave (&granularity_type, type);
+  }
+
+  return (GType) granularity_type;
+}
+
+GType
+gst_videocrc_exclude_get_type (void)
+{
+  static gsize exclude_type = 0;
+  static const GFlagsValue excludes[] = {
+    {GST_VIDEOCRC_EXCLUDE_SEI, "SEI and AV1 metadata", "sei"},
+    {GST_VIDEOCRC_EXCLUDE_AUD, "Access unit and temporal delimiters", "aud"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&exclude_type)) {
+    GType type = g_flags_register_static ("GstVideocrcExclude", excludes);
+
+    g_once_init_leave (&exclude_type, type);
+  }
+
+  return (GType) exclude_type;
+}
+
+GType
+gst_videocrc_digest_get_type (void)
+{
+  static gsize digest_type = 0;
+  static const GFlagsValue digests[] = {
+    {GST_VIDEOCRC_DIGEST_PLANES, "CRC of every plane alone", "planes"},
+    {GST_VIDEOCRC_DIGEST_CRC64, "CRC-64/XZ", "crc64"},
+    {GST_VIDEOCRC_DIGEST_XXH3, "XXH3 64-bit", "xxh3"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&digest_type)) {
+    GType type = g_flags_register_static ("GstVideocrcDigest", digests);
+
+    g_once_init_leave (&digest_type, type);
+  }
+
+  return (GType) digest_type;
+}
+
+GType
+gst_videocrc_latency_tap_get_type (void)
+{
+  static gsize latency_tap_type = 0;
+  static const GEnumValue taps[] = {
+    {GST_VIDEOCRC_LATENCY_TAP_NONE, "No latency measurement", "none"},
+    {GST_VIDEOCRC_LATENCY_TAP_UPSTREAM, "Note when frames pass", "upstream"},
+    {GST_VIDEOCRC_LATENCY_TAP_DOWNSTREAM, "Report the latency of frames "
+          "the upstream tap saw", "downstream"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&latency_tap_type)) {
+    GType type = g_enum_register_static ("GstVideocrcLatencyTap", taps);
+
+    g_once_init_leave (&latency_tap_type, type);
+  }
+
+  return (GType) latency_tap_type;
+}
 
 
 static void
@@ -109,7 +432,276 @@ gst_videocrc_class_init (GstVideocrcClass * klass)
   g_object_class_install_property (gobject_class, PROP_CRC_MASK,
       g_param_spec_uint ("crc-mask", "CRC polynomial",
           "CRC computation will use CRC polynomial set by application",
-          0, G_MAXUINT, GST_VIDEO_DEFAULT_CRC_MASK, G_PARAM_READWRITE));
+          0, G_MAXUINT, GST_VIDEO_DEFAULT_CRC_MASK, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Frame count, bytes hashed, per-frame time (mean, p50, p99, max in "
+          "ns), per-phase mean time and CRC throughput in GB/s",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PERF_COUNTERS,
+      g_param_spec_boolean ("perf-counters", "Performance counters",
+          "Sample per-thread hardware counters (cycles, instructions, LLC "
+          "and dTLB misses) around the CRC computation and report per-frame "
+          "averages in stats, where the kernel allows perf events; frames "
+          "hashed by several threads are only counted as partial",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_SHM_NAME,
+      g_param_spec_string ("shm-name", "Shared memory name",
+          "POSIX shared memory object to publish recent CRC records and "
+          "statistics in, read without locking (layout in videocrc-shm.h); "
+          "created by the element and refused if another process already "
+          "publishes there (NULL = disabled)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_SOCKET_PATH,
+      g_param_spec_string ("socket-path", "Collector socket",
+          "Unix SOCK_SEQPACKET socket of a CRC record collector; batches it "
+          "can't take are dropped and counted, never waited on "
+          "(NULL = disabled)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_SOCKET_BATCH,
+      g_param_spec_uint ("socket-batch", "Collector batch",
+          "Number of CRC records sent to the collector per packet",
+          1, VIDEOCRC_SOCK_MAX_BATCH, DEFAULT_SOCKET_BATCH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_AUTOTUNE,
+      g_param_spec_boolean ("autotune", "Autotune",
+          "Calibrate CRC engine, thread count and chunk size on the first "
+          "frames and cache the result per CPU model, format, resolution "
+          "class and memory type in the user cache directory",
+          DEFAULT_AUTOTUNE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Threads hashing each frame (0 = tuned with autotune, else 1)",
+          0, GST_VIDEOCRC_MAX_THREADS, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_CPU_BUDGET,
+      g_param_spec_uint64 ("cpu-budget", "CPU budget",
+          "Per-frame processing time in ns above which hashing is sampled "
+          "or skipped (0 = unlimited)", 0, G_MAXUINT64, DEFAULT_CPU_BUDGET,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_QOS_INTERVAL,
+      g_param_spec_uint ("qos-sample-interval", "QoS sample interval",
+          "Hash one frame in this many when degraded by QoS or cpu-budget",
+          2, G_MAXUINT, DEFAULT_QOS_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_ENABLED,
+      g_param_spec_boolean ("enabled", "Enabled",
+          "Hash frames; when disabled frames are only counted",
+          DEFAULT_ENABLED, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_ALGORITHM,
+      g_param_spec_enum ("algorithm", "Algorithm",
+          "CRC algorithm, legacy uses crc-mask", GST_TYPE_VIDEOCRC_ALGORITHM,
+          DEFAULT_ALGORITHM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_ROI_X,
+      g_param_spec_uint ("roi-x", "ROI x",
+          "Left edge of the hashed rectangle in luma pixels", 0, G_MAXUINT,
+          0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_ROI_Y,
+      g_param_spec_uint ("roi-y", "ROI y",
+          "Top edge of the hashed rectangle in luma rows", 0, G_MAXUINT,
+          0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_ROI_WIDTH,
+      g_param_spec_uint ("roi-width", "ROI width",
+          "Width of the hashed rectangle (0 = to the right edge)", 0,
+          G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_ROI_HEIGHT,
+      g_param_spec_uint ("roi-height", "ROI height",
+          "Height of the hashed rectangle (0 = to the bottom edge)", 0,
+          G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_SAMPLE_INTERVAL,
+      g_param_spec_uint ("sample-interval", "Sample interval",
+          "Hash one frame in this many", 1, G_MAXUINT,
+          DEFAULT_SAMPLE_INTERVAL, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_FINGERPRINT_BITS,
+      g_param_spec_uint ("fingerprint-bits", "Fingerprint bits",
+          "Size of the perceptual fingerprint, 64 or 256: one bit per "
+          "low-frequency DCT coefficient of the luma box-downscaled to "
+          "32x32, against their median", 64, 256,
+          DEFAULT_FINGERPRINT_BITS, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_REFERENCE,
+      g_param_spec_string ("reference", "Reference log",
+          "CRC or fingerprint log of an earlier run to verify frames "
+          "against (NULL = no verification)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_REFERENCE_STORE,
+      g_param_spec_string ("reference-store", "Reference store",
+          "Store of many streams' CRCs, built by videocrc-store-build, to "
+          "find the reference in by the first frames, when reference is not "
+          "set (NULL = none)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_DISTANCE,
+      g_param_spec_uint ("max-distance", "Maximum distance",
+          "Fingerprint bits that may differ from the reference "
+          "(0 = one bit in eight)", 0, VIDEOCRC_FINGERPRINT_MAX_BITS,
+          DEFAULT_MAX_DISTANCE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_DETECT,
+      g_param_spec_boolean ("detect", "Detect",
+          "Raise black-frame, frozen-video and duplicate-frame alarms from "
+          "the CRC and the luma sums gathered while hashing (not with the "
+          "fingerprint algorithm)",
+          DEFAULT_DETECT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_BLACK_LEVEL,
+      g_param_spec_uint ("black-level", "Black level",
+          "Mean luma at or below which a flat frame is black", 0, 255,
+          DEFAULT_BLACK_LEVEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_FROZEN_FRAMES,
+      g_param_spec_uint ("frozen-frames", "Frozen frames",
+          "Identical frames in a row that make the video frozen (0 = never)",
+          0, G_MAXUINT, DEFAULT_FROZEN_FRAMES, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_HISTORY_SIZE,
+      g_param_spec_uint ("history-size", "History size",
+          "Hashed frames kept for the get-history signal (0 = none)",
+          0, 1 << 20, DEFAULT_HISTORY_SIZE, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_ENCODED_GRANULARITY,
+      g_param_spec_enum ("encoded-granularity", "Encoded granularity",
+          "Hash H.264, H.265 and AV1 streams per buffer or per unit",
+          GST_TYPE_VIDEOCRC_GRANULARITY, DEFAULT_GRANULARITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_ENCODED_EXCLUDE,
+      g_param_spec_flags ("encoded-exclude", "Encoded exclude",
+          "Units logged but left out of the buffer CRC with "
+          "encoded-granularity=nal",
+          GST_TYPE_VIDEOCRC_EXCLUDE, DEFAULT_EXCLUDE, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_DIGESTS,
+      g_param_spec_flags ("digests", "Digests",
+          "Digests logged after the CRC, computed in the same pass over the "
+          "frame; planes gives the CRC of every plane alone, crc64 "
+          "(CRC-64/XZ) and xxh3 cover the bytes the CRC reads, rows as "
+          "stored, and hash on the streaming thread only",
+          GST_TYPE_VIDEOCRC_DIGEST, DEFAULT_DIGESTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_HASH_CHAIN,
+      g_param_spec_boolean ("hash-chain", "Hash chain",
+          "Chain every frame's number, PTS, CRC and digests, one 64-byte "
+          "SHA-256 block, into a value that is logged periodically and "
+          "finalized at EOS", DEFAULT_HASH_CHAIN, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_HASH_CHAIN_INTERVAL,
+      g_param_spec_uint ("hash-chain-interval", "Hash chain interval",
+          "Frames between chain values in the log", 1, G_MAXUINT,
+          DEFAULT_CHAIN_INTERVAL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_SUBFRAMES,
+      g_param_spec_boolean ("subframes", "Sub-frames",
+          "Buffers are parts of frames, the last one flagged MARKER; parts "
+          "are hashed as they arrive and the frame is logged with the last, "
+          "with the CRC of the assembled frame as plain bytes",
+          DEFAULT_SUBFRAMES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY_GROUP,
+      g_param_spec_string ("latency-group", "Latency group",
+          "Name shared by the two taps measuring latency, in this or "
+          "another process on the host; their table is the shared memory "
+          "object /videocrc-latency-GROUP, removed by the last tap to stop "
+          "(NULL = disabled)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY_TAP,
+      g_param_spec_enum ("latency-tap", "Latency tap",
+          "Role of this element in its latency group; frames are matched by "
+          "fingerprint, XXH3 or CRC-64 when enabled, else CRC and size, so "
+          "both taps need the same settings",
+          GST_TYPE_VIDEOCRC_LATENCY_TAP, DEFAULT_LATENCY_TAP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_MERKLE_INDEX,
+      g_param_spec_string ("merkle-index", "Merkle index",
+          "File to write a Merkle tree over the frames to as its nodes "
+          "complete, two SHA-256 and 64 bytes per frame, for "
+          "videocrc-merkle-diff (NULL = none)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstVideocrc::hash-frames:
+   * @videocrc: the videocrc element
+   * @n_frames: frames to hash
+   *
+   * Hash the next @n_frames frames even when disabled or sampling.
+   */
+  gst_videocrc_signals[SIGNAL_HASH_FRAMES] =
+      g_signal_new ("hash-frames", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstVideocrcClass, hash_frames), NULL, NULL, NULL,
+      G_TYPE_NONE, 1, G_TYPE_UINT);
+
+  /**
+   * GstVideocrc::get-history:
+   * @videocrc: the videocrc element
+   * @start: first PTS
+   * @stop: PTS past the last, GST_CLOCK_TIME_NONE for no limit
+   *
+   * Returns the kept records with a PTS in [@start, @stop), oldest first, as
+   * packed #GstVideocrcHistoryRecord.
+   */
+  gst_videocrc_signals[SIGNAL_GET_HISTORY] =
+      g_signal_new ("get-history", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstVideocrcClass, get_history), NULL, NULL, NULL,
+      G_TYPE_BYTES, 2, G_TYPE_UINT64, G_TYPE_UINT64);
+
+  klass->hash_frames = gst_videocrc_hash_frames;
+  klass->get_history = gst_videocrc_get_history;
 
   gobject_class->finalize = GST_DEBUG_FUNCPTR (gst_videocrc_finalize);
 
@@ -117,6 +709,12 @@ gst_videocrc_class_init (GstVideocrcClass * klass)
   gstbasetrans_class->stop = GST_DEBUG_FUNCPTR (gst_videocrc_stop);
   gstbasetrans_class->transform_ip =
       GST_DEBUG_FUNCPTR (gst_videocrc_transform_frame_ip);
+  /* frames are only read: in passthrough the base class hands them over
+   * as they are, without copying a buffer that is not writable */
+  gstbasetrans_class->transform_ip_on_passthrough = TRUE;
+  gstbasetrans_class->query = GST_DEBUG_FUNCPTR (gst_videocrc_query);
+  gstbasetrans_class->sink_event = GST_DEBUG_FUNCPTR (gst_videocrc_sink_event);
+  gstbasetrans_class->src_event = GST_DEBUG_FUNCPTR (gst_videocrc_src_event);
   videofilter_class->set_info = GST_DEBUG_FUNCPTR (gst_videocrc_set_info);
 
   gst_element_class_set_metadata (GST_ELEMENT_CLASS (klass),
@@ -126,48 +724,427 @@ gst_videocrc_class_init (GstVideocrcClass * klass)
       "Zhou Jie <seuzhoujie@gmail.com>");
 }
 
+static void
+gst_videocrc_reset_stats (GstVideocrc * videocrc)
+{
+  g_mutex_lock (&videocrc->stats_lock);
+  videocrc->stats_frames = 0;
+  videocrc->stats_bytes = 0;
+  videocrc->stats_map_ns = 0;
+  videocrc->stats_hash_ns = 0;
+  videocrc->stats_log_ns = 0;
+  videocrc->stats_total_ns = 0;
+  videocrc->stats_max_ns = 0;
+  videocrc->stats_skipped = 0;
+  videocrc->stats_verified = 0;
+  videocrc->stats_mismatches = 0;
+  videocrc->stats_black = 0;
+  videocrc->stats_frozen = 0;
+  videocrc->stats_duplicate = 0;
+  videocrc->stats_perf_frames = 0;
+  videocrc->stats_perf_partial = 0;
+  memset (videocrc->stats_perf, 0, sizeof (videocrc->stats_perf));
+  memset (&videocrc->latency.stats, 0, sizeof (GstVideocrcLatencyStats));
+  g_mutex_unlock (&videocrc->stats_lock);
+}
+
 static void
 gst_videocrc_reset (GstVideocrc * videocrc)
 {
-  videocrc->crc_mask = GST_VIDEO_DEFAULT_CRC_MASK;
+  videocrc->config->enabled = DEFAULT_ENABLED;
+  videocrc->config->algorithm = DEFAULT_ALGORITHM;
+  videocrc->config->polynomial = GST_VIDEO_DEFAULT_CRC_MASK;
+  videocrc->config->sample_interval = DEFAULT_SAMPLE_INTERVAL;
+  videocrc->config->fingerprint_bits = DEFAULT_FINGERPRINT_BITS;
+  videocrc->max_distance = DEFAULT_MAX_DISTANCE;
+  videocrc->detect = DEFAULT_DETECT;
+  videocrc->detector.black_level = DEFAULT_BLACK_LEVEL;
+  videocrc->detector.frozen_frames = DEFAULT_FROZEN_FRAMES;
+  videocrc->history_size = DEFAULT_HISTORY_SIZE;
+  videocrc->granularity = DEFAULT_GRANULARITY;
+  videocrc->exclude = DEFAULT_EXCLUDE;
+  videocrc->digests = DEFAULT_DIGESTS;
+  videocrc->hash_chain = DEFAULT_HASH_CHAIN;
+  videocrc->chain_interval = DEFAULT_CHAIN_INTERVAL;
+  videocrc->subframes = DEFAULT_SUBFRAMES;
+  videocrc->latency_tap = DEFAULT_LATENCY_TAP;
   videocrc->frame_num = 0;
   videocrc->crc = 0;
   videocrc->logfile = NULL;
+  videocrc->socket_batch = DEFAULT_SOCKET_BATCH;
+  videocrc->socket_fd = -1;
+  videocrc->autotune = DEFAULT_AUTOTUNE;
+  videocrc->n_threads = DEFAULT_N_THREADS;
+  videocrc->cpu_budget = DEFAULT_CPU_BUDGET;
+  videocrc->qos_interval = DEFAULT_QOS_INTERVAL;
+}
+
+static void
+gst_videocrc_reset_qos (GstVideocrc * videocrc)
+{
+  videocrc->qos_level = GST_VIDEOCRC_QOS_FULL;
+  videocrc->qos_frames = 0;
+  videocrc->qos_calm = 0;
+  videocrc->qos_cost = 0;
+  GST_OBJECT_LOCK (videocrc);
+  videocrc->qos_proportion = 1.0;
+  videocrc->qos_earliest = GST_CLOCK_TIME_NONE;
+  GST_OBJECT_UNLOCK (videocrc);
 }
 
 static void
 gst_videocrc_init (GstVideocrc * videocrc)
 {
+  g_mutex_init (&videocrc->stats_lock);
+  g_mutex_init (&videocrc->history_lock);
+  videocrc->units = g_array_sized_new (FALSE, FALSE, sizeof (VideocrcUnit),
+      GST_VIDEOCRC_MAX_UNITS);
+  /* room for a line past the flush threshold, so only buffer lists longer
+   * than that make it grow */
+  videocrc->log_batch = g_string_sized_new (GST_VIDEOCRC_LOG_BATCH +
+      GST_VIDEOCRC_LOG_LINE);
+  gst_pad_set_chain_list_function (GST_BASE_TRANSFORM_SINK_PAD (videocrc),
+      GST_DEBUG_FUNCPTR (gst_videocrc_chain_list));
+  gst_videocrc_perf_init (&videocrc->perf);
+  videocrc->config = g_new0 (GstVideocrcConfig, 1);
   gst_videocrc_reset (videocrc);
-  gst_videocrc_init_crc32bit_table (videocrc);
-  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (videocrc), FALSE);
+  gst_videocrc_reset_stats (videocrc);
+  gst_videocrc_reset_qos (videocrc);
+  gst_videocrc_init_crc_kernel (videocrc);
+  gst_videocrc_tuner_init (&videocrc->tuner, 1);
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (videocrc), TRUE);
 }
 
 static void
 gst_videocrc_finalize (GObject * object)
 {
+  GstVideocrc *videocrc = GST_VIDEOCRC (object);
+
+  g_mutex_clear (&videocrc->stats_lock);
+  g_mutex_clear (&videocrc->history_lock);
+  g_array_free (videocrc->units, TRUE);
+  g_string_free (videocrc->log_batch, TRUE);
+  g_free (videocrc->staging);
+  gst_videocrc_digests_clear (&videocrc->digest);
+  g_free (videocrc->history);
+  g_free (videocrc->filename);
+  g_free (videocrc->shm_name);
+  g_free (videocrc->socket_path);
+  g_free (videocrc->reference_path);
+  g_free (videocrc->reference_store);
+  g_free (videocrc->latency_group);
+  g_free (videocrc->merkle_index);
+  g_free (videocrc->config);
+  g_free (videocrc->pending);
+  g_free (videocrc->active);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+/* the tables of @algorithm, @polynomial only applies to the legacy one;
+ * videocrcsink builds its kernel the same way */
 void
-gst_videocrc_init_crc32bit_table (GstVideocrc * videocrc)
+gst_videocrc_build_kernel (VideocrcKernel * kernel,
+    GstVideocrcAlgorithm algorithm, guint32 polynomial)
+{
+  switch (algorithm) {
+    case GST_VIDEOCRC_ALGORITHM_CRC32:
+      videocrc_kernel_init (kernel, VIDEOCRC_CRC32_POLY, TRUE,
+          VIDEOCRC_ENGINE_AUTO);
+      break;
+    case GST_VIDEOCRC_ALGORITHM_CRC32C:
+      videocrc_kernel_init (kernel, VIDEOCRC_CRC32C_POLY, TRUE,
+          VIDEOCRC_ENGINE_AUTO);
+      break;
+    default:
+      videocrc_kernel_init (kernel, polynomial, FALSE, VIDEOCRC_ENGINE_AUTO);
+      break;
+  }
+}
+
+static void
+gst_videocrc_config_build_kernel (GstVideocrcConfig * config)
 {
-  unsigned int i, j;
-  unsigned int remainder;
-  unsigned int polynomial = videocrc->crc_mask;
+  gst_videocrc_build_kernel (&config->kernel, config->algorithm,
+      config->polynomial);
+}
 
+void
+gst_videocrc_init_crc_kernel (GstVideocrc * videocrc)
+{
   GST_DEBUG_OBJECT (videocrc, "Initialize CRC table using polynomial %0X",
-      videocrc->crc_mask);
-  for (i = 0; i < 256; i ++) {
-    remainder = i << (WIDTH - 8);
-    for (j = 0; j < 8; j ++) {
-      if (remainder & TOPBIT)
-        remainder = (remainder << 1) ^ polynomial;
-      else
-        remainder = (remainder << 1);
+      videocrc->config->polynomial);
+  gst_videocrc_config_build_kernel (videocrc->config);
+  videocrc->active = g_new (GstVideocrcConfig, 1);
+  *videocrc->active = *videocrc->config;
+  videocrc->kernel = videocrc->active->kernel;
+}
+
+/* called with the object lock held; a snapshot the streaming thread has not
+ * taken yet is replaced and freed, it was never seen */
+static void
+gst_videocrc_config_publish (GstVideocrc * videocrc)
+{
+  GstVideocrcConfig *next = g_new (GstVideocrcConfig, 1);
+  GstVideocrcConfig *old;
+
+  *next = *videocrc->config;
+  do {
+    old = g_atomic_pointer_get (&videocrc->pending);
+  } while (!g_atomic_pointer_compare_and_exchange (&videocrc->pending, old,
+          next));
+  g_free (old);
+}
+
+/* streaming thread: take over the latest snapshot, if any */
+static const GstVideocrcConfig *
+gst_videocrc_config_acquire (GstVideocrc * videocrc)
+{
+  GstVideocrcConfig *next;
+
+  do {
+    next = g_atomic_pointer_get (&videocrc->pending);
+    if (G_LIKELY (next == NULL))
+      return videocrc->active;
+  } while (!g_atomic_pointer_compare_and_exchange (&videocrc->pending, next,
+          NULL));
+
+  if (next->kernel.poly != videocrc->kernel.poly ||
+      next->kernel.reflected != videocrc->kernel.reflected) {
+    GST_DEBUG_OBJECT (videocrc, "switching to polynomial %08X%s",
+        next->kernel.poly, next->kernel.reflected ? " reflected" : "");
+    videocrc->kernel = next->kernel;
+    /* the engines to tune depend on the polynomial, start over */
+    gst_videocrc_tuner_clear (&videocrc->tuner);
+  }
+  g_free (videocrc->active);
+  videocrc->active = next;
+
+  return next;
+}
+
+/* whether @config asks for this frame to be hashed */
+static gboolean
+gst_videocrc_config_wants (GstVideocrc * videocrc,
+    const GstVideocrcConfig * config)
+{
+  if (G_UNLIKELY (g_atomic_int_get (&videocrc->hash_frames) > 0)) {
+    g_atomic_int_add (&videocrc->hash_frames, -1);
+    return TRUE;
+  }
+  if (!config->enabled)
+    return FALSE;
+
+  return videocrc->sample_count++ % config->sample_interval == 0;
+}
+
+static void
+gst_videocrc_config_set (GstVideocrc * videocrc, guint prop_id,
+    const GValue * value)
+{
+  GstVideocrcConfig *config = videocrc->config;
+
+  GST_OBJECT_LOCK (videocrc);
+  switch (prop_id) {
+    case PROP_CRC_MASK:
+      config->polynomial = g_value_get_uint (value);
+      gst_videocrc_config_build_kernel (config);
+      break;
+    case PROP_ALGORITHM:
+      config->algorithm = g_value_get_enum (value);
+      gst_videocrc_config_build_kernel (config);
+      break;
+    case PROP_ENABLED:
+      config->enabled = g_value_get_boolean (value);
+      break;
+    case PROP_ROI_X:
+      config->roi_x = g_value_get_uint (value);
+      break;
+    case PROP_ROI_Y:
+      config->roi_y = g_value_get_uint (value);
+      break;
+    case PROP_ROI_WIDTH:
+      config->roi_width = g_value_get_uint (value);
+      break;
+    case PROP_ROI_HEIGHT:
+      config->roi_height = g_value_get_uint (value);
+      break;
+    case PROP_SAMPLE_INTERVAL:
+      config->sample_interval = g_value_get_uint (value);
+      break;
+    case PROP_FINGERPRINT_BITS:
+      config->fingerprint_bits = g_value_get_uint (value) > 64 ? 256 : 64;
+      break;
+  }
+  gst_videocrc_config_publish (videocrc);
+  GST_OBJECT_UNLOCK (videocrc);
+}
+
+static void
+gst_videocrc_hash_frames (GstVideocrc * videocrc, guint n_frames)
+{
+  GST_DEBUG_OBJECT (videocrc, "hashing the next %u frames", n_frames);
+  g_atomic_int_set (&videocrc->hash_frames, MIN (n_frames, (guint) G_MAXINT));
+}
+
+static GBytes *
+gst_videocrc_get_history (GstVideocrc * videocrc, guint64 start, guint64 stop)
+{
+  GstVideocrcHistoryRecord *out, *r;
+  guint64 first, i;
+  guint n = 0;
+
+  g_mutex_lock (&videocrc->history_lock);
+  first = videocrc->history_count > videocrc->history_len ?
+      videocrc->history_count - videocrc->history_len : 0;
+  out = g_new (GstVideocrcHistoryRecord, videocrc->history_count - first);
+  for (i = first; i < videocrc->history_count; i++) {
+    r = &videocrc->history[i % videocrc->history_len];
+    if (r->pts >= start && (stop == GST_CLOCK_TIME_NONE || r->pts < stop) &&
+        r->pts != GST_CLOCK_TIME_NONE)
+      out[n++] = *r;
+  }
+  g_mutex_unlock (&videocrc->history_lock);
+
+  GST_DEBUG_OBJECT (videocrc, "%u history records in [%" GST_TIME_FORMAT
+      ", %" GST_TIME_FORMAT ")", n, GST_TIME_ARGS (start),
+      GST_TIME_ARGS (stop));
+
+  return g_bytes_new_take (out, n * sizeof (GstVideocrcHistoryRecord));
+}
+
+/* a new ring on every start, records of the last run stay readable until
+ * then */
+static void
+gst_videocrc_history_alloc (GstVideocrc * videocrc)
+{
+  g_mutex_lock (&videocrc->history_lock);
+  g_free (videocrc->history);
+  videocrc->history = g_new0 (GstVideocrcHistoryRecord,
+      MAX (videocrc->history_size, 1));
+  videocrc->history_len = videocrc->history_size;
+  videocrc->history_count = 0;
+  g_mutex_unlock (&videocrc->history_lock);
+}
+
+static gboolean
+gst_videocrc_has_roi (const GstVideocrcConfig * config)
+{
+  return config->roi_x || config->roi_y || config->roi_width ||
+      config->roi_height;
+}
+
+/* plane walk of a raw frame in system memory, as laid out by the caps;
+ * returns 0 for other formats and encoded buffers */
+static guint
+gst_videocrc_info_planes (GstVideocrc * videocrc, const guint8 * data,
+    gsize size, VideocrcPlane * planes)
+{
+  const GstVideoInfo *info = &videocrc->info;
+  guint width = GST_VIDEO_INFO_WIDTH (info);
+  guint height = GST_VIDEO_INFO_HEIGHT (info);
+
+  if (size < GST_VIDEO_INFO_SIZE (info))
+    return 0;
+
+  switch (GST_VIDEO_INFO_FORMAT (info)) {
+    case GST_VIDEO_FORMAT_NV12:
+      planes[1].step = 2;
+      planes[1].width = (width + 1) / 2;
+      planes[2].data = data + GST_VIDEO_INFO_PLANE_OFFSET (info, 1) + 1;
+      break;
+    case GST_VIDEO_FORMAT_I420:
+      planes[1].step = 1;
+      planes[1].width = (width + 1) / 2;
+      planes[2].data = data + GST_VIDEO_INFO_PLANE_OFFSET (info, 2);
+      break;
+    default:
+      return 0;
+  }
+
+  planes[0].data = data;
+  planes[0].stride = GST_VIDEO_INFO_PLANE_STRIDE (info, 0);
+  planes[0].width = width & ~1u;
+  planes[0].height = height;
+  planes[0].step = 1;
+
+  planes[1].data = data + GST_VIDEO_INFO_PLANE_OFFSET (info, 1);
+  planes[1].stride = GST_VIDEO_INFO_PLANE_STRIDE (info, 1);
+  planes[1].height = height / 2;
+
+  planes[2].stride = GST_VIDEO_INFO_PLANE_STRIDE (info,
+      GST_VIDEO_INFO_N_PLANES (info) - 1);
+  planes[2].width = planes[1].width;
+  planes[2].height = planes[1].height;
+  planes[2].step = planes[1].step;
+
+  return 3;
+}
+
+/* codecs encoded-granularity=nal can split, in the stream formats it
+ * knows */
+static VideocrcCodec
+gst_videocrc_caps_codec (GstCaps * caps)
+{
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+  const gchar *format = gst_structure_get_string (s, "stream-format");
+
+  if (gst_structure_has_name (s, "video/x-h264") &&
+      (format == NULL || g_str_equal (format, "byte-stream")))
+    return VIDEOCRC_CODEC_H264;
+  if (gst_structure_has_name (s, "video/x-h265") &&
+      (format == NULL || g_str_equal (format, "byte-stream")))
+    return VIDEOCRC_CODEC_H265;
+  if (gst_structure_has_name (s, "video/x-av1") &&
+      (format == NULL || g_str_equal (format, "obu-stream")))
+    return VIDEOCRC_CODEC_AV1;
+
+  return VIDEOCRC_CODEC_NONE;
+}
+
+static void
+gst_videocrc_staging_reserve (GstVideocrc * videocrc, gsize size)
+{
+  if (size <= videocrc->staging_size)
+    return;
+
+  GST_DEBUG_OBJECT (videocrc, "staging area of %" G_GSIZE_FORMAT " bytes",
+      size);
+  g_free (videocrc->staging);
+  videocrc->staging = g_malloc (size);
+  videocrc->staging_size = size;
+}
+
+/* the bytes of @buf in one piece: mapped when it is one memory, else
+ * copied to the staging area, where gst_buffer_map would merge the
+ * memories into a new allocation for every frame; @map is for
+ * gst_videocrc_contiguous_done () */
+static const guint8 *
+gst_videocrc_contiguous (GstVideocrc * videocrc, GstBuffer * buf,
+    GstMapInfo * map, gsize * size)
+{
+  memset (map, 0, sizeof (GstMapInfo));
+  if (gst_buffer_n_memory (buf) == 1) {
+    if (!gst_buffer_map (buf, map, GST_MAP_READ)) {
+      *size = 0;
+      return NULL;
     }
-    videocrc->crc32bit_table[i] = remainder;
+    *size = map->size;
+    return map->data;
   }
+
+  /* encoded buffers have no size in the caps, the largest one sets it */
+  gst_videocrc_staging_reserve (videocrc, gst_buffer_get_size (buf));
+  *size = gst_buffer_extract (buf, 0, videocrc->staging,
+      videocrc->staging_size);
+  return videocrc->staging;
+}
+
+static void
+gst_videocrc_contiguous_done (GstBuffer * buf, GstMapInfo * map)
+{
+  if (map->memory != NULL)
+    gst_buffer_unmap (buf, map);
 }
 
 static gboolean
@@ -180,8 +1157,8 @@ gst_videocrc_set_info (GstVideoFilter * filter, GstCaps * incaps,
   width = GST_VIDEO_INFO_WIDTH (in_info);
   height = GST_VIDEO_INFO_HEIGHT (in_info);
   size = GST_VIDEO_INFO_SIZE(in_info);
-  stride_w = ALIGN(width, ALIGN128);
-  stride_h = ALIGN(height, ALIGN32);
+  stride_w = GST_VIDEOCRC_ALIGN (width, GST_VIDEOCRC_ION_STRIDE);
+  stride_h = GST_VIDEOCRC_ALIGN (height, GST_VIDEOCRC_ION_SCANLINES);
   offset = GST_VIDEO_INFO_PLANE_OFFSET (in_info, 1);
 
   videocrc->width = width;
@@ -190,62 +1167,1693 @@ gst_videocrc_set_info (GstVideoFilter * filter, GstCaps * incaps,
   videocrc->stride_h = stride_h;
   videocrc->offset = offset;
   videocrc->size = size;
+  videocrc->format = GST_VIDEO_INFO_FORMAT (in_info);
+  videocrc->info = *in_info;
+  videocrc->codec = gst_videocrc_caps_codec (incaps);
+  if (videocrc->granularity == GST_VIDEOCRC_GRANULARITY_NAL &&
+      videocrc->codec == VIDEOCRC_CODEC_NONE)
+    GST_WARNING_OBJECT (videocrc, "can't split %" GST_PTR_FORMAT
+        ", hashing whole buffers", incaps);
+  gst_videocrc_multiview_init (&videocrc->multiview, in_info);
+  if (videocrc->multiview.n_planes > 0 && (videocrc->detect ||
+          (videocrc->digest.digests & GST_VIDEOCRC_DIGEST_PLANES))) {
+    GST_WARNING_OBJECT (videocrc, "no per-view CRCs with detect or plane "
+        "digests");
+    videocrc->multiview.n_planes = 0;
+  }
+  /* what does not change until the next caps is decided here once rather
+   * than for every frame, see gst_videocrc_hashes_flat () */
+  videocrc->plan_flat = videocrc->multiview.n_planes == 0 &&
+      !videocrc->detect &&
+      !(videocrc->digest.digests & GST_VIDEOCRC_DIGEST_PLANES) &&
+      !(videocrc->granularity == GST_VIDEOCRC_GRANULARITY_NAL &&
+      videocrc->codec != VIDEOCRC_CODEC_NONE);
+  /* raw frames of several memories are staged whole, sized for the caps
+   * now rather than on the first such frame */
+  if (!gst_videocrc_hashes_flat (videocrc, videocrc->active))
+    gst_videocrc_staging_reserve (videocrc, size);
   GST_DEBUG_OBJECT (videocrc, "width: %d, height: %d, stride_w: %d, stride_h: %d, offset: %d, size: %d", width, height, stride_w, stride_h, offset, size);
 
   return TRUE;
 }
 
+/* TRUE when @name is left over from a process that is gone, which never
+ * unlinked it; a live owner, or a segment that isn't ours, is kept */
 static gboolean
-gst_videocrc_start (GstBaseTransform * trans)
+gst_videocrc_shm_stale (const gchar * name)
 {
-  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
+  const VideocrcShmHeader *shm;
+  gboolean stale;
+  gint fd;
+
+  fd = shm_open (name, O_RDONLY, 0);
+  if (fd < 0)
+    return FALSE;
+  shm = mmap (NULL, sizeof (VideocrcShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (shm == MAP_FAILED)
+    return FALSE;
+
+  stale = shm->magic == VIDEOCRC_SHM_MAGIC && shm->pid > 0 &&
+      kill ((pid_t) shm->pid, 0) < 0 && errno == ESRCH;
+  munmap ((gpointer) shm, sizeof (VideocrcShmHeader));
+
+  return stale;
+}
 
-  GST_DEBUG_OBJECT (videocrc, "start");
+/* the element creates the segment, readers only open it: a name another
+ * pipeline publishes in is refused rather than shared */
+static VideocrcShmHeader *
+gst_videocrc_shm_open (GstVideocrc * videocrc)
+{
+  VideocrcShmHeader *shm;
+  gint fd;
+
+  fd = shm_open (videocrc->shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0 && errno == EEXIST &&
+      gst_videocrc_shm_stale (videocrc->shm_name)) {
+    GST_INFO_OBJECT (videocrc, "removing stale shared memory %s",
+        videocrc->shm_name);
+    shm_unlink (videocrc->shm_name);
+    fd = shm_open (videocrc->shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  }
+  if (fd < 0)
+    goto open_failed;
+  if (ftruncate (fd, sizeof (VideocrcShmHeader)) < 0) {
+    close (fd);
+    goto open_failed;
+  }
+  shm = mmap (NULL, sizeof (VideocrcShmHeader), PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0);
+  close (fd);
+  if (shm == MAP_FAILED)
+    goto open_failed;
+
+  /* readers check the magic last */
+  memset (shm, 0, sizeof (VideocrcShmHeader));
+  shm->version = VIDEOCRC_SHM_VERSION;
+  shm->ring_size = VIDEOCRC_SHM_RING_SIZE;
+  shm->record_size = sizeof (VideocrcShmRecord);
+  shm->pid = getpid ();
+  __atomic_store_n (&shm->magic, VIDEOCRC_SHM_MAGIC, __ATOMIC_RELEASE);
+
+  GST_DEBUG_OBJECT (videocrc, "publishing CRC records in %s",
+      videocrc->shm_name);
+  return shm;
+
+open_failed:
+  GST_WARNING_OBJECT (videocrc, "can't create shared memory %s: %s",
+      videocrc->shm_name, g_strerror (errno));
+  return NULL;
+}
 
-  if (videocrc->filename != NULL)
-    videocrc->logfile = fopen (videocrc->filename, "w+");
-  else
-    videocrc->logfile = NULL;
+static void
+gst_videocrc_shm_close (GstVideocrc * videocrc)
+{
+  if (videocrc->shm == NULL)
+    return;
 
-  return TRUE;
+  munmap (videocrc->shm, sizeof (VideocrcShmHeader));
+  shm_unlink (videocrc->shm_name);
+  videocrc->shm = NULL;
+}
+
+static void
+gst_videocrc_socket_close (GstVideocrc * videocrc)
+{
+  if (videocrc->socket_fd >= 0)
+    close (videocrc->socket_fd);
+  videocrc->socket_fd = -1;
 }
 
 static gboolean
-gst_videocrc_stop (GstBaseTransform * trans)
+gst_videocrc_socket_send (GstVideocrc * videocrc, guint count)
 {
-  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
+  VideocrcSockHeader *h = &videocrc->socket_packet.header;
 
-  GST_DEBUG_OBJECT (videocrc, "stop");
-  if (videocrc->logfile != NULL) {
-    fclose (videocrc->logfile);
-    videocrc->logfile = NULL;
-  }
+  h->type = count ? VIDEOCRC_SOCK_RECORDS : VIDEOCRC_SOCK_HELLO;
+  h->count = count;
+  h->dropped = videocrc->socket_dropped;
 
-  return TRUE;
+  if (send (videocrc->socket_fd, &videocrc->socket_packet,
+          VIDEOCRC_SOCK_PACKET_SIZE (count), MSG_DONTWAIT | MSG_NOSIGNAL) >= 0)
+    return TRUE;
+
+  /* collector is behind, drop this batch but keep the connection */
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+    return FALSE;
+
+  GST_DEBUG_OBJECT (videocrc, "lost collector: %s", g_strerror (errno));
+  gst_videocrc_socket_close (videocrc);
+  videocrc->socket_retry =
+      gst_util_get_timestamp () + GST_VIDEOCRC_SOCKET_RETRY;
+  return FALSE;
 }
 
-static GstFlowReturn gst_videocrc_transform_frame_ip (GstBaseTransform * trans,
-        GstBuffer * buf)
+static void
+gst_videocrc_socket_connect (GstVideocrc * videocrc)
 {
-  gint i, j, k;
-  guint8 LumaPixVal1, LumaPixVal2, CbPixVal, CrPixVal;
-  gint width, height, stride_w, stride_h;
-  GstMapInfo map_info;
-  guint32 CRC, crc_pos;
-  guint size, offset, fd;
-  guint8 *buf_ptr;
+  VideocrcSockHeader *h = &videocrc->socket_packet.header;
+  struct sockaddr_un addr;
+  gchar *name;
+  gint fd;
+
+  videocrc->socket_retry =
+      gst_util_get_timestamp () + GST_VIDEOCRC_SOCKET_RETRY;
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  g_strlcpy (addr.sun_path, videocrc->socket_path, sizeof (addr.sun_path));
+
+  fd = socket (AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return;
+  if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+    GST_LOG_OBJECT (videocrc, "no collector at %s: %s",
+        videocrc->socket_path, g_strerror (errno));
+    close (fd);
+    return;
+  }
+  videocrc->socket_fd = fd;
+
+  /* the pending batch survives a reconnect */
+  h->magic = VIDEOCRC_SOCK_MAGIC;
+  h->version = VIDEOCRC_SOCK_VERSION;
+  h->pid = getpid ();
+  name = gst_object_get_name (GST_OBJECT (videocrc));
+  g_snprintf (h->name, sizeof (h->name), "%s-%d", name, (gint) getpid ());
+  g_free (name);
+
+  if (gst_videocrc_socket_send (videocrc, 0))
+    GST_DEBUG_OBJECT (videocrc, "connected to collector %s",
+        videocrc->socket_path);
+}
 
+static void
+gst_videocrc_socket_flush (GstVideocrc * videocrc)
+{
+  guint count = videocrc->socket_count;
 
-  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
-  guint32 *CRC32Table = videocrc->crc32bit_table;
+  if (count == 0)
+    return;
 
-  CRC = 0x0;
+  if (videocrc->socket_fd < 0 || !gst_videocrc_socket_send (videocrc, count))
+    videocrc->socket_dropped += count;
+  videocrc->socket_count = 0;
+}
+
+static void
+gst_videocrc_socket_add (GstVideocrc * videocrc,
+    const VideocrcSockRecord * record)
+{
+  if (videocrc->socket_fd < 0 &&
+      gst_util_get_timestamp () >= videocrc->socket_retry)
+    gst_videocrc_socket_connect (videocrc);
+
+  videocrc->socket_packet.records[videocrc->socket_count++] = *record;
+  if (videocrc->socket_count >= videocrc->socket_batch)
+    gst_videocrc_socket_flush (videocrc);
+}
+
+/* reads a log in the element's format, lines it doesn't know are ignored */
+static gboolean
+gst_videocrc_load_reference (GstVideocrc * videocrc)
+{
+  GstVideocrcReference entry;
+  GError *error = NULL;
+  gchar *contents, **lines, **line;
+  gchar kind[16];
+  guint frame;
+  gint pos;
+
+  if (!g_file_get_contents (videocrc->reference_path, &contents, NULL,
+          &error)) {
+    GST_ELEMENT_ERROR (videocrc, RESOURCE, OPEN_READ,
+        ("Could not read reference log \"%s\".", videocrc->reference_path),
+        ("%s", error->message));
+    g_error_free (error);
+    return FALSE;
+  }
+
+  videocrc->reference = g_array_new (FALSE, TRUE,
+      sizeof (GstVideocrcReference));
+  lines = g_strsplit (contents, "\n", -1);
+  for (line = lines; *line; line++) {
+    memset (&entry, 0, sizeof (entry));
+    pos = 0;
+    if (sscanf (*line, "VideoFrame %u %15s %n", &frame, kind, &pos) < 2 ||
+        frame == 0 || pos == 0)
+      continue;
+    if (strcmp (kind, "crc") == 0)
+      entry.valid = sscanf (*line + pos, "%X", &entry.crc) == 1;
+    else if (strcmp (kind, "fingerprint") == 0)
+      entry.valid = entry.is_fingerprint =
+          videocrc_fingerprint_from_string (&entry.fingerprint, *line + pos);
+    if (!entry.valid)
+      continue;
+    if (frame > videocrc->reference->len)
+      g_array_set_size (videocrc->reference, frame);
+    g_array_index (videocrc->reference, GstVideocrcReference, frame - 1) =
+        entry;
+  }
+  g_strfreev (lines);
+  g_free (contents);
+
+  GST_DEBUG_OBJECT (videocrc, "reference log covers %u frames",
+      videocrc->reference->len);
+
+  return TRUE;
+}
+
+/* the stream the store recognised; its first frames, which selected it,
+ * matched */
+static void
+gst_videocrc_store_identified (GstVideocrc * videocrc)
+{
+  const gchar *name = gst_videocrc_store_name (&videocrc->store);
+  guint frames = videocrc->store.stream->n_frames;
+
+  GST_INFO_OBJECT (videocrc, "reference %s frames %u", name, frames);
+  if (videocrc->logfile)
+    gst_videocrc_log_line (videocrc, "reference %s frames %u\n", name,
+        frames);
+  g_mutex_lock (&videocrc->stats_lock);
+  videocrc->stats_verified += videocrc->store.n_key - 1;
+  g_mutex_unlock (&videocrc->stats_lock);
+  gst_element_post_message (GST_ELEMENT (videocrc),
+      gst_message_new_element (GST_OBJECT (videocrc),
+          gst_structure_new ("videocrc-reference",
+              "name", G_TYPE_STRING, name,
+              "frames", G_TYPE_UINT, frames, NULL)));
+}
+
+/* compares the frame just hashed with the reference, returns FALSE on a
+ * mismatch; @distance is set for fingerprints */
+static gboolean
+gst_videocrc_verify (GstVideocrc * videocrc, guint * distance)
+{
+  GstVideocrcReference stored;
+  const GstVideocrcReference *ref;
+  const VideocrcFingerprint *fp = &videocrc->fingerprint;
+  gchar expected[VIDEOCRC_FINGERPRINT_STRLEN];
+  gchar actual[VIDEOCRC_FINGERPRINT_STRLEN];
+  guint max_distance;
+  gboolean match;
+
+  *distance = G_MAXUINT;
+  if (videocrc->store.map != NULL && fp->n_bits == 0 &&
+      videocrc->store.state == GST_VIDEOCRC_STORE_COLLECTING) {
+    if (gst_videocrc_store_add (&videocrc->store, videocrc->frame_num,
+            videocrc->crc))
+      gst_videocrc_store_identified (videocrc);
+    else if (videocrc->store.state == GST_VIDEOCRC_STORE_UNKNOWN)
+      GST_WARNING_OBJECT (videocrc, "stream not in reference store %s, "
+          "not verifying", videocrc->reference_store);
+  }
+
+  if (videocrc->store.crcs != NULL) {
+    if (videocrc->frame_num > videocrc->store.stream->n_frames)
+      return TRUE;
+    stored.valid = TRUE;
+    stored.is_fingerprint = FALSE;
+    stored.crc = videocrc->store.crcs[videocrc->frame_num - 1];
+    ref = &stored;
+  } else if (videocrc->reference == NULL ||
+      videocrc->frame_num > videocrc->reference->len) {
+    return TRUE;
+  } else {
+    ref = &g_array_index (videocrc->reference, GstVideocrcReference,
+        videocrc->frame_num - 1);
+  }
+  if (!ref->valid || ref->is_fingerprint != (fp->n_bits != 0))
+    return TRUE;
+
+  if (ref->is_fingerprint) {
+    max_distance = videocrc->max_distance ? videocrc->max_distance :
+        fp->n_bits / 8;
+    *distance = videocrc_fingerprint_distance (&ref->fingerprint, fp);
+    match = *distance <= max_distance;
+    videocrc_fingerprint_to_string (&ref->fingerprint, expected);
+    videocrc_fingerprint_to_string (fp, actual);
+  } else {
+    match = ref->crc == videocrc->crc;
+    g_snprintf (expected, sizeof (expected), "%08X", ref->crc);
+    g_snprintf (actual, sizeof (actual), "%08X", videocrc->crc);
+  }
+
+  g_mutex_lock (&videocrc->stats_lock);
+  videocrc->stats_verified++;
+  if (!match)
+    videocrc->stats_mismatches++;
+  g_mutex_unlock (&videocrc->stats_lock);
+
+  if (!match) {
+    GST_WARNING_OBJECT (videocrc, "VideoFrame %d: expected %s, got %s",
+        videocrc->frame_num, expected, actual);
+    gst_element_post_message (GST_ELEMENT (videocrc),
+        gst_message_new_element (GST_OBJECT (videocrc),
+            gst_structure_new ("videocrc-mismatch",
+                "frame", G_TYPE_UINT, videocrc->frame_num,
+                "expected", G_TYPE_STRING, expected,
+                "actual", G_TYPE_STRING, actual,
+                "distance", G_TYPE_UINT, *distance, NULL)));
+  }
+
+  return match;
+}
+
+/* runs the detector on the frame just hashed, posts the alarms that were
+ * raised or cleared and returns the ones that hold */
+static guint
+gst_videocrc_detect (GstVideocrc * videocrc)
+{
+  static const GstVideocrcAlarm alarms[] = { GST_VIDEOCRC_ALARM_BLACK,
+    GST_VIDEOCRC_ALARM_FROZEN, GST_VIDEOCRC_ALARM_DUPLICATE
+  };
+  GstVideocrcDetector *detector = &videocrc->detector;
+  guint flags, raised, cleared, i;
+
+  flags = gst_videocrc_detector_frame (detector, videocrc->crc,
+      &videocrc->luma, &raised, &cleared);
+
+  g_mutex_lock (&videocrc->stats_lock);
+  if (flags & GST_VIDEOCRC_ALARM_BLACK)
+    videocrc->stats_black++;
+  if (flags & GST_VIDEOCRC_ALARM_FROZEN)
+    videocrc->stats_frozen++;
+  if (flags & GST_VIDEOCRC_ALARM_DUPLICATE)
+    videocrc->stats_duplicate++;
+  g_mutex_unlock (&videocrc->stats_lock);
+
+  for (i = 0; i < G_N_ELEMENTS (alarms); i++) {
+    if (!((raised | cleared) & alarms[i]))
+      continue;
+    GST_INFO_OBJECT (videocrc, "VideoFrame %d: %s %s", videocrc->frame_num,
+        gst_videocrc_alarm_name (alarms[i]),
+        (raised & alarms[i]) ? "raised" : "cleared");
+    gst_element_post_message (GST_ELEMENT (videocrc),
+        gst_message_new_element (GST_OBJECT (videocrc),
+            gst_structure_new ("videocrc-alarm",
+                "alarm", G_TYPE_STRING, gst_videocrc_alarm_name (alarms[i]),
+                "active", G_TYPE_BOOLEAN, (raised & alarms[i]) != 0,
+                "frame", G_TYPE_UINT, videocrc->frame_num,
+                "repeats", G_TYPE_UINT, detector->repeats,
+                "mean-luma", G_TYPE_DOUBLE, videocrc->luma.pixels ?
+                (gdouble) videocrc->luma.sum / videocrc->luma.pixels : 0.0,
+                NULL)));
+  }
+
+  return flags;
+}
+
+static gboolean
+gst_videocrc_start (GstBaseTransform * trans)
+{
+  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
+  guint max_threads;
+
+  GST_DEBUG_OBJECT (videocrc, "start");
+  videocrc->perf_failed = FALSE;
+  gst_videocrc_reset_stats (videocrc);
+
+  if (videocrc->reference_path != NULL &&
+      !gst_videocrc_load_reference (videocrc))
+    return FALSE;
+  if (videocrc->reference_store != NULL && videocrc->reference_path == NULL
+      && !gst_videocrc_store_open (&videocrc->store,
+          videocrc->reference_store)) {
+    GST_ELEMENT_ERROR (videocrc, RESOURCE, OPEN_READ,
+        ("Could not map reference store \"%s\".",
+            videocrc->reference_store), ("%s", g_strerror (errno)));
+    return FALSE;
+  }
+
+  if (videocrc->filename != NULL)
+    videocrc->logfile = fopen (videocrc->filename, "w+");
+  else
+    videocrc->logfile = NULL;
+
+  if (videocrc->shm_name != NULL)
+    videocrc->shm = gst_videocrc_shm_open (videocrc);
+
+  videocrc->socket_dropped = 0;
+  videocrc->socket_retry = 0;
+  videocrc->socket_count = 0;
+  if (videocrc->socket_path != NULL)
+    gst_videocrc_socket_connect (videocrc);
+
+  gst_videocrc_digests_clear (&videocrc->digest);
+  if (!gst_videocrc_digests_init (&videocrc->digest, videocrc->digests))
+    GST_WARNING_OBJECT (videocrc, "built without XXH3, not logging it");
+
+  if (videocrc->hash_chain) {
+    gst_videocrc_chain_init (&videocrc->chain, videocrc->chain_interval);
+    GST_INFO_OBJECT (videocrc, "hash chain with %s SHA-256",
+        videocrc->chain.sha.engine);
+  }
+
+  if (videocrc->latency_group != NULL &&
+      videocrc->latency_tap != GST_VIDEOCRC_LATENCY_TAP_NONE &&
+      !gst_videocrc_latency_open (&videocrc->latency,
+          videocrc->latency_group))
+    GST_WARNING_OBJECT (videocrc, "can't open latency group %s: %s",
+        videocrc->latency_group, g_strerror (errno));
+
+  if (videocrc->merkle_index != NULL &&
+      !gst_videocrc_merkle_open (&videocrc->merkle, videocrc->merkle_index))
+    GST_WARNING_OBJECT (videocrc, "can't write Merkle index %s: %s",
+        videocrc->merkle_index, g_strerror (errno));
+
+  videocrc->part_count = 0;
+  if (videocrc->subframes && (videocrc->detect ||
+          (videocrc->digest.digests & GST_VIDEOCRC_DIGEST_PLANES)))
+    GST_WARNING_OBJECT (videocrc, "parts of frames are hashed as plain "
+        "bytes, no detection or plane digests");
+
+  /* streamed digests follow the CRC block by block, on this thread */
+  if (videocrc->digest.digests & GST_VIDEOCRC_DIGEST_STREAMED)
+    max_threads = 1;
+  else if (videocrc->n_threads > 0)
+    max_threads = videocrc->n_threads;
+  else if (videocrc->autotune)
+    max_threads = MIN (g_get_num_processors (), GST_VIDEOCRC_MAX_THREADS);
+  else
+    max_threads = 1;
+  /* with autotune the pool is only started once a tuning, calibrating or
+   * cached, hashes on more than one thread */
+  if (videocrc->n_threads > 1 && max_threads > 1)
+    videocrc->pool = gst_videocrc_pool_new (max_threads);
+  videocrc->hash_threads = videocrc->pool ? max_threads : 1;
+  gst_videocrc_tuner_init (&videocrc->tuner, max_threads);
+  gst_videocrc_reset_qos (videocrc);
+  gst_videocrc_detector_reset (&videocrc->detector);
+  gst_videocrc_history_alloc (videocrc);
+
+  return TRUE;
+}
+
+static gboolean
+gst_videocrc_stop (GstBaseTransform * trans)
+{
+  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
+
+  GST_DEBUG_OBJECT (videocrc, "stop");
+  gst_videocrc_perf_close (&videocrc->perf);
+  gst_videocrc_shm_close (videocrc);
+  gst_videocrc_latency_close (&videocrc->latency);
+  gst_videocrc_merkle_close (&videocrc->merkle);
+  gst_videocrc_socket_flush (videocrc);
+  gst_videocrc_socket_close (videocrc);
+  gst_videocrc_pool_free (videocrc->pool);
+  videocrc->pool = NULL;
+  if (videocrc->reference != NULL) {
+    g_array_free (videocrc->reference, TRUE);
+    videocrc->reference = NULL;
+  }
+  gst_videocrc_store_close (&videocrc->store);
+  gst_videocrc_tuner_clear (&videocrc->tuner);
+  gst_videocrc_digests_clear (&videocrc->digest);
+  if (videocrc->logfile != NULL) {
+    gst_videocrc_log_flush (videocrc);
+    fclose (videocrc->logfile);
+    videocrc->logfile = NULL;
+  }
+
+  return TRUE;
+}
+
+/* configure the kernel for the next frame, starting calibration or loading
+ * the cached configuration on the first frame */
+static void
+gst_videocrc_tune_prepare (GstVideocrc * videocrc, const gchar * memory)
+{
+  GstVideocrcTuner *tuner = &videocrc->tuner;
+  const GstVideocrcTuning *t = &tuner->current;
+
+  if (!videocrc->autotune)
+    return;
+
+  if (tuner->key == NULL) {
+    const gchar *format = videocrc->format != GST_VIDEO_FORMAT_UNKNOWN ?
+        gst_video_format_to_string (videocrc->format) : "encoded";
+
+    if (gst_videocrc_tuner_begin (tuner, &videocrc->kernel, format,
+            videocrc->width, videocrc->height, memory))
+      GST_INFO_OBJECT (videocrc, "cached tuning: engine %s, %u threads, "
+          "chunk %u", videocrc_engine_name (t->engine), t->threads, t->chunk);
+    else
+      GST_INFO_OBJECT (videocrc, "calibrating for %s", tuner->key);
+  }
+
+  if (t->engine != videocrc->kernel.engine)
+    videocrc_kernel_set_engine (&videocrc->kernel, t->engine);
+  videocrc_kernel_set_chunk (&videocrc->kernel, t->chunk);
+  if (videocrc->n_threads > 0)
+    return;
+
+  videocrc->hash_threads = t->threads;
+  /* calibration tries up to max_threads, a cached tuning needs its own */
+  if (gst_videocrc_pool_threads (videocrc->pool) < t->threads) {
+    gst_videocrc_pool_free (videocrc->pool);
+    videocrc->pool = gst_videocrc_pool_new (tuner->state ==
+        GST_VIDEOCRC_TUNE_CALIBRATING ? tuner->max_threads : t->threads);
+  }
+}
+
+static void
+gst_videocrc_tune_record (GstVideocrc * videocrc, guint64 hash_ns)
+{
+  GstVideocrcTuner *tuner = &videocrc->tuner;
+
+  if (tuner->state != GST_VIDEOCRC_TUNE_CALIBRATING)
+    return;
+
+  gst_videocrc_tuner_record (tuner, hash_ns);
+  if (tuner->state != GST_VIDEOCRC_TUNE_CALIBRATED)
+    return;
+
+  GST_INFO_OBJECT (videocrc, "calibrated: engine %s, %u threads, chunk %u, "
+      "%" G_GUINT64_FORMAT " ns", videocrc_engine_name (tuner->best.engine),
+      tuner->best.threads, tuner->best.chunk, tuner->best_ns);
+  /* the threads calibration started are idle from here on */
+  if (tuner->best.threads < 2 && videocrc->n_threads == 0) {
+    gst_videocrc_pool_free (videocrc->pool);
+    videocrc->pool = NULL;
+  }
+}
+
+/* a contiguous buffer is a plane whose stride equals its width */
+static guint32
+gst_videocrc_hash_flat (GstVideocrc * videocrc, guint32 crc,
+    const guint8 * data, gsize size)
+{
+  VideocrcPlane flat;
+  gsize len;
+
+  if (videocrc->digest.digests & GST_VIDEOCRC_DIGEST_STREAMED) {
+    for (; size > 0; data += len, size -= len) {
+      len = MIN (size, GST_VIDEOCRC_DIGEST_BLOCK);
+      crc = videocrc_update (&videocrc->kernel, crc, data, len);
+      gst_videocrc_digests_update (&videocrc->digest, data, len);
+    }
+    return crc;
+  }
+
+  if (videocrc->pool == NULL || videocrc->hash_threads < 2 ||
+      size < GST_VIDEOCRC_FLAT_ROWS * VIDEOCRC_MAX_CHUNK)
+    return videocrc_update (&videocrc->kernel, crc, data, size);
+
+  flat.data = data;
+  flat.width = size / GST_VIDEOCRC_FLAT_ROWS;
+  flat.stride = flat.width;
+  flat.height = GST_VIDEOCRC_FLAT_ROWS;
+  flat.step = 1;
+  crc = gst_videocrc_pool_plane_update (videocrc->pool, &videocrc->kernel,
+      crc, &flat, videocrc->hash_threads);
+
+  return videocrc_update (&videocrc->kernel, crc,
+      data + (gsize) flat.width * flat.height,
+      size - (gsize) flat.width * flat.height);
+}
+
+static const gchar *
+gst_videocrc_qos_level_name (GstVideocrcQosLevel level)
+{
+  switch (level) {
+    case GST_VIDEOCRC_QOS_FULL:
+      return "full";
+    case GST_VIDEOCRC_QOS_SAMPLED:
+      return "sampled";
+    default:
+      return "skipped";
+  }
+}
+
+/* whether the smoothed frame cost, spread over the frames hashed at @level,
+ * stays within cpu-budget */
+static gboolean
+gst_videocrc_qos_fits (GstVideocrc * videocrc, GstVideocrcQosLevel level)
+{
+  if (videocrc->cpu_budget == 0 || level == GST_VIDEOCRC_QOS_SKIPPED)
+    return TRUE;
+  if (level == GST_VIDEOCRC_QOS_SAMPLED)
+    return videocrc->qos_cost / videocrc->qos_interval <= videocrc->cpu_budget;
+  return videocrc->qos_cost <= videocrc->cpu_budget;
+}
+
+static void
+gst_videocrc_qos_set_level (GstVideocrc * videocrc, GstVideocrcQosLevel level)
+{
+  GST_INFO_OBJECT (videocrc, "qos: %s -> %s hashing, frame cost %"
+      G_GUINT64_FORMAT " ns", gst_videocrc_qos_level_name
+      (videocrc->qos_level), gst_videocrc_qos_level_name (level),
+      videocrc->qos_cost);
+  videocrc->qos_level = level;
+  videocrc->qos_frames = 0;
+  videocrc->qos_calm = 0;
+}
+
+/* pick the level for @buf and tell whether it is to be hashed. A level down
+ * is taken as soon as the current level has hashed a frame and is still
+ * late or over budget; a level up only after GST_VIDEOCRC_QOS_HOLD frames
+ * in a row that are on time and whose cost fits the level above. Skipped
+ * frames have no cost, so leaving the skipped level is a probe that falls
+ * back if sampling is still too expensive. */
+static gboolean
+gst_videocrc_qos_hash (GstVideocrc * videocrc, GstBuffer * buf)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM (videocrc);
+  GstVideocrcQosLevel level = videocrc->qos_level;
+  GstClockTime running_time, earliest;
+  gdouble proportion;
+  gboolean late = FALSE;
+  guint settle;
+
+  if (gst_base_transform_is_qos_enabled (trans)) {
+    GST_OBJECT_LOCK (videocrc);
+    proportion = videocrc->qos_proportion;
+    earliest = videocrc->qos_earliest;
+    GST_OBJECT_UNLOCK (videocrc);
+
+    running_time = gst_segment_to_running_time (&trans->segment,
+        GST_FORMAT_TIME, GST_BUFFER_PTS (buf));
+    if (GST_CLOCK_TIME_IS_VALID (running_time) &&
+        GST_CLOCK_TIME_IS_VALID (earliest))
+      late = running_time <= earliest;
+    else
+      late = proportion > 1.0;
+  }
+
+  settle = level == GST_VIDEOCRC_QOS_SAMPLED ? videocrc->qos_interval : 1;
+  if (level != GST_VIDEOCRC_QOS_SKIPPED && videocrc->qos_frames >= settle &&
+      (late || !gst_videocrc_qos_fits (videocrc, level))) {
+    gst_videocrc_qos_set_level (videocrc, level + 1);
+  } else if (level != GST_VIDEOCRC_QOS_FULL && !late &&
+      (level == GST_VIDEOCRC_QOS_SKIPPED ||
+          gst_videocrc_qos_fits (videocrc, level - 1))) {
+    if (++videocrc->qos_calm >= GST_VIDEOCRC_QOS_HOLD)
+      gst_videocrc_qos_set_level (videocrc, level - 1);
+  } else {
+    videocrc->qos_calm = 0;
+  }
+
+  switch (videocrc->qos_level) {
+    case GST_VIDEOCRC_QOS_FULL:
+      videocrc->qos_frames++;
+      return TRUE;
+    case GST_VIDEOCRC_QOS_SAMPLED:
+      return videocrc->qos_frames++ % videocrc->qos_interval == 0;
+    default:
+      videocrc->qos_frames++;
+      return FALSE;
+  }
+}
+
+static void
+gst_videocrc_qos_cost (GstVideocrc * videocrc, guint64 cost_ns)
+{
+  if (videocrc->qos_cost == 0)
+    videocrc->qos_cost = cost_ns;
+  else
+    videocrc->qos_cost = (videocrc->qos_cost * 7 + cost_ns) / 8;
+}
+
+/* open the counter group lazily from the streaming thread, the counters
+ * follow the thread that opened them */
+static gboolean
+gst_videocrc_perf_prepare (GstVideocrc * videocrc)
+{
+  if (!videocrc->perf_counters || videocrc->perf_failed)
+    return FALSE;
+
+  if (gst_videocrc_perf_is_current (&videocrc->perf))
+    return TRUE;
+
+  if (gst_videocrc_perf_open (&videocrc->perf)) {
+    GST_DEBUG_OBJECT (videocrc, "opened %u hardware counters",
+        videocrc->perf.n_open);
+    return TRUE;
+  }
+
+  GST_WARNING_OBJECT (videocrc, "hardware counters unavailable: %s",
+      g_strerror (errno));
+  videocrc->perf_failed = TRUE;
+  return FALSE;
+}
+
+/* the counters follow the streaming thread only, see gstvideocrcperf.c: a
+ * frame whose bands also went to pool workers is left out of the averages
+ * and counted as partial */
+static gboolean
+gst_videocrc_perf_start (GstVideocrc * videocrc, gboolean perf)
+{
+  videocrc->perf_generation = gst_videocrc_pool_generation (videocrc->pool);
+
+  return perf && gst_videocrc_perf_begin (&videocrc->perf);
+}
+
+static gboolean
+gst_videocrc_perf_stop (GstVideocrc * videocrc, gboolean perf,
+    guint64 delta[GST_VIDEOCRC_PERF_N])
+{
+  if (!perf)
+    return FALSE;
+
+  if (gst_videocrc_pool_generation (videocrc->pool) !=
+      videocrc->perf_generation) {
+    g_mutex_lock (&videocrc->stats_lock);
+    videocrc->stats_perf_partial++;
+    g_mutex_unlock (&videocrc->stats_lock);
+    return FALSE;
+  }
+
+  return gst_videocrc_perf_end (&videocrc->perf, delta);
+}
+
+static void
+gst_videocrc_update_stats (GstVideocrc * videocrc, guint64 bytes,
+    guint64 map_ns, guint64 hash_ns, guint64 log_ns, const guint64 * perf)
+{
+  guint64 total_ns = map_ns + hash_ns + log_ns;
+  guint i;
+
+  g_mutex_lock (&videocrc->stats_lock);
+  videocrc->stats_window[videocrc->stats_frames % GST_VIDEOCRC_STATS_WINDOW] =
+      total_ns;
+  videocrc->stats_frames++;
+  videocrc->stats_bytes += bytes;
+  videocrc->stats_map_ns += map_ns;
+  videocrc->stats_hash_ns += hash_ns;
+  videocrc->stats_log_ns += log_ns;
+  videocrc->stats_total_ns += total_ns;
+  if (total_ns > videocrc->stats_max_ns)
+    videocrc->stats_max_ns = total_ns;
+  if (perf) {
+    videocrc->stats_perf_frames++;
+    for (i = 0; i < GST_VIDEOCRC_PERF_N; i++)
+      videocrc->stats_perf[i] += perf[i];
+  }
+  if (videocrc->shm) {
+    VideocrcShmStats s;
+
+    s.frames = videocrc->stats_frames;
+    s.bytes = videocrc->stats_bytes;
+    s.total_ns = videocrc->stats_total_ns;
+    s.hash_ns = videocrc->stats_hash_ns;
+    s.max_ns = videocrc->stats_max_ns;
+    s.last_crc = videocrc->crc;
+    videocrc_shm_write_stats (videocrc->shm, &s);
+  }
+  g_mutex_unlock (&videocrc->stats_lock);
+}
+
+static gint
+gst_videocrc_compare_ns (gconstpointer a, gconstpointer b)
+{
+  guint64 va = *(const guint64 *) a;
+  guint64 vb = *(const guint64 *) b;
+
+  return (va > vb) - (va < vb);
+}
+
+/* percentiles are taken over the last GST_VIDEOCRC_STATS_WINDOW frames,
+ * everything else since start */
+static void
+gst_videocrc_fill_stats (GstVideocrc * videocrc, GstStructure * s)
+{
+  guint64 window[GST_VIDEOCRC_STATS_WINDOW];
+  guint64 frames, bytes, map_ns, hash_ns, log_ns, total_ns, max_ns;
+  guint64 skipped, verified, mismatches, black, frozen, duplicate;
+  gdouble proportion;
+  gboolean enabled;
+  guint64 perf[GST_VIDEOCRC_PERF_N], perf_frames, perf_partial;
+  GstVideocrcLatencyStats latency;
+  guint64 p50 = 0, p99 = 0;
+  const gchar *perf_state;
+  guint n;
+
+  g_mutex_lock (&videocrc->stats_lock);
+  frames = videocrc->stats_frames;
+  bytes = videocrc->stats_bytes;
+  map_ns = videocrc->stats_map_ns;
+  hash_ns = videocrc->stats_hash_ns;
+  log_ns = videocrc->stats_log_ns;
+  total_ns = videocrc->stats_total_ns;
+  max_ns = videocrc->stats_max_ns;
+  skipped = videocrc->stats_skipped;
+  verified = videocrc->stats_verified;
+  mismatches = videocrc->stats_mismatches;
+  black = videocrc->stats_black;
+  frozen = videocrc->stats_frozen;
+  duplicate = videocrc->stats_duplicate;
+  n = MIN (frames, GST_VIDEOCRC_STATS_WINDOW);
+  memcpy (window, videocrc->stats_window, n * sizeof (guint64));
+  perf_frames = videocrc->stats_perf_frames;
+  perf_partial = videocrc->stats_perf_partial;
+  memcpy (perf, videocrc->stats_perf, sizeof (perf));
+  latency = videocrc->latency.stats;
+  g_mutex_unlock (&videocrc->stats_lock);
+
+  GST_OBJECT_LOCK (videocrc);
+  proportion = videocrc->qos_proportion;
+  enabled = videocrc->config->enabled;
+  GST_OBJECT_UNLOCK (videocrc);
+
+  if (n > 0) {
+    qsort (window, n, sizeof (guint64), gst_videocrc_compare_ns);
+    p50 = window[(n - 1) * 50 / 100];
+    p99 = window[(n - 1) * 99 / 100];
+  }
+
+  gst_structure_set (s,
+      "frames", G_TYPE_UINT64, frames,
+      "bytes", G_TYPE_UINT64, bytes,
+      "mean-ns", G_TYPE_UINT64, frames ? total_ns / frames : 0,
+      "p50-ns", G_TYPE_UINT64, p50,
+      "p99-ns", G_TYPE_UINT64, p99,
+      "max-ns", G_TYPE_UINT64, max_ns,
+      "map-mean-ns", G_TYPE_UINT64, frames ? map_ns / frames : 0,
+      "hash-mean-ns", G_TYPE_UINT64, frames ? hash_ns / frames : 0,
+      "log-mean-ns", G_TYPE_UINT64, frames ? log_ns / frames : 0,
+      "gbps", G_TYPE_DOUBLE, hash_ns ? (gdouble) bytes / hash_ns : 0.0,
+      NULL);
+
+  gst_structure_set (s,
+      "frames-skipped", G_TYPE_UINT64, skipped,
+      "qos-level", G_TYPE_STRING,
+      gst_videocrc_qos_level_name (videocrc->qos_level),
+      "qos-proportion", G_TYPE_DOUBLE, proportion,
+      "enabled", G_TYPE_BOOLEAN, enabled, NULL);
+
+  gst_structure_set (s,
+      "engine", G_TYPE_STRING, videocrc_engine_name (videocrc->kernel.engine),
+      "threads", G_TYPE_UINT, videocrc->hash_threads,
+      "chunk", G_TYPE_UINT, videocrc->kernel.chunk,
+      "tuning", G_TYPE_STRING,
+      gst_videocrc_tuner_state_name (videocrc->tuner.state), NULL);
+
+  if (videocrc->reference_path != NULL || videocrc->reference_store != NULL)
+    gst_structure_set (s,
+        "verified", G_TYPE_UINT64, verified,
+        "mismatches", G_TYPE_UINT64, mismatches, NULL);
+
+  if (videocrc->detect)
+    gst_structure_set (s,
+        "black-frames", G_TYPE_UINT64, black,
+        "frozen-frames", G_TYPE_UINT64, frozen,
+        "duplicate-frames", G_TYPE_UINT64, duplicate, NULL);
+
+  if (videocrc->latency_tap == GST_VIDEOCRC_LATENCY_TAP_DOWNSTREAM)
+    gst_videocrc_latency_stats_fill (&latency, s);
+
+  if (videocrc->socket_path != NULL)
+    gst_structure_set (s,
+        "socket-connected", G_TYPE_BOOLEAN, videocrc->socket_fd >= 0,
+        "socket-dropped", G_TYPE_UINT64, videocrc->socket_dropped, NULL);
+
+  if (!videocrc->perf_counters)
+    perf_state = "off";
+  else if (videocrc->perf_failed)
+    perf_state = "unavailable";
+  else
+    perf_state = "on";
+  gst_structure_set (s, "perf-counters", G_TYPE_STRING, perf_state,
+      "perf-partial-frames", G_TYPE_UINT64, perf_partial, NULL);
+
+  if (perf_frames > 0) {
+    gst_structure_set (s,
+        "cycles-per-frame", G_TYPE_DOUBLE,
+        (gdouble) perf[GST_VIDEOCRC_PERF_CYCLES] / perf_frames,
+        "instructions-per-frame", G_TYPE_DOUBLE,
+        (gdouble) perf[GST_VIDEOCRC_PERF_INSTRUCTIONS] / perf_frames,
+        "llc-misses-per-frame", G_TYPE_DOUBLE,
+        (gdouble) perf[GST_VIDEOCRC_PERF_LLC_MISSES] / perf_frames,
+        "dtlb-misses-per-frame", G_TYPE_DOUBLE,
+        (gdouble) perf[GST_VIDEOCRC_PERF_DTLB_MISSES] / perf_frames,
+        "ipc", G_TYPE_DOUBLE, perf[GST_VIDEOCRC_PERF_CYCLES] ?
+        (gdouble) perf[GST_VIDEOCRC_PERF_INSTRUCTIONS] /
+        perf[GST_VIDEOCRC_PERF_CYCLES] : 0.0,
+        NULL);
+  }
+}
+
+/* the lines held back, to stdio in one write */
+static void
+gst_videocrc_log_flush (GstVideocrc * videocrc)
+{
+  if (videocrc->log_batch->len == 0)
+    return;
+
+  fwrite (videocrc->log_batch->str, 1, videocrc->log_batch->len,
+      videocrc->logfile);
+  g_string_truncate (videocrc->log_batch, 0);
+}
+
+/* lines are written GST_VIDEOCRC_LOG_BATCH bytes at a time, and at the end
+ * of a buffer list; the batch never outgrows its reserved size, whatever
+ * the length of the list */
+static void
+gst_videocrc_log_held (GstVideocrc * videocrc)
+{
+  if (videocrc->log_batch->len >= GST_VIDEOCRC_LOG_BATCH)
+    gst_videocrc_log_flush (videocrc);
+}
+
+/* a line for the log file, formatted on the stack: appending a printf to
+ * the GString would allocate the formatted string every time */
+static void
+gst_videocrc_log_line (GstVideocrc * videocrc, const gchar * format, ...)
+{
+  gchar line[GST_VIDEOCRC_LOG_LINE];
+  va_list args;
+  gint len;
+
+  va_start (args, format);
+  len = g_vsnprintf (line, sizeof (line), format, args);
+  va_end (args);
+  if (G_LIKELY (len >= 0 && len < (gint) sizeof (line))) {
+    g_string_append_len (videocrc->log_batch, line, len);
+  } else {
+    va_start (args, format);
+    g_string_append_vprintf (videocrc->log_batch, format, args);
+    va_end (args);
+  }
+  gst_videocrc_log_held (videocrc);
+}
+
+/* "VideoFrame N crc XXXXXXXX" and its flags, the line of every frame, put
+ * together without going through printf */
+static void
+gst_videocrc_log_crc (GstVideocrc * videocrc, const gchar * verdict,
+    guint alarms, const gchar * views, const gchar * latency,
+    const gchar * digests)
+{
+  static const gchar hex[] = "0123456789ABCDEF";
+  GString *line = videocrc->log_batch;
+  gchar num[10], crc[8], *p = num + sizeof (num);
+  guint32 n = videocrc->frame_num;
+  guint i;
+
+  do {
+    *--p = '0' + n % 10;
+    n /= 10;
+  } while (n > 0);
+  for (i = 0; i < 8; i++)
+    crc[i] = hex[(videocrc->crc >> (28 - 4 * i)) & 0xF];
+
+  g_string_append_len (line, "VideoFrame ", 11);
+  g_string_append_len (line, p, num + sizeof (num) - p);
+  g_string_append_len (line, " crc ", 5);
+  g_string_append_len (line, crc, 8);
+  g_string_append (line, verdict);
+  if (alarms & GST_VIDEOCRC_ALARM_BLACK)
+    g_string_append_len (line, " black", 6);
+  if (alarms & GST_VIDEOCRC_ALARM_FROZEN)
+    g_string_append_len (line, " frozen", 7);
+  if (alarms & GST_VIDEOCRC_ALARM_DUPLICATE)
+    g_string_append_len (line, " duplicate", 10);
+  g_string_append (line, views);
+  g_string_append (line, latency);
+  g_string_append (line, digests);
+  g_string_append_c (line, '\n');
+  gst_videocrc_log_held (videocrc);
+}
+
+/* the downstream tap's summary, to the log and the application */
+static void
+gst_videocrc_latency_end (GstVideocrc * videocrc)
+{
+  GstVideocrcLatencyStats s;
+  GstStructure *structure;
+
+  g_mutex_lock (&videocrc->stats_lock);
+  s = videocrc->latency.stats;
+  g_mutex_unlock (&videocrc->stats_lock);
+
+  GST_INFO_OBJECT (videocrc, "latency of %" G_GUINT64_FORMAT " frames, %"
+      G_GUINT64_FORMAT " unmatched", s.matched, s.unmatched);
+  if (videocrc->logfile)
+    gst_videocrc_log_line (videocrc, "latency matched %" G_GUINT64_FORMAT
+        " unmatched %" G_GUINT64_FORMAT " min %" G_GUINT64_FORMAT "us mean %"
+        G_GUINT64_FORMAT "us max %" G_GUINT64_FORMAT "us\n", s.matched,
+        s.unmatched, s.min_ns / 1000,
+        s.matched ? s.sum_ns / s.matched / 1000 : 0, s.max_ns / 1000);
+  structure = gst_structure_new_empty ("videocrc-latency");
+  gst_videocrc_latency_stats_fill (&s, structure);
+  gst_element_post_message (GST_ELEMENT (videocrc),
+      gst_message_new_element (GST_OBJECT (videocrc), structure));
+}
+
+/* the SHA-256 of the chain records so far, to the log and the application */
+static void
+gst_videocrc_chain_end (GstVideocrc * videocrc)
+{
+  gchar hex[GST_VIDEOCRC_CHAIN_STRLEN];
+  guint64 frames = videocrc->chain.sha.n_blocks;
+
+  gst_videocrc_chain_final (&videocrc->chain, hex);
+  GST_INFO_OBJECT (videocrc, "chain sha256 %s frames %" G_GUINT64_FORMAT,
+      hex, frames);
+  if (videocrc->logfile)
+    gst_videocrc_log_line (videocrc, "chain sha256 %s frames %"
+        G_GUINT64_FORMAT "\n", hex, frames);
+  gst_element_post_message (GST_ELEMENT (videocrc),
+      gst_message_new_element (GST_OBJECT (videocrc),
+          gst_structure_new ("videocrc-chain",
+              "sha256", G_TYPE_STRING, hex,
+              "frames", G_TYPE_UINT64, frames, NULL)));
+}
+
+/* the root of the frames so far, to the log, and the index on disk */
+static void
+gst_videocrc_merkle_end (GstVideocrc * videocrc)
+{
+  gchar hex[GST_VIDEOCRC_CHAIN_STRLEN];
+  guint64 frames = videocrc->merkle.n_leaves;
+
+  gst_videocrc_merkle_root (&videocrc->merkle, hex);
+  GST_INFO_OBJECT (videocrc, "merkle root %s frames %" G_GUINT64_FORMAT, hex,
+      frames);
+  if (videocrc->logfile)
+    gst_videocrc_log_line (videocrc, "merkle root %s frames %"
+        G_GUINT64_FORMAT "\n", hex, frames);
+  if (!gst_videocrc_merkle_sync (&videocrc->merkle))
+    GST_WARNING_OBJECT (videocrc, "can't write Merkle index %s: %s",
+        videocrc->merkle_index, g_strerror (errno));
+}
+
+static gboolean
+gst_videocrc_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    if (videocrc->part_count > 0)
+      GST_WARNING_OBJECT (videocrc, "EOS after %u parts of frame %u, no "
+          "MARKER, not logged", videocrc->part_count,
+          videocrc->frame_num + 1);
+    if (videocrc->hash_chain)
+      gst_videocrc_chain_end (videocrc);
+    if (videocrc->merkle.file)
+      gst_videocrc_merkle_end (videocrc);
+    if (videocrc->latency.table != NULL &&
+        videocrc->latency_tap == GST_VIDEOCRC_LATENCY_TAP_DOWNSTREAM)
+      gst_videocrc_latency_end (videocrc);
+    gst_videocrc_socket_flush (videocrc);
+    if (videocrc->logfile) {
+      gst_videocrc_log_flush (videocrc);
+      fflush (videocrc->logfile);
+    }
+  } else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    gst_videocrc_reset_qos (videocrc);
+    /* the rest of a frame cut by a seek never comes */
+    videocrc->part_count = 0;
+    /* the first frame after a seek is no duplicate of the last before */
+    gst_videocrc_detector_reset (&videocrc->detector);
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+/* QoS events are kept for gst_videocrc_qos_hash and not handed to the base
+ * class, which would drop late frames instead of hashing less */
+static gboolean
+gst_videocrc_src_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
+  GstClockTimeDiff diff;
+  GstClockTime timestamp;
+  gdouble proportion;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_QOS)
+    return GST_BASE_TRANSFORM_CLASS (parent_class)->src_event (trans, event);
+
+  gst_event_parse_qos (event, NULL, &proportion, &diff, &timestamp);
+  GST_LOG_OBJECT (videocrc, "qos: proportion %g, diff %" G_GINT64_FORMAT,
+      proportion, diff);
+
+  GST_OBJECT_LOCK (videocrc);
+  videocrc->qos_proportion = proportion;
+  if (!GST_CLOCK_TIME_IS_VALID (timestamp))
+    videocrc->qos_earliest = GST_CLOCK_TIME_NONE;
+  else if (diff > 0)
+    videocrc->qos_earliest = timestamp + diff;
+  else
+    videocrc->qos_earliest = timestamp > (GstClockTime) - diff ?
+        timestamp + diff : 0;
+  GST_OBJECT_UNLOCK (videocrc);
+
+  return gst_pad_push_event (GST_BASE_TRANSFORM_SINK_PAD (trans), event);
+}
+
+static void
+gst_videocrc_chain_log (GstVideocrc * videocrc)
+{
+  gchar hex[GST_VIDEOCRC_CHAIN_STRLEN];
+
+  gst_videocrc_chain_value (&videocrc->chain, hex);
+  GST_DEBUG_OBJECT (videocrc, "VideoFrame %d chain %s", videocrc->frame_num,
+      hex);
+  if (videocrc->logfile)
+    gst_videocrc_log_line (videocrc, "VideoFrame %d chain %s\n",
+        videocrc->frame_num, hex);
+}
+
+/* the key both taps compute for a frame: the fingerprint, else the widest
+ * digest there is, else the CRC and the size */
+static guint64
+gst_videocrc_latency_key (GstVideocrc * videocrc, guint64 bytes)
+{
+  const GstVideocrcDigests *d = &videocrc->digest;
+
+  if (videocrc->fingerprint.n_bits)
+    return videocrc->fingerprint.bits[0];
+  if (d->digests & GST_VIDEOCRC_DIGEST_XXH3)
+    return d->xxh3;
+  if (d->digests & GST_VIDEOCRC_DIGEST_CRC64)
+    return d->crc64;
+
+  return (bytes << 32) | videocrc->crc;
+}
+
+/* the upstream tap notes when @buf arrived, the downstream one formats
+ * how long ago that was into @str; empty when there is nothing to say */
+static void
+gst_videocrc_latency_tap (GstVideocrc * videocrc, guint64 bytes,
+    GstClockTime arrived, gchar * str)
+{
+  guint64 key, latency_ns = 0;
+  gboolean matched;
+
+  str[0] = '\0';
+  if (videocrc->latency.table == NULL)
+    return;
+
+  key = gst_videocrc_latency_key (videocrc, bytes);
+  if (videocrc->latency_tap == GST_VIDEOCRC_LATENCY_TAP_UPSTREAM) {
+    gst_videocrc_latency_record (&videocrc->latency, key, arrived);
+    return;
+  }
+
+  matched = gst_videocrc_latency_match (&videocrc->latency, key, arrived,
+      &latency_ns);
+  g_mutex_lock (&videocrc->stats_lock);
+  gst_videocrc_latency_stats_add (&videocrc->latency.stats, matched,
+      latency_ns);
+  g_mutex_unlock (&videocrc->stats_lock);
+  if (matched)
+    g_snprintf (str, GST_VIDEOCRC_LATENCY_STRLEN, " latency %"
+        G_GUINT64_FORMAT "us", latency_ns / 1000);
+}
+
+/* hand a record to the shared-memory ring and the collector socket */
+/* @flags are VIDEOCRC_SHM_FLAG_*, the socket flags have the same values */
+static void
+gst_videocrc_publish (GstVideocrc * videocrc, GstBuffer * buf,
+    GstClockTime timestamp, guint32 crc, guint32 flags)
+{
+  GstVideocrcHistoryRecord *r;
+
+  if (videocrc->history_len > 0 && !(flags & VIDEOCRC_SHM_FLAG_SKIPPED)) {
+    g_mutex_lock (&videocrc->history_lock);
+    r = &videocrc->history[videocrc->history_count++ %
+        videocrc->history_len];
+    r->pts = GST_BUFFER_PTS (buf);
+    r->frame = videocrc->frame_num;
+    r->crc = crc;
+    g_mutex_unlock (&videocrc->history_lock);
+  }
+  if (videocrc->shm) {
+    VideocrcShmRecord record;
+
+    record.frame = videocrc->frame_num;
+    record.pts = GST_BUFFER_PTS_IS_VALID (buf) ? GST_BUFFER_PTS (buf) :
+        VIDEOCRC_SHM_NO_PTS;
+    record.timestamp = timestamp;
+    record.crc = crc;
+    record.flags = flags;
+    videocrc_shm_write_record (videocrc->shm, &record);
+  }
+  if (videocrc->hash_chain && gst_videocrc_chain_add (&videocrc->chain,
+          videocrc->frame_num, GST_BUFFER_PTS_IS_VALID (buf) ?
+          GST_BUFFER_PTS (buf) : G_MAXUINT64, crc, flags,
+          (flags & VIDEOCRC_SHM_FLAG_FINGERPRINT) ? &videocrc->fingerprint :
+          NULL, (flags & VIDEOCRC_SHM_FLAG_SKIPPED) ? NULL :
+          &videocrc->digest))
+    gst_videocrc_chain_log (videocrc);
+  if (videocrc->merkle.file)
+    gst_videocrc_merkle_add (&videocrc->merkle, videocrc->frame_num, crc,
+        flags, (flags & VIDEOCRC_SHM_FLAG_FINGERPRINT) ?
+        &videocrc->fingerprint : NULL, (flags & VIDEOCRC_SHM_FLAG_SKIPPED) ?
+        NULL : &videocrc->digest);
+  if (videocrc->socket_path) {
+    VideocrcSockRecord record;
+
+    record.frame = videocrc->frame_num;
+    record.pts = GST_BUFFER_PTS_IS_VALID (buf) ? GST_BUFFER_PTS (buf) :
+        G_MAXUINT64;
+    record.timestamp = timestamp;
+    record.crc = crc;
+    record.flags = flags;
+    gst_videocrc_socket_add (videocrc, &record);
+  }
+}
+
+/* a frame left out by sampling only counts, and is a leaf of the Merkle
+ * index so leaves stay frames */
+static void
+gst_videocrc_ignore_frame (GstVideocrc * videocrc)
+{
+  videocrc->frame_num++;
+  if (videocrc->merkle.file)
+    gst_videocrc_merkle_add (&videocrc->merkle, videocrc->frame_num, 0,
+        VIDEOCRC_SHM_FLAG_SKIPPED, NULL, NULL);
+}
+
+/* a frame left out under load keeps its number so logs stay aligned */
+static void
+gst_videocrc_skip_frame (GstVideocrc * videocrc, GstBuffer * buf)
+{
+  videocrc->crc = 0;
+  videocrc->frame_num++;
+  GST_DEBUG_OBJECT (videocrc, "VideoFrame %d skipped", videocrc->frame_num);
+  if (videocrc->logfile)
+    gst_videocrc_log_line (videocrc, "VideoFrame %d skipped\n",
+        videocrc->frame_num);
+  gst_videocrc_publish (videocrc, buf, gst_util_get_timestamp (), 0,
+      VIDEOCRC_SHM_FLAG_SKIPPED);
+
+  g_mutex_lock (&videocrc->stats_lock);
+  videocrc->stats_skipped++;
+  g_mutex_unlock (&videocrc->stats_lock);
+}
+
+/* records the CRC @plane would have alone, from the running values before
+ * (@start) and after (@end) it was hashed; the CRC being linear, that is
+ * update (init, B) == end ^ shift (start, |B|) ^ shift (init, |B|) */
+static void
+gst_videocrc_digest_plane (GstVideocrc * videocrc, guint32 start, guint32 end,
+    guint64 len)
+{
+  const VideocrcKernel *k = &videocrc->kernel;
+  GstVideocrcDigests *d = &videocrc->digest;
+
+  if (!(d->digests & GST_VIDEOCRC_DIGEST_PLANES) ||
+      d->n_planes == VIDEOCRC_MAX_PLANES)
+    return;
+
+  d->planes[d->n_planes++] = ~(end ^ videocrc_shift (k, start, len) ^
+      videocrc_shift (k, k->init, len));
+}
+
+/* TRUE when @next is the second component of the same interleaved rows as
+ * @plane, Cr after Cb in NV12 */
+static gboolean
+gst_videocrc_plane_follows (const VideocrcPlane * plane,
+    const VideocrcPlane * next)
+{
+  return plane->step > 1 && next->step == plane->step &&
+      next->data == plane->data + 1 && next->stride == plane->stride &&
+      next->width == plane->width && next->height == plane->height;
+}
+
+/* running CRC of @plane walked in bands that fit the cache, each band going
+ * through the streamed digests right after the CRC; @follower, if any, is
+ * hashed from the same band into @follower_crc so that its rows are not read
+ * from memory a second time */
+static guint32
+gst_videocrc_hash_fused (GstVideocrc * videocrc, guint32 crc,
+    const VideocrcPlane * plane, guint32 stats_width, VideocrcLumaStats * stats,
+    const VideocrcPlane * follower, guint32 * follower_crc)
+{
+  const VideocrcKernel *k = &videocrc->kernel;
+  VideocrcPlane band;
+  gsize row_bytes = (gsize) plane->width * plane->step;
+  guint32 y, rows, band_rows, r;
+  const guint8 *row;
+
+  band_rows = MAX (GST_VIDEOCRC_DIGEST_BLOCK / MAX (row_bytes, 1), 1);
+  for (y = 0; y < plane->height; y += rows) {
+    rows = MIN (band_rows, plane->height - y);
+    band = videocrc_plane_band (plane, y, rows);
+    crc = videocrc_plane_update_stats (k, crc, &band, stats_width, stats);
+    if (follower) {
+      band = videocrc_plane_band (follower, y, rows);
+      *follower_crc = videocrc_plane_update (k, *follower_crc, &band);
+    }
+    row = plane->data + (gsize) y * plane->stride;
+    for (r = 0; r < rows; r++, row += plane->stride)
+      gst_videocrc_digests_update (&videocrc->digest, row, row_bytes);
+  }
+
+  return crc;
+}
+
+/* a frame mapped as one buffer, hashed flat: the luma rows of raw video go
+ * through the detector on the way and with digests=planes every plane's span
+ * in memory gets a CRC of its own */
+static guint32
+gst_videocrc_hash_raw (GstVideocrc * videocrc, guint32 crc,
+    const guint8 * data, gsize size)
+{
+  const GstVideoInfo *info = &videocrc->info;
+  VideocrcPlane planes[VIDEOCRC_MAX_PLANES], rows;
+  gsize pos = 0, span = 0, end;
+  guint p, n_spans = 1;
+  guint32 start = crc;
+
+  if ((videocrc->digest.digests & GST_VIDEOCRC_DIGEST_PLANES) &&
+      videocrc->format != GST_VIDEO_FORMAT_UNKNOWN &&
+      size >= GST_VIDEO_INFO_SIZE (info))
+    n_spans = GST_VIDEO_INFO_N_PLANES (info);
+
+  /* the luma rows are hashed whole with their padding so the CRC stays the
+   * one of the flat buffer */
+  if (videocrc->detect && gst_videocrc_info_planes (videocrc, data, size,
+          planes) > 0) {
+    rows = planes[0];
+    rows.width = rows.stride;
+    if (videocrc->digest.digests & GST_VIDEOCRC_DIGEST_STREAMED)
+      crc = gst_videocrc_hash_fused (videocrc, crc, &rows, planes[0].width,
+          &videocrc->luma, NULL, NULL);
+    else
+      crc = gst_videocrc_pool_plane_update_stats (videocrc->pool,
+          &videocrc->kernel, crc, &rows, videocrc->hash_threads,
+          planes[0].width, &videocrc->luma);
+    pos = (gsize) rows.stride * rows.height;
+  }
+
+  for (p = 0; p < n_spans; p++) {
+    end = p + 1 < n_spans ? GST_VIDEO_INFO_PLANE_OFFSET (info, p + 1) : size;
+    end = CLAMP (end, pos, size);
+    crc = gst_videocrc_hash_flat (videocrc, crc, data + pos, end - pos);
+    if (n_spans > 1)
+      gst_videocrc_digest_plane (videocrc, start, crc, end - span);
+    start = crc;
+    span = pos = end;
+  }
+
+  return crc;
+}
+
+/* CRC of @planes as the ION path walks them, or the fingerprint of the
+ * first one (the luma) with algorithm=fingerprint; returns the bytes read */
+static guint64
+gst_videocrc_hash_planes (GstVideocrc * videocrc,
+    const GstVideocrcConfig * config, guint32 frame, VideocrcPlane * planes,
+    guint n_planes, guint32 * crc)
+{
+  const VideocrcKernel *k = &videocrc->kernel;
+  guint64 bytes = 0;
+  guint p, plane_bytes;
+  guint32 raw, next_crc = 0;
+  gboolean streamed, joined = FALSE;
+  VideocrcLumaStats *stats;
+
+  if (gst_videocrc_has_roi (config))
+    videocrc_planes_crop (planes, n_planes, config->roi_x, config->roi_y,
+        config->roi_width, config->roi_height);
+
+  if (config->algorithm == GST_VIDEOCRC_ALGORITHM_FINGERPRINT) {
+    plane_bytes = planes[0].width * planes[0].height;
+    GST_VIDEOCRC_PROBE3 (hash__start, frame, 0, plane_bytes);
+    videocrc_fingerprint (&planes[0], config->fingerprint_bits,
+        &videocrc->fingerprint);
+    *crc = videocrc->fingerprint.bits[0] >> 32;
+    GST_VIDEOCRC_PROBE4 (hash__end, frame, 0, plane_bytes, *crc);
+    return plane_bytes;
+  }
+
+  streamed = (videocrc->digest.digests & GST_VIDEOCRC_DIGEST_STREAMED) != 0;
+  for (p = 0; p < n_planes; p++) {
+    plane_bytes = planes[p].width * planes[p].height;
+    stats = (p == 0 && videocrc->detect) ? &videocrc->luma : NULL;
+    GST_VIDEOCRC_PROBE3 (hash__start, frame, p, plane_bytes);
+    if (joined) {
+      /* hashed from 0 along with the plane before */
+      raw = videocrc_combine (k, *crc, next_crc, plane_bytes);
+      joined = FALSE;
+    } else if (streamed) {
+      joined = p + 1 < n_planes &&
+          gst_videocrc_plane_follows (&planes[p], &planes[p + 1]);
+      next_crc = 0;
+      raw = gst_videocrc_hash_fused (videocrc, *crc, &planes[p],
+          planes[p].width, stats, joined ? &planes[p + 1] : NULL, &next_crc);
+    } else {
+      raw = gst_videocrc_pool_plane_update_stats (videocrc->pool, k, *crc,
+          &planes[p], videocrc->hash_threads, planes[p].width, stats);
+    }
+    gst_videocrc_digest_plane (videocrc, *crc, raw, plane_bytes);
+    *crc = ~raw;
+    GST_VIDEOCRC_PROBE4 (hash__end, frame, p, plane_bytes, *crc);
+    bytes += plane_bytes;
+  }
+
+  return bytes;
+}
+
+static gboolean
+gst_videocrc_unit_excluded (GstVideocrc * videocrc, const VideocrcUnit * unit)
+{
+  return (unit->kind == VIDEOCRC_UNIT_SEI &&
+      (videocrc->exclude & GST_VIDEOCRC_EXCLUDE_SEI)) ||
+      (unit->kind == VIDEOCRC_UNIT_AUD &&
+      (videocrc->exclude & GST_VIDEOCRC_EXCLUDE_AUD));
+}
+
+/* running CRC of the units of an encoded buffer that are not excluded,
+ * the units go to videocrc->units to be logged later */
+static guint32
+gst_videocrc_hash_units (GstVideocrc * videocrc, guint32 crc,
+    const guint8 * data, gsize size)
+{
+  const VideocrcKernel *k = &videocrc->kernel;
+  VideocrcUnit unit;
+  gsize pos = 0;
+
+  while ((pos = videocrc_unit_next (k, videocrc->codec, data, size, pos,
+              &unit)) != 0) {
+    if (unit.size == 0)
+      continue;
+    g_array_append_val (videocrc->units, unit);
+    if (gst_videocrc_unit_excluded (videocrc, &unit))
+      continue;
+    /* the unit was hashed from the initial value, join it as if from 0 */
+    crc = videocrc_combine (k, crc,
+        ~unit.crc ^ videocrc_shift (k, k->init, unit.size), unit.size);
+  }
+
+  return crc;
+}
+
+static void
+gst_videocrc_log_units (GstVideocrc * videocrc)
+{
+  const VideocrcUnit *unit;
+  gboolean excluded;
+  guint i;
+
+  for (i = 0; i < videocrc->units->len; i++) {
+    unit = &g_array_index (videocrc->units, VideocrcUnit, i);
+    excluded = gst_videocrc_unit_excluded (videocrc, unit);
+    GST_LOG_OBJECT (videocrc, "VideoFrame %d unit %u type %u size %"
+        G_GSIZE_FORMAT " crc %08X%s", videocrc->frame_num, i, unit->type,
+        unit->size, unit->crc, excluded ? " excluded" : "");
+    if (videocrc->logfile)
+      gst_videocrc_log_line (videocrc, "VideoFrame %d unit %u type %u size %"
+          G_GSIZE_FORMAT " crc %08X%s\n", videocrc->frame_num, i, unit->type,
+          unit->size, unit->crc, excluded ? " excluded" : "");
+  }
+}
+
+/* TRUE when the buffer is hashed as plain bytes, without a layout */
+static gboolean
+gst_videocrc_hashes_flat (GstVideocrc * videocrc,
+    const GstVideocrcConfig * config)
+{
+  return videocrc->plan_flat && !gst_videocrc_has_roi (config) &&
+      config->algorithm != GST_VIDEOCRC_ALGORITHM_FINGERPRINT;
+}
+
+/* the memories of @buf back to back, each mapped on its own since mapping
+ * the buffer would merge them into a copy first */
+static guint32
+gst_videocrc_hash_memories (GstVideocrc * videocrc, GstBuffer * buf,
+    guint32 crc, guint64 * bytes)
+{
+  GstMapInfo map_info;
+  GstMemory *mem;
+  guint i, n = gst_buffer_n_memory (buf);
+
+  *bytes = 0;
+  for (i = 0; i < n; i++) {
+    mem = gst_buffer_peek_memory (buf, i);
+    if (!gst_memory_map (mem, &map_info, GST_MAP_READ)) {
+      GST_WARNING_OBJECT (videocrc, "could not map memory %u", i);
+      continue;
+    }
+    crc = gst_videocrc_hash_flat (videocrc, crc, map_info.data,
+        map_info.size);
+    *bytes += map_info.size;
+    gst_memory_unmap (mem, &map_info);
+  }
+
+  return crc;
+}
+
+static gboolean
+gst_videocrc_query (GstBaseTransform * trans, GstPadDirection direction,
+    GstQuery * query)
+{
+  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
+
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CUSTOM) {
+    const GstStructure *s = gst_query_get_structure (query);
+
+    if (s && gst_structure_has_name (s, GST_VIDEOCRC_STATS_NAME)) {
+      gst_videocrc_fill_stats (videocrc, gst_query_writable_structure (query));
+      return TRUE;
+    }
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->query (trans, direction,
+      query);
+}
+
+/* a part of a frame pushed slice by slice: it continues the running CRC
+ * as it arrives, while the rest is still being decoded, and the frame is
+ * logged when the part flagged MARKER lands; the CRC is the one of the
+ * assembled frame hashed as plain bytes */
+static GstFlowReturn
+gst_videocrc_transform_part (GstVideocrc * videocrc, GstBuffer * buf)
+{
+  const GstVideocrcConfig *config;
+  gchar digests[GST_VIDEOCRC_DIGEST_STRLEN];
+  GstClockTime t_start, t_end;
+  const gchar *verdict;
+  guint64 bytes;
+  guint distance, n_parts;
+
+  if (videocrc->part_count == 0) {
+    config = gst_videocrc_config_acquire (videocrc);
+    if (!gst_videocrc_config_wants (videocrc, config))
+      videocrc->part_state = GST_VIDEOCRC_PART_IGNORED;
+    else if (!gst_videocrc_qos_hash (videocrc, buf))
+      videocrc->part_state = GST_VIDEOCRC_PART_SKIPPED;
+    else
+      videocrc->part_state = GST_VIDEOCRC_PART_HASHED;
+    videocrc->part_crc = videocrc->kernel.init;
+    videocrc->part_bytes = 0;
+    videocrc->part_ns = 0;
+    if (videocrc->part_state == GST_VIDEOCRC_PART_HASHED) {
+      gst_videocrc_digests_begin (&videocrc->digest);
+      /* the parts of a frame share one tuning, calibrated apart from whole
+       * frames as parts are hashed from smaller memories */
+      gst_videocrc_tune_prepare (videocrc, "parts");
+    }
+  }
+  n_parts = ++videocrc->part_count;
+
+  if (videocrc->part_state == GST_VIDEOCRC_PART_HASHED) {
+    t_start = gst_util_get_timestamp ();
+    videocrc->part_crc = gst_videocrc_hash_memories (videocrc, buf,
+        videocrc->part_crc, &bytes);
+    videocrc->part_bytes += bytes;
+    videocrc->part_ns += gst_util_get_timestamp () - t_start;
+  }
+  if (!GST_BUFFER_FLAG_IS_SET (buf, GST_VIDEO_BUFFER_FLAG_MARKER))
+    return GST_FLOW_OK;
+
+  videocrc->part_count = 0;
+  if (videocrc->part_state == GST_VIDEOCRC_PART_IGNORED) {
+    gst_videocrc_ignore_frame (videocrc);
+    return GST_FLOW_OK;
+  }
+  if (videocrc->part_state == GST_VIDEOCRC_PART_SKIPPED) {
+    gst_videocrc_skip_frame (videocrc, buf);
+    return GST_FLOW_OK;
+  }
+
+  gst_videocrc_tune_record (videocrc, videocrc->part_ns);
+  t_start = gst_util_get_timestamp ();
+  videocrc->crc = ~videocrc->part_crc;
+  videocrc->fingerprint.n_bits = 0;
+  gst_videocrc_digests_end (&videocrc->digest);
+  videocrc->frame_num++;
+  verdict = gst_videocrc_verify (videocrc, &distance) ? "" : " mismatch";
+  gst_videocrc_digests_to_string (&videocrc->digest, digests);
+  GST_INFO_OBJECT (videocrc, "VideoFrame %d crc %08X%s, %u parts",
+      videocrc->frame_num, videocrc->crc, digests, n_parts);
+  if (videocrc->logfile)
+    gst_videocrc_log_crc (videocrc, verdict, 0, "", "", digests);
+  gst_videocrc_publish (videocrc, buf, t_start, videocrc->crc, 0);
+  t_end = gst_util_get_timestamp ();
+  gst_videocrc_qos_cost (videocrc, videocrc->part_ns + (t_end - t_start));
+
+  gst_videocrc_update_stats (videocrc, videocrc->part_bytes, 0,
+      videocrc->part_ns, t_end - t_start, NULL);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn gst_videocrc_transform_frame_ip (GstBaseTransform * trans,
+        GstBuffer * buf)
+{
+  gint width, height, stride_w, stride_h;
+  GstMapInfo map_info;
+  const guint8 *data;
+  gsize data_size;
+  guint32 CRC;
+  guint size, offset, fd;
+  guint8 *buf_ptr;
+  GstClockTime t_start, t_mapped, t_hashed, t_unmapped, t_end;
+  guint64 bytes;
+  guint64 perf_delta[GST_VIDEOCRC_PERF_N];
+  gboolean perf;
+  guint32 frame;
+  VideocrcPlane planes[VIDEOCRC_MAX_PLANES];
+  guint n_planes, distance, alarms;
+  gchar hex[VIDEOCRC_FINGERPRINT_STRLEN];
+  const gchar *verdict;
+  gchar digests[GST_VIDEOCRC_DIGEST_STRLEN];
+  gchar views[GST_VIDEOCRC_MULTIVIEW_STRLEN];
+  gchar latency[GST_VIDEOCRC_LATENCY_STRLEN];
+
+  GstVideocrc * videocrc = GST_VIDEOCRC (trans);
+  const VideocrcKernel *kernel = &videocrc->kernel;
+  const GstVideocrcConfig *config;
+
+  if (videocrc->subframes)
+    return gst_videocrc_transform_part (videocrc, buf);
+  gst_videocrc_multiview_begin (&videocrc->multiview, buf);
+
+  config = gst_videocrc_config_acquire (videocrc);
+  if (!gst_videocrc_config_wants (videocrc, config)) {
+    gst_videocrc_ignore_frame (videocrc);
+    return GST_FLOW_OK;
+  }
+
+  if (!gst_videocrc_qos_hash (videocrc, buf)) {
+    gst_videocrc_skip_frame (videocrc, buf);
+    return GST_FLOW_OK;
+  }
+
+  CRC = kernel->init;
   videocrc->crc = 0;
+  videocrc->fingerprint.n_bits = 0;
+  memset (&videocrc->luma, 0, sizeof (VideocrcLumaStats));
+  g_array_set_size (videocrc->units, 0);
+  gst_videocrc_digests_begin (&videocrc->digest);
 
   width = videocrc->width;
   height = videocrc->height;
   stride_w = videocrc->stride_w;
   stride_h = videocrc->stride_h;
+  frame = videocrc->frame_num + 1;
+
+  perf = gst_videocrc_perf_prepare (videocrc);
+  t_start = gst_util_get_timestamp ();
+  GST_VIDEOCRC_PROBE1 (map__start, frame);
 
   GstIonBufFdMeta *ion_meta;
   ion_meta = gst_buffer_get_ionfd_meta (buf);
@@ -257,65 +2865,199 @@ static GstFlowReturn gst_videocrc_transform_frame_ip (GstBaseTransform * trans,
     offset = ion_meta->offset;
     buf_ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED,
             fd, offset);
-
-    /* compute Luma CRC */
-    for (i = 0; i < height; i++) {
-        for (j = 0, k = 0; j < width >> 1; j++) {
-            LumaPixVal1 = buf_ptr[i * stride_w + k++];
-            LumaPixVal2 = buf_ptr[i * stride_w + k++];
-            crc_pos = ((guint32) (CRC >> 24) ^ LumaPixVal1) & 0xFF;
-            CRC = (CRC << 8) ^ CRC32Table[crc_pos];
-            crc_pos = ((guint32) (CRC >> 24) ^ LumaPixVal2) & 0xFF;
-            CRC = (CRC << 8) ^ CRC32Table[crc_pos];
-        }
-    }
-    CRC = ~CRC;
-
-    /* compute Chroma U CRC */
-    for (i = 0; i < height / 2; i++) {
-        for (j = 0; j < width; j += 2) {
-            CbPixVal = buf_ptr[stride_w * stride_h + i * stride_w + j];
-            crc_pos = ((guint32) (CRC >> 24) ^ CbPixVal) & 0xFF;
-            CRC = (CRC << 8) ^ CRC32Table[crc_pos];
-        }
-    }
-    CRC = ~CRC;
-
-    /* compute Chroma V CRC */
-    for (i = 0; i < height / 2; i++) {
-        for (j = 0; j < width; j += 2) {
-            CrPixVal = buf_ptr[stride_w * stride_h + i * stride_w + j + 1];
-            crc_pos = ((guint32) (CRC >> 24) ^ CrPixVal) & 0xFF;
-            CRC = (CRC << 8) ^ CRC32Table[crc_pos];
-        }
-    }
-    CRC = ~CRC;
+    GST_VIDEOCRC_PROBE2 (map__end, frame, size);
+    gst_videocrc_tune_prepare (videocrc, "ion");
+    t_mapped = gst_util_get_timestamp ();
+    perf = gst_videocrc_perf_start (videocrc, perf);
+
+    /* Luma, then Cb and Cr of the interleaved chroma plane */
+    n_planes = videocrc_nv12_planes (planes, buf_ptr, width, height,
+        stride_w, stride_h);
+    bytes = gst_videocrc_hash_planes (videocrc, config, frame, planes,
+        n_planes, &CRC);
+    perf = gst_videocrc_perf_stop (videocrc, perf, perf_delta);
+    t_hashed = gst_util_get_timestamp ();
     munmap (buf_ptr, size);
+    t_unmapped = gst_util_get_timestamp ();
+  }
+  else if (gst_videocrc_hashes_flat (videocrc, config)) {
+    /* mapping the memories directly skips the buffer map bookkeeping,
+     * which costs as much as hashing a thumbnail */
+    GST_VIDEOCRC_PROBE2 (map__end, frame, gst_buffer_get_size (buf));
+    gst_videocrc_tune_prepare (videocrc, "system");
+    t_mapped = gst_util_get_timestamp ();
+    perf = gst_videocrc_perf_start (videocrc, perf);
+    GST_VIDEOCRC_PROBE3 (hash__start, frame, 0, gst_buffer_get_size (buf));
+    CRC = ~gst_videocrc_hash_memories (videocrc, buf, CRC, &bytes);
+    GST_VIDEOCRC_PROBE4 (hash__end, frame, 0, bytes, CRC);
+    perf = gst_videocrc_perf_stop (videocrc, perf, perf_delta);
+    t_hashed = t_unmapped = gst_util_get_timestamp ();
   }
   else {
     //omxencoder output non ion buffer
     size = videocrc->size;
-    gst_buffer_map (buf, &map_info, GST_MAP_READ); 
-    for (i = 0; i < map_info.size; i++) {
-      CRC = (CRC << 8) ^ CRC32Table[(CRC >> 24) ^ map_info.data[i]];
+    data = gst_videocrc_contiguous (videocrc, buf, &map_info, &data_size);
+    GST_VIDEOCRC_PROBE2 (map__end, frame, data_size);
+    gst_videocrc_tune_prepare (videocrc, "system");
+    t_mapped = gst_util_get_timestamp ();
+    perf = gst_videocrc_perf_start (videocrc, perf);
+    /* encoded buffers have no planes and are always CRCed */
+    n_planes = 0;
+    if (gst_videocrc_has_roi (config) ||
+        config->algorithm == GST_VIDEOCRC_ALGORITHM_FINGERPRINT)
+      n_planes = gst_videocrc_info_planes (videocrc, data, data_size,
+          planes);
+    if (n_planes > 0) {
+      bytes = gst_videocrc_hash_planes (videocrc, config, frame, planes,
+          n_planes, &CRC);
+    } else if (videocrc->granularity == GST_VIDEOCRC_GRANULARITY_NAL &&
+        videocrc->codec != VIDEOCRC_CODEC_NONE) {
+      GST_VIDEOCRC_PROBE3 (hash__start, frame, 0, data_size);
+      CRC = ~gst_videocrc_hash_units (videocrc, CRC, data, data_size);
+      /* still in the cache, encoded buffers are small */
+      gst_videocrc_digests_update (&videocrc->digest, data, data_size);
+      GST_VIDEOCRC_PROBE4 (hash__end, frame, 0, data_size, CRC);
+      bytes = data_size;
+    } else if (videocrc->multiview.n_planes > 0) {
+      GST_VIDEOCRC_PROBE3 (hash__start, frame, 0, data_size);
+      CRC = ~gst_videocrc_multiview_hash (&videocrc->multiview,
+          &videocrc->kernel, CRC, data, data_size);
+      gst_videocrc_digests_update (&videocrc->digest, data, data_size);
+      GST_VIDEOCRC_PROBE4 (hash__end, frame, 0, data_size, CRC);
+      bytes = data_size;
+    } else {
+      GST_VIDEOCRC_PROBE3 (hash__start, frame, 0, data_size);
+      CRC = ~gst_videocrc_hash_raw (videocrc, CRC, data, data_size);
+      GST_VIDEOCRC_PROBE4 (hash__end, frame, 0, data_size, CRC);
+      bytes = data_size;
     }
-    CRC = ~CRC;
-    gst_buffer_unmap (buf, &map_info);
+    perf = gst_videocrc_perf_stop (videocrc, perf, perf_delta);
+    t_hashed = gst_util_get_timestamp ();
+    gst_videocrc_contiguous_done (buf, &map_info);
+    t_unmapped = gst_util_get_timestamp ();
   }
+  if (videocrc->fingerprint.n_bits == 0)
+    gst_videocrc_tune_record (videocrc, t_hashed - t_mapped);
 
   videocrc->crc = CRC;
+  gst_videocrc_digests_end (&videocrc->digest);
 
   videocrc->frame_num ++;
-  /* print this info using --gst-debug=videocrc:4 */
-  GST_INFO_OBJECT (videocrc, "VideoFrame %d crc %08X",
-     videocrc->frame_num, videocrc->crc);
-  if (videocrc->logfile)
-    fprintf (videocrc->logfile, "VideoFrame %d crc %08X\n",
-          videocrc->frame_num, videocrc->crc);
+  GST_VIDEOCRC_PROBE2 (log__start, frame, CRC);
+  verdict = gst_videocrc_verify (videocrc, &distance) ? "" : " mismatch";
+  alarms = 0;
+  if (videocrc->detect && videocrc->fingerprint.n_bits == 0)
+    alarms = gst_videocrc_detect (videocrc);
+  gst_videocrc_latency_tap (videocrc, bytes, t_start, latency);
+  if (videocrc->fingerprint.n_bits) {
+    videocrc_fingerprint_to_string (&videocrc->fingerprint, hex);
+    GST_INFO_OBJECT (videocrc, "VideoFrame %d fingerprint %s%s",
+        videocrc->frame_num, hex, latency);
+    if (videocrc->logfile && distance != G_MAXUINT)
+      gst_videocrc_log_line (videocrc, "VideoFrame %d fingerprint %s distance "
+          "%u%s%s\n", videocrc->frame_num, hex, distance, verdict, latency);
+    else if (videocrc->logfile)
+      gst_videocrc_log_line (videocrc, "VideoFrame %d fingerprint %s%s\n",
+          videocrc->frame_num, hex, latency);
+    gst_videocrc_publish (videocrc, buf, t_unmapped, videocrc->crc,
+        VIDEOCRC_SHM_FLAG_FINGERPRINT);
+  } else {
+    gst_videocrc_log_units (videocrc);
+    gst_videocrc_digests_to_string (&videocrc->digest, digests);
+    gst_videocrc_multiview_to_string (&videocrc->multiview, views);
+    /* print this info using --gst-debug=videocrc:4, nothing is formatted
+     * at lower levels */
+    GST_INFO_OBJECT (videocrc, "VideoFrame %d crc %08X%s%s%s",
+       videocrc->frame_num, videocrc->crc, views, latency, digests);
+    if (videocrc->logfile)
+      gst_videocrc_log_crc (videocrc, verdict, alarms, views, latency,
+          digests);
+    gst_videocrc_publish (videocrc, buf, t_unmapped, videocrc->crc, 0);
+  }
+  GST_VIDEOCRC_PROBE2 (log__end, frame, CRC);
+  t_end = gst_util_get_timestamp ();
+  gst_videocrc_qos_cost (videocrc, t_end - t_start);
+
+  gst_videocrc_update_stats (videocrc, bytes,
+      (t_mapped - t_start) + (t_unmapped - t_hashed), t_hashed - t_mapped,
+      t_end - t_unmapped, perf ? perf_delta : NULL);
 
   return GST_FLOW_OK;
 }
 
+/* in passthrough the buffers of a list go through transform_ip one after
+ * the other and downstream as one list; the base class would split the
+ * list and push every buffer on its own. Per buffer this does what the
+ * base class does around transform_ip: controller sync, before_transform
+ * and the segment position. The first flow error stops the list, the
+ * buffers handled before it are still pushed. */
+static GstFlowReturn
+gst_videocrc_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM (parent);
+  GstBaseTransformClass *klass = GST_BASE_TRANSFORM_GET_CLASS (trans);
+  GstVideocrc *videocrc = GST_VIDEOCRC (parent);
+  GstPadChainFunction chain = GST_PAD_CHAINFUNC (pad);
+  GstFlowReturn ret = GST_FLOW_OK, push_ret;
+  GstClockTime timestamp, position = GST_CLOCK_TIME_NONE;
+  GstBuffer *buf;
+  guint i, len = gst_buffer_list_length (list);
+
+  /* negotiation, renegotiation and in-place transforms are left to the
+   * base class */
+  if (!gst_pad_has_current_caps (pad) ||
+      gst_pad_needs_reconfigure (GST_BASE_TRANSFORM_SRC_PAD (trans)) ||
+      !gst_base_transform_is_passthrough (trans)) {
+    for (i = 0; i < len && ret == GST_FLOW_OK; i++)
+      ret = chain (pad, parent, gst_buffer_ref (gst_buffer_list_get (list,
+                  i)));
+    gst_buffer_list_unref (list);
+    return ret;
+  }
+
+  for (i = 0; i < len && ret == GST_FLOW_OK; i++) {
+    buf = gst_buffer_list_get (list, i);
+    timestamp = GST_BUFFER_TIMESTAMP (buf);
+    if (GST_CLOCK_TIME_IS_VALID (timestamp))
+      gst_object_sync_values (GST_OBJECT (trans),
+          gst_segment_to_stream_time (&trans->segment, GST_FORMAT_TIME,
+              timestamp));
+    if (klass->before_transform)
+      klass->before_transform (trans, buf);
+    ret = gst_videocrc_transform_frame_ip (trans, buf);
+    if (ret == GST_FLOW_OK && GST_CLOCK_TIME_IS_VALID (timestamp))
+      position = timestamp + (GST_BUFFER_DURATION_IS_VALID (buf) ?
+          GST_BUFFER_DURATION (buf) : 0);
+  }
+  if (videocrc->logfile)
+    gst_videocrc_log_flush (videocrc);
+  GST_LOG_OBJECT (videocrc, "handled %u of a list of %u buffers", i, len);
+
+  if (ret != GST_FLOW_OK) {
+    GST_DEBUG_OBJECT (videocrc, "buffer %u returned %s", i - 1,
+        gst_flow_get_name (ret));
+    /* the failed buffer and the ones after it are not pushed */
+    list = gst_buffer_list_make_writable (list);
+    gst_buffer_list_remove (list, i - 1, len - i + 1);
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (position) &&
+      trans->segment.format == GST_FORMAT_TIME) {
+    GST_OBJECT_LOCK (trans);
+    trans->segment.position = position;
+    GST_OBJECT_UNLOCK (trans);
+  }
+
+  if (gst_buffer_list_length (list) == 0) {
+    gst_buffer_list_unref (list);
+    return ret;
+  }
+  push_ret = gst_pad_push_list (GST_BASE_TRANSFORM_SRC_PAD (trans), list);
+
+  return ret != GST_FLOW_OK ? ret : push_ret;
+}
+
 static gboolean
 gst_videocrc_set_location (GstVideocrc * videocrc, const gchar * location)
 {
@@ -363,7 +3105,103 @@ gst_videocrc_set_property (GObject * object, guint prop_id,
       gst_videocrc_set_location (videocrc, g_value_get_string (value));
       break;
     case PROP_CRC_MASK:
-      videocrc->crc_mask = g_value_get_uint (value);
+    case PROP_ALGORITHM:
+    case PROP_ENABLED:
+    case PROP_ROI_X:
+    case PROP_ROI_Y:
+    case PROP_ROI_WIDTH:
+    case PROP_ROI_HEIGHT:
+    case PROP_SAMPLE_INTERVAL:
+    case PROP_FINGERPRINT_BITS:
+      gst_videocrc_config_set (videocrc, prop_id, value);
+      break;
+    case PROP_REFERENCE:
+      g_free (videocrc->reference_path);
+      videocrc->reference_path = g_value_dup_string (value);
+      break;
+    case PROP_REFERENCE_STORE:
+      g_free (videocrc->reference_store);
+      videocrc->reference_store = g_value_dup_string (value);
+      break;
+    case PROP_MAX_DISTANCE:
+      videocrc->max_distance = g_value_get_uint (value);
+      break;
+    case PROP_DETECT:
+      videocrc->detect = g_value_get_boolean (value);
+      break;
+    case PROP_BLACK_LEVEL:
+      videocrc->detector.black_level = g_value_get_uint (value);
+      break;
+    case PROP_FROZEN_FRAMES:
+      videocrc->detector.frozen_frames = g_value_get_uint (value);
+      break;
+    case PROP_HISTORY_SIZE:
+      videocrc->history_size = g_value_get_uint (value);
+      break;
+    case PROP_ENCODED_GRANULARITY:
+      videocrc->granularity = g_value_get_enum (value);
+      break;
+    case PROP_ENCODED_EXCLUDE:
+      videocrc->exclude = g_value_get_flags (value);
+      break;
+    case PROP_DIGESTS:
+      videocrc->digests = g_value_get_flags (value);
+      break;
+    case PROP_HASH_CHAIN:
+      videocrc->hash_chain = g_value_get_boolean (value);
+      break;
+    case PROP_HASH_CHAIN_INTERVAL:
+      videocrc->chain_interval = g_value_get_uint (value);
+      break;
+    case PROP_SUBFRAMES:
+      videocrc->subframes = g_value_get_boolean (value);
+      break;
+    case PROP_LATENCY_GROUP:
+      g_free (videocrc->latency_group);
+      videocrc->latency_group = g_value_dup_string (value);
+      break;
+    case PROP_LATENCY_TAP:
+      videocrc->latency_tap = g_value_get_enum (value);
+      break;
+    case PROP_MERKLE_INDEX:
+      g_free (videocrc->merkle_index);
+      videocrc->merkle_index = g_value_dup_string (value);
+      break;
+    case PROP_PERF_COUNTERS:
+      videocrc->perf_counters = g_value_get_boolean (value);
+      break;
+    case PROP_SHM_NAME:
+    {
+      const gchar *name = g_value_get_string (value);
+
+      g_free (videocrc->shm_name);
+      /* POSIX wants a single leading slash */
+      if (name == NULL)
+        videocrc->shm_name = NULL;
+      else if (name[0] == '/')
+        videocrc->shm_name = g_strdup (name);
+      else
+        videocrc->shm_name = g_strconcat ("/", name, NULL);
+      break;
+    }
+    case PROP_SOCKET_PATH:
+      g_free (videocrc->socket_path);
+      videocrc->socket_path = g_value_dup_string (value);
+      break;
+    case PROP_SOCKET_BATCH:
+      videocrc->socket_batch = g_value_get_uint (value);
+      break;
+    case PROP_AUTOTUNE:
+      videocrc->autotune = g_value_get_boolean (value);
+      break;
+    case PROP_N_THREADS:
+      videocrc->n_threads = g_value_get_uint (value);
+      break;
+    case PROP_CPU_BUDGET:
+      videocrc->cpu_budget = g_value_get_uint64 (value);
+      break;
+    case PROP_QOS_INTERVAL:
+      videocrc->qos_interval = g_value_get_uint (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -382,8 +3220,130 @@ gst_videocrc_get_property (GObject * object, guint prop_id,
       g_value_set_string (value, videocrc->filename);
       break;
     case PROP_CRC_MASK:
-      g_value_set_uint (value, videocrc->crc_mask);
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_uint (value, videocrc->config->polynomial);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_ALGORITHM:
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_enum (value, videocrc->config->algorithm);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_ENABLED:
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_boolean (value, videocrc->config->enabled);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_ROI_X:
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_uint (value, videocrc->config->roi_x);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_ROI_Y:
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_uint (value, videocrc->config->roi_y);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_ROI_WIDTH:
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_uint (value, videocrc->config->roi_width);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_ROI_HEIGHT:
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_uint (value, videocrc->config->roi_height);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_SAMPLE_INTERVAL:
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_uint (value, videocrc->config->sample_interval);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_FINGERPRINT_BITS:
+      GST_OBJECT_LOCK (videocrc);
+      g_value_set_uint (value, videocrc->config->fingerprint_bits);
+      GST_OBJECT_UNLOCK (videocrc);
+      break;
+    case PROP_REFERENCE:
+      g_value_set_string (value, videocrc->reference_path);
       break;
+    case PROP_REFERENCE_STORE:
+      g_value_set_string (value, videocrc->reference_store);
+      break;
+    case PROP_MAX_DISTANCE:
+      g_value_set_uint (value, videocrc->max_distance);
+      break;
+    case PROP_DETECT:
+      g_value_set_boolean (value, videocrc->detect);
+      break;
+    case PROP_BLACK_LEVEL:
+      g_value_set_uint (value, videocrc->detector.black_level);
+      break;
+    case PROP_FROZEN_FRAMES:
+      g_value_set_uint (value, videocrc->detector.frozen_frames);
+      break;
+    case PROP_HISTORY_SIZE:
+      g_value_set_uint (value, videocrc->history_size);
+      break;
+    case PROP_ENCODED_GRANULARITY:
+      g_value_set_enum (value, videocrc->granularity);
+      break;
+    case PROP_ENCODED_EXCLUDE:
+      g_value_set_flags (value, videocrc->exclude);
+      break;
+    case PROP_DIGESTS:
+      g_value_set_flags (value, videocrc->digests);
+      break;
+    case PROP_HASH_CHAIN:
+      g_value_set_boolean (value, videocrc->hash_chain);
+      break;
+    case PROP_HASH_CHAIN_INTERVAL:
+      g_value_set_uint (value, videocrc->chain_interval);
+      break;
+    case PROP_SUBFRAMES:
+      g_value_set_boolean (value, videocrc->subframes);
+      break;
+    case PROP_LATENCY_GROUP:
+      g_value_set_string (value, videocrc->latency_group);
+      break;
+    case PROP_LATENCY_TAP:
+      g_value_set_enum (value, videocrc->latency_tap);
+      break;
+    case PROP_MERKLE_INDEX:
+      g_value_set_string (value, videocrc->merkle_index);
+      break;
+    case PROP_PERF_COUNTERS:
+      g_value_set_boolean (value, videocrc->perf_counters);
+      break;
+    case PROP_SHM_NAME:
+      g_value_set_string (value, videocrc->shm_name);
+      break;
+    case PROP_SOCKET_PATH:
+      g_value_set_string (value, videocrc->socket_path);
+      break;
+    case PROP_SOCKET_BATCH:
+      g_value_set_uint (value, videocrc->socket_batch);
+      break;
+    case PROP_AUTOTUNE:
+      g_value_set_boolean (value, videocrc->autotune);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, videocrc->n_threads);
+      break;
+    case PROP_CPU_BUDGET:
+      g_value_set_uint64 (value, videocrc->cpu_budget);
+      break;
+    case PROP_QOS_INTERVAL:
+      g_value_set_uint (value, videocrc->qos_interval);
+      break;
+    case PROP_STATS:
+    {
+      GstStructure *s = gst_structure_new_empty (GST_VIDEOCRC_STATS_NAME);
+
+      gst_videocrc_fill_stats (videocrc, s);
+      g_value_take_boxed (value, s);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -400,6 +3360,8 @@ plugin_init (GstPlugin * plugin)
 
   ret = gst_element_register (plugin, "videocrc", GST_RANK_NONE,
       GST_TYPE_VIDEOCRC);
+  ret &= gst_element_register (plugin, "videocrcsink", GST_RANK_NONE,
+      GST_TYPE_VIDEOCRC_SINK);
 
   return ret;
 }
@@ -27,8 +27,138 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
+#include "videocrc.h"
+#include "gstvideocrcperf.h"
+#include "gstvideocrcpool.h"
+#include "gstvideocrctune.h"
+#include "gstvideocrcdetect.h"
+#include "gstvideocrcdigest.h"
+#include "gstvideocrcchain.h"
+#include "gstvideocrcmultiview.h"
+#include "gstvideocrclatency.h"
+#include "gstvideocrcmerkle.h"
+#include "gstvideocrcstore.h"
+#include "videocrc-shm.h"
+#include "videocrc-socket.h"
 
 G_BEGIN_DECLS
+
+#define GST_VIDEOCRC_STATS_WINDOW 1024   /* per-frame samples kept for percentiles */
+#define GST_VIDEOCRC_LOG_BATCH 4096      /* log bytes held back before a write */
+#define GST_VIDEOCRC_LOG_LINE 512        /* longest line formatted on the stack */
+#define GST_VIDEOCRC_MAX_UNITS 256       /* units of a buffer before units grows */
+
+/* layout of ION buffers, shared by videocrc and videocrcsink */
+#define GST_VIDEOCRC_ALIGN(num, to) (((num) + ((to) - 1)) & ~((to) - 1))
+#define GST_VIDEOCRC_ION_STRIDE 128      /* luma stride alignment */
+#define GST_VIDEOCRC_ION_SCANLINES 32    /* luma height alignment */
+
+/**
+ * GstVideocrcQosLevel:
+ * @GST_VIDEOCRC_QOS_FULL: every frame is hashed
+ * @GST_VIDEOCRC_QOS_SAMPLED: one frame in qos-sample-interval is hashed
+ * @GST_VIDEOCRC_QOS_SKIPPED: no frame is hashed
+ *
+ * How much hashing the element does under load. Frames that are not
+ * hashed are logged as skipped.
+ */
+typedef enum
+{
+  GST_VIDEOCRC_QOS_FULL,
+  GST_VIDEOCRC_QOS_SAMPLED,
+  GST_VIDEOCRC_QOS_SKIPPED
+} GstVideocrcQosLevel;
+
+typedef enum
+{
+  GST_VIDEOCRC_ALGORITHM_LEGACY,        /* MSB first with crc-mask, init 0 */
+  GST_VIDEOCRC_ALGORITHM_CRC32,         /* IEEE 802.3, reflected */
+  GST_VIDEOCRC_ALGORITHM_CRC32C,        /* Castagnoli, reflected */
+  GST_VIDEOCRC_ALGORITHM_FINGERPRINT    /* perceptual hash of the luma */
+} GstVideocrcAlgorithm;
+
+#define GST_TYPE_VIDEOCRC_ALGORITHM (gst_videocrc_algorithm_get_type ())
+GType gst_videocrc_algorithm_get_type (void);
+
+typedef enum
+{
+  GST_VIDEOCRC_GRANULARITY_BUFFER,      /* one CRC per encoded buffer */
+  GST_VIDEOCRC_GRANULARITY_NAL          /* and one per NAL unit or OBU */
+} GstVideocrcGranularity;
+
+#define GST_TYPE_VIDEOCRC_GRANULARITY (gst_videocrc_granularity_get_type ())
+GType gst_videocrc_granularity_get_type (void);
+
+typedef enum
+{
+  GST_VIDEOCRC_EXCLUDE_SEI = (1 << 0),  /* SEI and AV1 metadata */
+  GST_VIDEOCRC_EXCLUDE_AUD = (1 << 1)   /* access unit and temporal delimiters */
+} GstVideocrcExclude;
+
+#define GST_TYPE_VIDEOCRC_EXCLUDE (gst_videocrc_exclude_get_type ())
+GType gst_videocrc_exclude_get_type (void);
+
+#define GST_TYPE_VIDEOCRC_DIGEST (gst_videocrc_digest_get_type ())
+GType gst_videocrc_digest_get_type (void);
+
+#define GST_TYPE_VIDEOCRC_LATENCY_TAP (gst_videocrc_latency_tap_get_type ())
+GType gst_videocrc_latency_tap_get_type (void);
+
+/**
+ * GstVideocrcHistoryRecord:
+ * @pts: presentation timestamp, GST_CLOCK_TIME_NONE if the buffer had none
+ * @frame: frame number, as in the log
+ * @crc: CRC of the frame, first fingerprint bits for algorithm=fingerprint
+ *
+ * One hashed frame as returned by the get-history action signal, packed in
+ * host byte order.
+ */
+typedef struct
+{
+  guint64 pts;
+  guint32 frame;
+  guint32 crc;
+} GstVideocrcHistoryRecord;
+
+/* what becomes of the parts of the current frame with subframes */
+typedef enum
+{
+  GST_VIDEOCRC_PART_HASHED,
+  GST_VIDEOCRC_PART_SKIPPED,    /* left out under load, logged as such */
+  GST_VIDEOCRC_PART_IGNORED     /* not sampled */
+} GstVideocrcPartState;
+
+/* one line of a reference log */
+typedef struct
+{
+  gboolean valid;
+  gboolean is_fingerprint;
+  guint32 crc;
+  VideocrcFingerprint fingerprint;
+} GstVideocrcReference;
+
+/**
+ * GstVideocrcConfig:
+ *
+ * Immutable snapshot of the settings the streaming thread reads. Property
+ * writers edit a private copy under the object lock, build the CRC tables
+ * there and publish a new snapshot; the streaming thread takes it over at
+ * the start of the next frame without locking.
+ */
+typedef struct
+{
+  gboolean enabled;
+  GstVideocrcAlgorithm algorithm;
+  guint32 polynomial;           /* crc-mask, for the legacy algorithm */
+  guint roi_x;
+  guint roi_y;
+  guint roi_width;              /* 0 = to the right edge */
+  guint roi_height;             /* 0 = to the bottom edge */
+  guint sample_interval;        /* hash one frame in N */
+  guint fingerprint_bits;       /* 64 or 256 */
+  VideocrcKernel kernel;        /* tables for algorithm and polynomial */
+} GstVideocrcConfig;
+
 #define GST_TYPE_VIDEOCRC \
   (gst_videocrc_get_type())
 #define GST_VIDEOCRC(obj) \
@@ -58,21 +188,123 @@ struct _GstVideocrc
   guint stride_h;
   guint offset;
   guint size;
+  GstVideoFormat format;
+  GstVideoInfo info;
+  gboolean plan_flat;           /* per caps: plain bytes unless the config
+                                 * asks for a layout */
+  GstVideocrcMultiview multiview;       /* views of multiview caps */
+  guint8 *staging;              /* buffers of several memories copied whole
+                                 * for the paths that need them contiguous */
+  gsize staging_size;
   guint32 crc;           /* chroma CRC */
   gchar *filename;
   FILE *logfile;
+  GString *log_batch;           /* lines not written to logfile yet */
   guint32 frame_num;            /* video frame number */
   gboolean crc_message;         /* post message to app if TRUE */
-  guint32 crc_mask;             /* CRC POLYNOMIAL */
-  guint32 crc32bit_table[256];  /* pre computed CRC table */
+  GstVideocrcConfig *config;    /* writers' copy, under the object lock */
+  GstVideocrcConfig *pending;   /* published, not yet taken (atomic) */
+  GstVideocrcConfig *active;    /* owned by the streaming thread */
+  gint hash_frames;             /* frames to hash regardless (atomic) */
+  guint sample_count;           /* frames seen by sample-interval */
+  VideocrcKernel kernel;        /* pre computed CRC tables */
+  gboolean autotune;            /* calibrate engine, threads and chunk */
+  guint n_threads;              /* hashing threads, 0 = tuned */
+  guint hash_threads;           /* threads used for the current frame */
+  GstVideocrcPool *pool;        /* band workers when more than one thread */
+  GstVideocrcTuner tuner;
+  VideocrcFingerprint fingerprint;      /* of the last frame, n_bits 0 if
+                                         * it was CRCed */
+  gchar *reference_path;        /* log to verify against */
+  gchar *reference_store;       /* store to pick the reference from */
+  GstVideocrcStore store;
+  guint max_distance;           /* fingerprint bits allowed to differ */
+  GArray *reference;            /* GstVideocrcReference by frame - 1 */
+  gboolean detect;              /* black, frozen and duplicate alarms */
+  GstVideocrcDetector detector;
+  VideocrcLumaStats luma;       /* of the frame being hashed */
+  VideocrcCodec codec;          /* of encoded caps, NONE for raw video */
+  GstVideocrcGranularity granularity;
+  GstVideocrcExclude exclude;   /* units left out of the buffer CRC */
+  GArray *units;                /* VideocrcUnit of the current buffer */
+  guint digests;                /* GstVideocrcDigest next to the CRC */
+  GstVideocrcDigests digest;    /* of the current frame */
+  gboolean hash_chain;          /* chain every frame into a SHA-256 */
+  guint chain_interval;         /* frames between logged chain values */
+  GstVideocrcChain chain;
+  gchar *latency_group;         /* taps matching frames, NULL = none */
+  GstVideocrcLatencyTap latency_tap;
+  GstVideocrcLatency latency;   /* stats under stats_lock */
+  gchar *merkle_index;          /* Merkle index file, NULL = none */
+  GstVideocrcMerkle merkle;
+  gboolean subframes;           /* buffers are parts of frames */
+  guint part_count;             /* parts of the current frame so far */
+  GstVideocrcPartState part_state;
+  guint32 part_crc;             /* running CRC over its parts */
+  guint64 part_bytes;
+  guint64 part_ns;              /* spent hashing them */
+  guint history_size;           /* records kept, 0 = none */
+  GMutex history_lock;
+  GstVideocrcHistoryRecord *history;    /* ring of history_len records */
+  guint history_len;
+  guint64 history_count;        /* records ever written */
+  guint64 cpu_budget;           /* ns per frame, 0 = unlimited */
+  guint qos_interval;           /* hash one frame in N when sampled */
+  GstVideocrcQosLevel qos_level;
+  guint qos_frames;             /* frames since qos_level changed */
+  guint qos_calm;               /* consecutive frames fit for a level up */
+  guint64 qos_cost;             /* smoothed cost of a hashed frame, ns */
+  gdouble qos_proportion;       /* from QoS events, guarded by object lock */
+  GstClockTime qos_earliest;    /* running time downstream is late for */
+  gboolean perf_counters;       /* sample hardware counters around CRC */
+  gboolean perf_failed;         /* perf_event_open refused, don't retry */
+  guint perf_generation;        /* pool generation when counting began */
+  GstVideocrcPerf perf;         /* counter group of the streaming thread */
+  gchar *shm_name;              /* POSIX shared memory object name */
+  VideocrcShmHeader *shm;       /* live records for external monitors */
+  gchar *socket_path;           /* collector's SOCK_SEQPACKET socket */
+  guint socket_batch;           /* records per packet */
+  gint socket_fd;               /* non-blocking, -1 when not connected */
+  GstClockTime socket_retry;    /* earliest time for the next connect */
+  guint64 socket_dropped;       /* records the collector never got */
+  guint socket_count;           /* records pending in socket_packet */
+  VideocrcSockPacket socket_packet;     /* batch being filled */
+
+  /* timing statistics, guarded by stats_lock */
+  GMutex stats_lock;
+  guint64 stats_frames;         /* frames processed since start */
+  guint64 stats_bytes;          /* bytes fed to the CRC */
+  guint64 stats_map_ns;         /* accumulated map + unmap time */
+  guint64 stats_hash_ns;        /* accumulated CRC time */
+  guint64 stats_log_ns;         /* accumulated debug + file log time */
+  guint64 stats_total_ns;       /* accumulated per-frame time */
+  guint64 stats_max_ns;         /* slowest frame */
+  guint64 stats_skipped;        /* frames not hashed under load */
+  guint64 stats_verified;       /* frames compared with the reference */
+  guint64 stats_mismatches;     /* of which did not match */
+  guint64 stats_black;          /* frames flagged black */
+  guint64 stats_frozen;         /* frames flagged frozen */
+  guint64 stats_duplicate;      /* frames flagged duplicate */
+  guint64 stats_window[GST_VIDEOCRC_STATS_WINDOW]; /* recent per-frame times */
+  guint64 stats_perf_frames;    /* frames with hardware counter samples */
+  guint64 stats_perf_partial;   /* frames partly hashed by pool workers */
+  guint64 stats_perf[GST_VIDEOCRC_PERF_N]; /* accumulated counter deltas */
 };
 
 struct _GstVideocrcClass
 {
   GstVideoFilterClass parent_class;
+
+  /* actions */
+  void (*hash_frames) (GstVideocrc * videocrc, guint n_frames);
+  GBytes *(*get_history) (GstVideocrc * videocrc, guint64 start,
+      guint64 stop);
 };
 
 GType gst_videocrc_get_type (void);
 
+void gst_videocrc_build_kernel (VideocrcKernel * kernel,
+    GstVideocrcAlgorithm algorithm, guint32 polynomial);
+
 G_END_DECLS
 #endif /* __GST_VIDEOCRC_H__ */
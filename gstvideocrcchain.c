@@ -0,0 +1,118 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstvideocrcchain.h"
+
+static void
+gst_videocrc_chain_put64 (guint8 * p, guint64 v)
+{
+  gint i;
+
+  for (i = 7; i >= 0; i--, v >>= 8)
+    p[i] = v & 0xFF;
+}
+
+static void
+gst_videocrc_chain_put32 (guint8 * p, guint32 v)
+{
+  gint i;
+
+  for (i = 3; i >= 0; i--, v >>= 8)
+    p[i] = v & 0xFF;
+}
+
+void
+gst_videocrc_chain_to_hex (const guint8 * value, gchar * hex)
+{
+  static const gchar digits[] = "0123456789abcdef";
+  guint i;
+
+  for (i = 0; i < VIDEOCRC_SHA256_LEN; i++) {
+    *hex++ = digits[value[i] >> 4];
+    *hex++ = digits[value[i] & 0xF];
+  }
+  *hex = '\0';
+}
+
+void
+gst_videocrc_chain_init (GstVideocrcChain * chain, guint interval)
+{
+  videocrc_sha256_init (&chain->sha);
+  chain->interval = MAX (interval, 1);
+}
+
+/* fills the VIDEOCRC_SHA256_BLOCK bytes of @record for one frame;
+ * @fingerprint and @digests may be NULL */
+void
+gst_videocrc_chain_record (guint8 * record, guint64 frame, guint64 pts,
+    guint32 crc, guint32 flags, const VideocrcFingerprint * fingerprint,
+    const GstVideocrcDigests * digests)
+{
+  guint8 *digest = record + 24;
+  guint i;
+
+  memset (record, 0, VIDEOCRC_SHA256_BLOCK);
+  gst_videocrc_chain_put64 (record, frame);
+  gst_videocrc_chain_put64 (record + 8, pts);
+  gst_videocrc_chain_put32 (record + 16, crc);
+  gst_videocrc_chain_put32 (record + 20, flags);
+
+  if (fingerprint) {
+    for (i = 0; i < (fingerprint->n_bits + 63) / 64; i++)
+      gst_videocrc_chain_put64 (digest + 8 * i, fingerprint->bits[i]);
+  } else if (digests) {
+    gst_videocrc_chain_put64 (digest, digests->crc64);
+    gst_videocrc_chain_put64 (digest + 8, digests->xxh3);
+    for (i = 0; i < digests->n_planes && i < 4; i++)
+      gst_videocrc_chain_put32 (digest + 16 + 4 * i, digests->planes[i]);
+  }
+}
+
+/* chains one frame; @fingerprint and @digests may be NULL, returns TRUE when
+ * the chain value is due for the log */
+gboolean
+gst_videocrc_chain_add (GstVideocrcChain * chain, guint64 frame, guint64 pts,
+    guint32 crc, guint32 flags, const VideocrcFingerprint * fingerprint,
+    const GstVideocrcDigests * digests)
+{
+  guint8 record[VIDEOCRC_SHA256_BLOCK];
+
+  gst_videocrc_chain_record (record, frame, pts, crc, flags, fingerprint,
+      digests);
+  videocrc_sha256_block (&chain->sha, record);
+
+  return chain->sha.n_blocks % chain->interval == 0;
+}
+
+void
+gst_videocrc_chain_value (const GstVideocrcChain * chain, gchar * hex)
+{
+  guint8 value[VIDEOCRC_SHA256_LEN];
+
+  videocrc_sha256_chain_value (&chain->sha, value);
+  gst_videocrc_chain_to_hex (value, hex);
+}
+
+/* SHA-256 of every record so far, the chain can go on afterwards */
+void
+gst_videocrc_chain_final (const GstVideocrcChain * chain, gchar * hex)
+{
+  guint8 digest[VIDEOCRC_SHA256_LEN];
+
+  videocrc_sha256_final (&chain->sha, digest);
+  gst_videocrc_chain_to_hex (digest, hex);
+}
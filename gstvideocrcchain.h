@@ -0,0 +1,62 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_CHAIN_H__
+#define __GST_VIDEOCRC_CHAIN_H__
+
+#include <glib.h>
+#include "videocrc.h"
+#include "gstvideocrcdigest.h"
+
+G_BEGIN_DECLS
+
+/* hex chain value or digest with its terminator */
+#define GST_VIDEOCRC_CHAIN_STRLEN (VIDEOCRC_SHA256_LEN * 2 + 1)
+
+/**
+ * GstVideocrcChain:
+ *
+ * Tamper-evident chain over the frames: every frame is one 64-byte SHA-256
+ * block, so the running state after frame N depends on all frames up to N
+ * and the final value is the plain SHA-256 of the records. A record holds,
+ * big-endian:
+ *
+ *   0  frame number (64 bits)
+ *   8  PTS in ns, all ones when the buffer had none (64 bits)
+ *  16  CRC, first fingerprint bits for fingerprints (32 bits)
+ *  20  VIDEOCRC_SHM_FLAG_* (32 bits)
+ *  24  frame digest (32 bytes): the fingerprint, or CRC-64, XXH3 and four
+ *      plane CRCs as far as digests computes them, zero otherwise
+ *  56  zero (8 bytes)
+ */
+typedef struct
+{
+  VideocrcSha256 sha;
+  guint interval;               /* frames between logged chain values */
+} GstVideocrcChain;
+
+void     gst_videocrc_chain_init  (GstVideocrcChain * chain, guint interval);
+void     gst_videocrc_chain_record (guint8 * record, guint64 frame,
+                                   guint64 pts, guint32 crc, guint32 flags,
+                                   const VideocrcFingerprint * fingerprint,
+                                   const GstVideocrcDigests * digests);
+gboolean gst_videocrc_chain_add   (GstVideocrcChain * chain, guint64 frame,
+                                   guint64 pts, guint32 crc, guint32 flags,
+                                   const VideocrcFingerprint * fingerprint,
+                                   const GstVideocrcDigests * digests);
+void     gst_videocrc_chain_value (const GstVideocrcChain * chain,
+                                   gchar * hex);
+void     gst_videocrc_chain_final (const GstVideocrcChain * chain,
+                                   gchar * hex);
+void     gst_videocrc_chain_to_hex (const guint8 * value, gchar * hex);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_CHAIN_H__ */
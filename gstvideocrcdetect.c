@@ -0,0 +1,87 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstvideocrcdetect.h"
+
+/* keeps the thresholds */
+void
+gst_videocrc_detector_reset (GstVideocrcDetector * detector)
+{
+  detector->have_last = FALSE;
+  detector->last_crc = 0;
+  detector->repeats = 0;
+  detector->active = 0;
+}
+
+static gboolean
+gst_videocrc_detector_black (GstVideocrcDetector * detector,
+    const VideocrcLumaStats * luma)
+{
+  gdouble mean, variance;
+
+  if (luma == NULL || luma->pixels == 0)
+    return FALSE;
+
+  mean = (gdouble) luma->sum / luma->pixels;
+  variance = (gdouble) luma->sum_sq / luma->pixels - mean * mean;
+
+  return mean <= detector->black_level &&
+      variance <= GST_VIDEOCRC_BLACK_VARIANCE;
+}
+
+/* returns the alarms that hold for this frame, @raised and @cleared get the
+ * ones that changed */
+guint
+gst_videocrc_detector_frame (GstVideocrcDetector * detector, guint32 crc,
+    const VideocrcLumaStats * luma, guint * raised, guint * cleared)
+{
+  guint alarms = 0;
+
+  if (detector->have_last && crc == detector->last_crc)
+    detector->repeats++;
+  else
+    detector->repeats = 0;
+  detector->have_last = TRUE;
+  detector->last_crc = crc;
+
+  if (detector->repeats > 0)
+    alarms |= GST_VIDEOCRC_ALARM_DUPLICATE;
+  if (detector->frozen_frames > 0 &&
+      detector->repeats + 1 >= detector->frozen_frames)
+    alarms |= GST_VIDEOCRC_ALARM_FROZEN;
+  if (gst_videocrc_detector_black (detector, luma))
+    alarms |= GST_VIDEOCRC_ALARM_BLACK;
+
+  *raised = alarms & ~detector->active;
+  *cleared = detector->active & ~alarms;
+  detector->active = alarms;
+
+  return alarms;
+}
+
+const gchar *
+gst_videocrc_alarm_name (GstVideocrcAlarm alarm)
+{
+  switch (alarm) {
+    case GST_VIDEOCRC_ALARM_BLACK:
+      return "black-frame";
+    case GST_VIDEOCRC_ALARM_FROZEN:
+      return "frozen-video";
+    case GST_VIDEOCRC_ALARM_DUPLICATE:
+      return "duplicate-frame";
+    default:
+      return "unknown";
+  }
+}
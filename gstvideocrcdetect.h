@@ -0,0 +1,55 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_DETECT_H__
+#define __GST_VIDEOCRC_DETECT_H__
+
+#include <glib.h>
+#include "videocrc.h"
+
+G_BEGIN_DECLS
+
+/* luma variance below which a dark frame counts as black */
+#define GST_VIDEOCRC_BLACK_VARIANCE 16.0
+
+typedef enum
+{
+  GST_VIDEOCRC_ALARM_BLACK = (1 << 0),          /* flat, dark luma */
+  GST_VIDEOCRC_ALARM_FROZEN = (1 << 1),         /* frozen-frames equal frames */
+  GST_VIDEOCRC_ALARM_DUPLICATE = (1 << 2)       /* equal to the frame before */
+} GstVideocrcAlarm;
+
+/**
+ * GstVideocrcDetector:
+ *
+ * Judges each hashed frame from its CRC and the luma statistics gathered
+ * in the same pass. Alarms are levels: they are raised on the first frame
+ * that has the condition and cleared on the first that doesn't.
+ */
+typedef struct
+{
+  guint black_level;            /* mean luma at or below which it is dark */
+  guint frozen_frames;          /* equal frames that make frozen, 0 = off */
+  gboolean have_last;
+  guint32 last_crc;
+  guint repeats;                /* frames in a row equal to the one before */
+  guint active;                 /* GstVideocrcAlarm flags */
+} GstVideocrcDetector;
+
+void         gst_videocrc_detector_reset (GstVideocrcDetector * detector);
+guint        gst_videocrc_detector_frame (GstVideocrcDetector * detector,
+                                          guint32 crc,
+                                          const VideocrcLumaStats * luma,
+                                          guint * raised, guint * cleared);
+const gchar *gst_videocrc_alarm_name     (GstVideocrcAlarm alarm);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_DETECT_H__ */
@@ -0,0 +1,129 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstvideocrcdigest.h"
+
+/* XXH3 is used header-only when xxhash.h is around, nothing to link */
+#if defined(HAVE_XXHASH_H)
+#define GST_VIDEOCRC_HAVE_XXH3 1
+#elif defined(__has_include)
+#if __has_include(<xxhash.h>)
+#define GST_VIDEOCRC_HAVE_XXH3 1
+#endif
+#endif
+
+#ifdef GST_VIDEOCRC_HAVE_XXH3
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+#ifdef XXH_NO_XXH3
+#undef GST_VIDEOCRC_HAVE_XXH3
+#endif
+#endif
+
+/* returns FALSE when a requested digest isn't built in, it is left out */
+gboolean
+gst_videocrc_digests_init (GstVideocrcDigests * d, guint digests)
+{
+  gboolean ret = TRUE;
+
+  memset (d, 0, sizeof (GstVideocrcDigests));
+
+#ifdef GST_VIDEOCRC_HAVE_XXH3
+  if (digests & GST_VIDEOCRC_DIGEST_XXH3)
+    d->xxh3_state = XXH3_createState ();
+#else
+  if (digests & GST_VIDEOCRC_DIGEST_XXH3) {
+    digests &= ~GST_VIDEOCRC_DIGEST_XXH3;
+    ret = FALSE;
+  }
+#endif
+
+  if (digests & GST_VIDEOCRC_DIGEST_CRC64) {
+    d->crc64_kernel = g_new (VideocrcKernel64, 1);
+    videocrc64_init (d->crc64_kernel);
+  }
+  d->digests = digests;
+
+  return ret;
+}
+
+void
+gst_videocrc_digests_clear (GstVideocrcDigests * d)
+{
+#ifdef GST_VIDEOCRC_HAVE_XXH3
+  if (d->xxh3_state)
+    XXH3_freeState (d->xxh3_state);
+#endif
+  g_free (d->crc64_kernel);
+  memset (d, 0, sizeof (GstVideocrcDigests));
+}
+
+void
+gst_videocrc_digests_begin (GstVideocrcDigests * d)
+{
+  d->n_planes = 0;
+  d->crc64 = G_MAXUINT64;
+#ifdef GST_VIDEOCRC_HAVE_XXH3
+  if (d->xxh3_state)
+    XXH3_64bits_reset (d->xxh3_state);
+#endif
+}
+
+void
+gst_videocrc_digests_update (GstVideocrcDigests * d, const guint8 * data,
+    gsize len)
+{
+  if (d->crc64_kernel)
+    d->crc64 = videocrc64_update (d->crc64_kernel, d->crc64, data, len);
+#ifdef GST_VIDEOCRC_HAVE_XXH3
+  if (d->xxh3_state)
+    XXH3_64bits_update (d->xxh3_state, data, len);
+#endif
+}
+
+void
+gst_videocrc_digests_end (GstVideocrcDigests * d)
+{
+  d->crc64 = ~d->crc64;
+#ifdef GST_VIDEOCRC_HAVE_XXH3
+  if (d->xxh3_state)
+    d->xxh3 = XXH3_64bits_digest (d->xxh3_state);
+#endif
+}
+
+/* the digests for the end of a log line, @str has room for
+ * GST_VIDEOCRC_DIGEST_STRLEN bytes */
+void
+gst_videocrc_digests_to_string (const GstVideocrcDigests * d, gchar * str)
+{
+  gsize len = 0;
+  guint i;
+
+  str[0] = '\0';
+  if ((d->digests & GST_VIDEOCRC_DIGEST_PLANES) && d->n_planes > 0) {
+    len += g_snprintf (str + len, GST_VIDEOCRC_DIGEST_STRLEN - len, " planes");
+    for (i = 0; i < d->n_planes; i++)
+      len += g_snprintf (str + len, GST_VIDEOCRC_DIGEST_STRLEN - len, " %08X",
+          d->planes[i]);
+  }
+  if (d->digests & GST_VIDEOCRC_DIGEST_CRC64)
+    len += g_snprintf (str + len, GST_VIDEOCRC_DIGEST_STRLEN - len,
+        " crc64 %016" G_GINT64_MODIFIER "X", d->crc64);
+  if (d->digests & GST_VIDEOCRC_DIGEST_XXH3)
+    g_snprintf (str + len, GST_VIDEOCRC_DIGEST_STRLEN - len,
+        " xxh3 %016" G_GINT64_MODIFIER "X", d->xxh3);
+}
@@ -0,0 +1,66 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_DIGEST_H__
+#define __GST_VIDEOCRC_DIGEST_H__
+
+#include <glib.h>
+#include "videocrc.h"
+
+G_BEGIN_DECLS
+
+/* bytes hashed by every digest before the walk moves on, small enough to
+ * stay in the L1/L2 cache */
+#define GST_VIDEOCRC_DIGEST_BLOCK (32 * 1024)
+
+/* room for " planes X X X crc64 X xxh3 X" */
+#define GST_VIDEOCRC_DIGEST_STRLEN 96
+
+typedef enum
+{
+  GST_VIDEOCRC_DIGEST_PLANES = (1 << 0),        /* CRC of each plane alone */
+  GST_VIDEOCRC_DIGEST_CRC64 = (1 << 1),         /* CRC-64/XZ */
+  GST_VIDEOCRC_DIGEST_XXH3 = (1 << 2)           /* XXH3-64, if built in */
+} GstVideocrcDigest;
+
+/* digests that read the bytes themselves, the others derive from the CRC */
+#define GST_VIDEOCRC_DIGEST_STREAMED \
+  (GST_VIDEOCRC_DIGEST_CRC64 | GST_VIDEOCRC_DIGEST_XXH3)
+
+/**
+ * GstVideocrcDigests:
+ *
+ * Digests computed next to the CRC of a frame. The streamed ones are fed
+ * block by block from the same walk as the CRC, so each byte is read from
+ * memory once.
+ */
+typedef struct
+{
+  guint digests;                /* GstVideocrcDigest flags in use */
+  guint n_planes;
+  guint32 planes[VIDEOCRC_MAX_PLANES];
+  VideocrcKernel64 *crc64_kernel;
+  guint64 crc64;
+  gpointer xxh3_state;
+  guint64 xxh3;
+} GstVideocrcDigests;
+
+gboolean gst_videocrc_digests_init   (GstVideocrcDigests * d, guint digests);
+void     gst_videocrc_digests_clear  (GstVideocrcDigests * d);
+void     gst_videocrc_digests_begin  (GstVideocrcDigests * d);
+void     gst_videocrc_digests_update (GstVideocrcDigests * d,
+                                      const guint8 * data, gsize len);
+void     gst_videocrc_digests_end    (GstVideocrcDigests * d);
+void     gst_videocrc_digests_to_string (const GstVideocrcDigests * d,
+                                         gchar * str);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_DIGEST_H__ */
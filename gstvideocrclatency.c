@@ -0,0 +1,189 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gstvideocrclatency.h"
+
+/* the segment of @group, created by whichever tap starts first; a new
+ * segment is all free slots. A segment the last tap of an earlier run is
+ * unlinking is left to it and a new one opened. */
+gboolean
+gst_videocrc_latency_open (GstVideocrcLatency * latency, const gchar * group)
+{
+  struct stat st;
+  gpointer table;
+  gint fd;
+
+  latency->table = NULL;
+  if (strchr (group, '/') != NULL) {
+    errno = EINVAL;
+    return FALSE;
+  }
+
+  latency->name = g_strdup_printf ("/videocrc-latency-%s", group);
+  for (;;) {
+    fd = shm_open (latency->name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+      goto failed;
+    if (flock (fd, LOCK_EX) < 0 || fstat (fd, &st) < 0)
+      goto failed_fd;
+    if (st.st_nlink > 0)
+      break;
+    close (fd);
+  }
+  if ((gsize) st.st_size < sizeof (GstVideocrcLatencyTable) &&
+      ftruncate (fd, sizeof (GstVideocrcLatencyTable)) < 0)
+    goto failed_fd;
+  table = mmap (NULL, sizeof (GstVideocrcLatencyTable),
+      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (table == MAP_FAILED)
+    goto failed_fd;
+
+  latency->table = table;
+  latency->table->taps++;
+  latency->fd = fd;
+  flock (fd, LOCK_UN);
+  return TRUE;
+
+failed_fd:
+  close (fd);
+failed:
+  g_free (latency->name);
+  latency->name = NULL;
+  return FALSE;
+}
+
+/* the segment stays while the other tap runs. A process that dies without
+ * stopping its tap leaves the count up and the segment for later runs to
+ * share; removing /dev/shm/videocrc-latency-GROUP clears it. */
+void
+gst_videocrc_latency_close (GstVideocrcLatency * latency)
+{
+  if (latency->table == NULL)
+    return;
+
+  flock (latency->fd, LOCK_EX);
+  if (--latency->table->taps == 0)
+    shm_unlink (latency->name);
+  flock (latency->fd, LOCK_UN);
+  close (latency->fd);
+  munmap (latency->table, sizeof (GstVideocrcLatencyTable));
+  latency->table = NULL;
+  g_free (latency->name);
+  latency->name = NULL;
+}
+
+static GstVideocrcLatencySlot *
+gst_videocrc_latency_slot (GstVideocrcLatency * latency, guint64 key)
+{
+  /* Fibonacci hashing, the CRCs of similar frames differ in few bits */
+  return &latency->table->slots[(key * G_GUINT64_CONSTANT (0x9E3779B97F4A7C15))
+      >> (64 - GST_VIDEOCRC_LATENCY_BITS)];
+}
+
+void
+gst_videocrc_latency_record (GstVideocrcLatency * latency, guint64 key,
+    GstClockTime time)
+{
+  GstVideocrcLatencySlot *slot;
+
+  key = key ? key : 1;
+  slot = gst_videocrc_latency_slot (latency, key);
+  __atomic_store_n (&slot->key, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+  __atomic_store_n (&slot->time, time, __ATOMIC_RELAXED);
+  __atomic_store_n (&slot->key, key, __ATOMIC_RELEASE);
+}
+
+/* TRUE with the time since the upstream tap saw @key, the slot is freed so
+ * that a repeated frame does not match the same time again */
+gboolean
+gst_videocrc_latency_match (GstVideocrcLatency * latency, guint64 key,
+    GstClockTime time, guint64 * latency_ns)
+{
+  GstVideocrcLatencySlot *slot;
+  guint64 seen;
+
+  key = key ? key : 1;
+  slot = gst_videocrc_latency_slot (latency, key);
+  if (__atomic_load_n (&slot->key, __ATOMIC_ACQUIRE) != key)
+    return FALSE;
+  seen = __atomic_load_n (&slot->time, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+  if (!__atomic_compare_exchange_n (&slot->key, &key, 0, FALSE,
+          __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    return FALSE;
+
+  /* a frame of an earlier run of the upstream pipeline */
+  if (seen > time || time - seen > GST_VIDEOCRC_LATENCY_MAX_AGE)
+    return FALSE;
+
+  *latency_ns = time - seen;
+  return TRUE;
+}
+
+void
+gst_videocrc_latency_stats_add (GstVideocrcLatencyStats * s,
+    gboolean matched, guint64 latency_ns)
+{
+  guint64 us = latency_ns / 1000;
+  guint bucket;
+
+  if (!matched) {
+    s->unmatched++;
+    return;
+  }
+
+  bucket = us > 0 ? g_bit_storage (us) - 1 : 0;
+  s->histogram[MIN (bucket, GST_VIDEOCRC_LATENCY_BUCKETS - 1)]++;
+  if (s->matched == 0 || latency_ns < s->min_ns)
+    s->min_ns = latency_ns;
+  if (latency_ns > s->max_ns)
+    s->max_ns = latency_ns;
+  s->sum_ns += latency_ns;
+  s->matched++;
+}
+
+void
+gst_videocrc_latency_stats_fill (const GstVideocrcLatencyStats * s,
+    GstStructure * structure)
+{
+  GValue histogram = G_VALUE_INIT, bucket = G_VALUE_INIT;
+  guint i;
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  g_value_init (&bucket, G_TYPE_UINT64);
+  for (i = 0; i < GST_VIDEOCRC_LATENCY_BUCKETS; i++) {
+    g_value_set_uint64 (&bucket, s->histogram[i]);
+    gst_value_array_append_value (&histogram, &bucket);
+  }
+
+  gst_structure_set (structure,
+      "latency-matched", G_TYPE_UINT64, s->matched,
+      "latency-unmatched", G_TYPE_UINT64, s->unmatched,
+      "latency-min-ns", G_TYPE_UINT64, s->min_ns,
+      "latency-mean-ns", G_TYPE_UINT64,
+      s->matched ? s->sum_ns / s->matched : 0,
+      "latency-max-ns", G_TYPE_UINT64, s->max_ns, NULL);
+  gst_structure_take_value (structure, "latency-histogram", &histogram);
+  g_value_unset (&bucket);
+}
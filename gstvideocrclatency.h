@@ -0,0 +1,95 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_LATENCY_H__
+#define __GST_VIDEOCRC_LATENCY_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_VIDEOCRC_LATENCY_BITS       14
+#define GST_VIDEOCRC_LATENCY_SLOTS      (1 << GST_VIDEOCRC_LATENCY_BITS)
+#define GST_VIDEOCRC_LATENCY_BUCKETS    25      /* 1 us to 16 s by powers
+                                                 * of two */
+#define GST_VIDEOCRC_LATENCY_MAX_AGE    (16 * GST_SECOND)
+/* " latency N us" with its terminator */
+#define GST_VIDEOCRC_LATENCY_STRLEN     32
+
+typedef enum
+{
+  GST_VIDEOCRC_LATENCY_TAP_NONE,
+  GST_VIDEOCRC_LATENCY_TAP_UPSTREAM,    /* notes when frames pass */
+  GST_VIDEOCRC_LATENCY_TAP_DOWNSTREAM   /* reports how long ago that was */
+} GstVideocrcLatencyTap;
+
+/* a frame digest and CLOCK_MONOTONIC ns when the upstream tap saw it, key 0
+ * is a free slot; the key is cleared while the slot is rewritten */
+typedef struct
+{
+  guint64 key;
+  guint64 time;
+} GstVideocrcLatencySlot;
+
+/* shared by the taps of a group, in POSIX shared memory so they can also
+ * be in different processes on the host; taps is changed under flock() of
+ * the segment, the last tap to stop unlinks it */
+typedef struct
+{
+  guint32 taps;
+  guint32 reserved;
+  GstVideocrcLatencySlot slots[GST_VIDEOCRC_LATENCY_SLOTS];
+} GstVideocrcLatencyTable;
+
+typedef struct
+{
+  guint64 matched;
+  guint64 unmatched;
+  guint64 min_ns;
+  guint64 max_ns;
+  guint64 sum_ns;
+  guint64 histogram[GST_VIDEOCRC_LATENCY_BUCKETS];      /* bucket i from
+                                                         * 2^i us on */
+} GstVideocrcLatencyStats;
+
+/**
+ * GstVideocrcLatency:
+ *
+ * One tap of a latency group. The table is direct-mapped and without
+ * locks: a frame overwrites whatever older frame had its slot, and the
+ * downstream tap checks the key on both sides of reading the time, so a
+ * slot being rewritten reads as a miss. Frames lost that way, or changed
+ * between the taps, are counted as unmatched.
+ */
+typedef struct
+{
+  GstVideocrcLatencyTable *table;
+  gchar *name;                  /* of the segment, while table is mapped */
+  gint fd;                      /* held for the flock () on close */
+  GstVideocrcLatencyStats stats;
+} GstVideocrcLatency;
+
+gboolean gst_videocrc_latency_open   (GstVideocrcLatency * latency,
+                                      const gchar * group);
+void     gst_videocrc_latency_close  (GstVideocrcLatency * latency);
+void     gst_videocrc_latency_record (GstVideocrcLatency * latency,
+                                      guint64 key, GstClockTime time);
+gboolean gst_videocrc_latency_match  (GstVideocrcLatency * latency,
+                                      guint64 key, GstClockTime time,
+                                      guint64 * latency_ns);
+void     gst_videocrc_latency_stats_add  (GstVideocrcLatencyStats * s,
+                                          gboolean matched,
+                                          guint64 latency_ns);
+void     gst_videocrc_latency_stats_fill (const GstVideocrcLatencyStats * s,
+                                          GstStructure * structure);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_LATENCY_H__ */
@@ -0,0 +1,144 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstvideocrcmerkle.h"
+#include "gstvideocrcchain.h"
+
+/* SHA-256 of one 64-byte @block, which is all a leaf or a node hashes */
+static void
+gst_videocrc_merkle_hash (const GstVideocrcMerkle * merkle,
+    const guint8 * block, guint8 * node)
+{
+  VideocrcSha256 sha = merkle->sha;
+
+  videocrc_sha256_block (&sha, block);
+  videocrc_sha256_final (&sha, node);
+}
+
+static gboolean
+gst_videocrc_merkle_write_header (GstVideocrcMerkle * merkle,
+    guint64 n_leaves)
+{
+  VideocrcMerkleHeader header;
+  guint i;
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, VIDEOCRC_MERKLE_MAGIC, sizeof (header.magic));
+  for (i = 0; i < 8; i++)
+    header.n_leaves[i] = (n_leaves >> (8 * i)) & 0xFF;
+
+  return fwrite (&header, sizeof (header), 1, merkle->file) == 1;
+}
+
+gboolean
+gst_videocrc_merkle_open (GstVideocrcMerkle * merkle, const gchar * path)
+{
+  merkle->n_leaves = 0;
+  videocrc_sha256_init (&merkle->sha);
+  merkle->file = fopen (path, "w+");
+  if (merkle->file == NULL)
+    return FALSE;
+
+  if (!gst_videocrc_merkle_write_header (merkle, 0)) {
+    fclose (merkle->file);
+    merkle->file = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* appends the leaf of @frame and the nodes it completes, carrying like a
+ * binary counter: the new leaf joins the peak of height 0, the result the
+ * peak of height 1, and so on while bit h of n_leaves is set */
+void
+gst_videocrc_merkle_add (GstVideocrcMerkle * merkle, guint64 frame,
+    guint32 crc, guint32 flags, const VideocrcFingerprint * fingerprint,
+    const GstVideocrcDigests * digests)
+{
+  guint8 block[VIDEOCRC_SHA256_BLOCK];
+  guint8 node[VIDEOCRC_MERKLE_NODE];
+  guint h;
+
+  gst_videocrc_chain_record (block, frame, G_MAXUINT64, crc, flags,
+      fingerprint, digests);
+  gst_videocrc_merkle_hash (merkle, block, node);
+  fwrite (node, sizeof (node), 1, merkle->file);
+
+  for (h = 0; merkle->n_leaves & (G_GUINT64_CONSTANT (1) << h); h++) {
+    memcpy (block, merkle->peaks[h], VIDEOCRC_MERKLE_NODE);
+    memcpy (block + VIDEOCRC_MERKLE_NODE, node, VIDEOCRC_MERKLE_NODE);
+    gst_videocrc_merkle_hash (merkle, block, node);
+    fwrite (node, sizeof (node), 1, merkle->file);
+  }
+  memcpy (merkle->peaks[h], node, VIDEOCRC_MERKLE_NODE);
+  merkle->n_leaves++;
+}
+
+/* one value for the whole range: the peaks folded from the lowest, each
+ * higher one hashed in front of what is folded so far; all zeros for no
+ * frames */
+void
+gst_videocrc_merkle_root (const GstVideocrcMerkle * merkle, gchar * hex)
+{
+  guint8 block[VIDEOCRC_SHA256_BLOCK];
+  guint8 root[VIDEOCRC_MERKLE_NODE] = { 0 };
+  gboolean first = TRUE;
+  guint h;
+
+  for (h = 0; h < 64; h++) {
+    if (!(merkle->n_leaves & (G_GUINT64_CONSTANT (1) << h)))
+      continue;
+    if (first) {
+      memcpy (root, merkle->peaks[h], VIDEOCRC_MERKLE_NODE);
+      first = FALSE;
+      continue;
+    }
+    memcpy (block, merkle->peaks[h], VIDEOCRC_MERKLE_NODE);
+    memcpy (block + VIDEOCRC_MERKLE_NODE, root, VIDEOCRC_MERKLE_NODE);
+    gst_videocrc_merkle_hash (merkle, block, root);
+  }
+
+  gst_videocrc_chain_to_hex (root, hex);
+}
+
+/* puts the frame count in the header and the nodes on disk, the index can
+ * still grow afterwards */
+gboolean
+gst_videocrc_merkle_sync (GstVideocrcMerkle * merkle)
+{
+  gboolean ok;
+
+  if (fseek (merkle->file, 0, SEEK_SET) != 0)
+    return FALSE;
+  ok = gst_videocrc_merkle_write_header (merkle, merkle->n_leaves);
+  ok &= fseek (merkle->file, 0, SEEK_END) == 0;
+  ok &= fflush (merkle->file) == 0;
+
+  return ok;
+}
+
+void
+gst_videocrc_merkle_close (GstVideocrcMerkle * merkle)
+{
+  if (merkle->file == NULL)
+    return;
+
+  gst_videocrc_merkle_sync (merkle);
+  fclose (merkle->file);
+  merkle->file = NULL;
+}
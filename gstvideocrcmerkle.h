@@ -0,0 +1,52 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_MERKLE_H__
+#define __GST_VIDEOCRC_MERKLE_H__
+
+#include <stdio.h>
+#include <glib.h>
+#include "videocrc.h"
+#include "videocrc-merkle.h"
+#include "gstvideocrcdigest.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GstVideocrcMerkle:
+ *
+ * Writer of a Merkle index, see videocrc-merkle.h. Only the peaks of the
+ * range are kept: the one of height h while bit h of n_leaves is set, so
+ * a frame costs one SHA-256 for its leaf and one per peak it completes,
+ * two on average, and 32 bytes of the index per node.
+ */
+typedef struct
+{
+  FILE *file;                   /* NULL when no index is written */
+  guint64 n_leaves;
+  VideocrcSha256 sha;           /* initial state, copied for every node */
+  guint8 peaks[64][VIDEOCRC_MERKLE_NODE];
+} GstVideocrcMerkle;
+
+gboolean gst_videocrc_merkle_open  (GstVideocrcMerkle * merkle,
+                                    const gchar * path);
+void     gst_videocrc_merkle_add   (GstVideocrcMerkle * merkle,
+                                    guint64 frame, guint32 crc,
+                                    guint32 flags,
+                                    const VideocrcFingerprint * fingerprint,
+                                    const GstVideocrcDigests * digests);
+void     gst_videocrc_merkle_root  (const GstVideocrcMerkle * merkle,
+                                    gchar * hex);
+gboolean gst_videocrc_merkle_sync  (GstVideocrcMerkle * merkle);
+void     gst_videocrc_merkle_close (GstVideocrcMerkle * merkle);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_MERKLE_H__ */
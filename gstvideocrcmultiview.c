@@ -0,0 +1,185 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstvideocrcmultiview.h"
+
+/* the planes of @info as two views cut at half width or height, n_planes
+ * stays 0 for layouts that don't split by rows and bytes */
+static void
+gst_videocrc_multiview_layout (GstVideocrcMultiview * mv,
+    const GstVideoInfo * info)
+{
+  GstVideocrcViewPlane *plane;
+  guint p, c, width, pstride;
+  gsize end = 0;
+
+  if (GST_VIDEO_FORMAT_INFO_IS_TILED (info->finfo))
+    return;
+
+  for (p = 0; p < GST_VIDEO_INFO_N_PLANES (info); p++) {
+    /* the first component stored in the plane gives its geometry */
+    for (c = 0; c < GST_VIDEO_INFO_N_COMPONENTS (info); c++)
+      if (GST_VIDEO_INFO_COMP_PLANE (info, c) == p)
+        break;
+    if (c == GST_VIDEO_INFO_N_COMPONENTS (info))
+      return;
+    pstride = GST_VIDEO_INFO_COMP_PSTRIDE (info, c);
+    width = GST_VIDEO_INFO_COMP_WIDTH (info, c);
+
+    plane = &mv->planes[p];
+    plane->offset = GST_VIDEO_INFO_PLANE_OFFSET (info, p);
+    plane->stride = GST_VIDEO_INFO_PLANE_STRIDE (info, p);
+    plane->rows = GST_VIDEO_INFO_COMP_HEIGHT (info, c);
+    plane->row_bytes = (gsize) width * pstride;
+    if (mv->mode == GST_VIDEO_MULTIVIEW_MODE_SIDE_BY_SIDE) {
+      plane->split = (gsize) (width / 2) * pstride;
+      plane->second_row = plane->rows;
+    } else {
+      plane->split = plane->row_bytes;
+      plane->second_row = plane->rows / 2;
+    }
+    /* packed sub-sampled formats have no pixel stride */
+    if (pstride == 0 || plane->rows == 0 || plane->offset < end ||
+        plane->stride < plane->row_bytes)
+      return;
+    end = plane->offset + (gsize) (plane->rows - 1) * plane->stride +
+        plane->row_bytes;
+  }
+
+  mv->size = end;
+  mv->n_planes = GST_VIDEO_INFO_N_PLANES (info);
+}
+
+void
+gst_videocrc_multiview_init (GstVideocrcMultiview * mv,
+    const GstVideoInfo * info)
+{
+  memset (mv, 0, sizeof (GstVideocrcMultiview));
+  mv->mode = GST_VIDEO_INFO_MULTIVIEW_MODE (info);
+  mv->n_views = GST_VIDEO_INFO_VIEWS (info);
+
+  switch (mv->mode) {
+    case GST_VIDEO_MULTIVIEW_MODE_FRAME_BY_FRAME:
+    case GST_VIDEO_MULTIVIEW_MODE_MULTIVIEW_FRAME_BY_FRAME:
+      mv->frame_by_frame = mv->n_views > 1;
+      /* a stream that starts without FIRST_IN_BUNDLE starts at view 0 */
+      mv->view = mv->n_views - 1;
+      break;
+    case GST_VIDEO_MULTIVIEW_MODE_SIDE_BY_SIDE:
+    case GST_VIDEO_MULTIVIEW_MODE_TOP_BOTTOM:
+      mv->n_views = GST_VIDEOCRC_MAX_VIEWS;
+      gst_videocrc_multiview_layout (mv, info);
+      break;
+    default:
+      break;
+  }
+}
+
+/* the shifts depend on the polynomial, which can change between frames */
+static void
+gst_videocrc_multiview_prepare (GstVideocrcMultiview * mv,
+    const VideocrcKernel * k)
+{
+  GstVideocrcViewPlane *plane;
+  guint p;
+
+  if (mv->prepared && mv->poly == k->poly && mv->reflected == k->reflected)
+    return;
+
+  for (p = 0; p < mv->n_planes; p++) {
+    plane = &mv->planes[p];
+    videocrc_shift_table_init (k, &plane->shift[0], plane->split);
+    videocrc_shift_table_init (k, &plane->shift[1],
+        plane->row_bytes - plane->split);
+  }
+  mv->poly = k->poly;
+  mv->reflected = k->reflected;
+  mv->prepared = TRUE;
+}
+
+void
+gst_videocrc_multiview_begin (GstVideocrcMultiview * mv, GstBuffer * buf)
+{
+  mv->hashed = FALSE;
+  if (mv->frame_by_frame)
+    mv->view = GST_BUFFER_FLAG_IS_SET (buf,
+        GST_VIDEO_BUFFER_FLAG_FIRST_IN_BUNDLE) ? 0 : (mv->view + 1) %
+        mv->n_views;
+}
+
+/* running CRC of the @size bytes at @data like videocrc_update (), with the
+ * CRCs of the packed views of the frame in crcs; every byte is read once */
+guint32
+gst_videocrc_multiview_hash (GstVideocrcMultiview * mv,
+    const VideocrcKernel * k, guint32 crc, const guint8 * data, gsize size)
+{
+  const GstVideocrcViewPlane *plane;
+  guint32 views[GST_VIDEOCRC_MAX_VIEWS] = { k->init, k->init };
+  guint32 part;
+  const guint8 *row;
+  gsize pos = 0;
+  guint p, r, v;
+
+  if (mv->n_planes == 0 || size < mv->size)
+    return videocrc_update (k, crc, data, size);
+
+  gst_videocrc_multiview_prepare (mv, k);
+  for (p = 0; p < mv->n_planes; p++) {
+    plane = &mv->planes[p];
+    crc = videocrc_update (k, crc, data + pos, plane->offset - pos);
+    row = data + plane->offset;
+    for (r = 0; r < plane->rows; r++, row += plane->stride) {
+      /* each part of the row goes from zero, then joins its view and the
+       * frame, CRC (A + B) being shift (CRC (A), |B|) ^ CRC0 (B) */
+      v = r >= plane->second_row;
+      part = videocrc_update (k, 0, row, plane->split);
+      views[v] = videocrc_shift_apply (&plane->shift[0], views[v]) ^ part;
+      crc = videocrc_shift_apply (&plane->shift[0], crc) ^ part;
+      if (plane->split < plane->row_bytes) {
+        part = videocrc_update (k, 0, row + plane->split,
+            plane->row_bytes - plane->split);
+        views[1] = videocrc_shift_apply (&plane->shift[1], views[1]) ^ part;
+        crc = videocrc_shift_apply (&plane->shift[1], crc) ^ part;
+      }
+      /* padding belongs to the frame only */
+      if (r + 1 < plane->rows)
+        crc = videocrc_update (k, crc, row + plane->row_bytes,
+            plane->stride - plane->row_bytes);
+    }
+    pos = plane->offset + (gsize) (plane->rows - 1) * plane->stride +
+        plane->row_bytes;
+  }
+  crc = videocrc_update (k, crc, data + pos, size - pos);
+
+  for (v = 0; v < GST_VIDEOCRC_MAX_VIEWS; v++)
+    mv->crcs[v] = ~views[v];
+  mv->hashed = TRUE;
+
+  return crc;
+}
+
+void
+gst_videocrc_multiview_to_string (const GstVideocrcMultiview * mv,
+    gchar * str)
+{
+  str[0] = '\0';
+  if (mv->frame_by_frame)
+    g_snprintf (str, GST_VIDEOCRC_MULTIVIEW_STRLEN, " view %u", mv->view);
+  else if (mv->hashed)
+    g_snprintf (str, GST_VIDEOCRC_MULTIVIEW_STRLEN, " views %08X %08X",
+        mv->crcs[0], mv->crcs[1]);
+}
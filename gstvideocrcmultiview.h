@@ -0,0 +1,77 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_MULTIVIEW_H__
+#define __GST_VIDEOCRC_MULTIVIEW_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "videocrc.h"
+
+G_BEGIN_DECLS
+
+#define GST_VIDEOCRC_MAX_VIEWS 2        /* views packed in one frame */
+/* " views XXXXXXXX XXXXXXXX" or " view N" with its terminator */
+#define GST_VIDEOCRC_MULTIVIEW_STRLEN 32
+
+/* a plane of a frame holding two views side by side or top and bottom */
+typedef struct
+{
+  gsize offset;                 /* of the plane in the buffer */
+  gsize stride;
+  guint rows;
+  guint second_row;             /* first row of the second view, rows when
+                                 * the views are side by side */
+  gsize row_bytes;              /* visible bytes of a row */
+  gsize split;                  /* of those, in the first view */
+  VideocrcShiftTable shift[2];  /* by split and row_bytes - split bytes */
+} GstVideocrcViewPlane;
+
+/**
+ * GstVideocrcMultiview:
+ *
+ * Views of multiview caps. Packed views (side-by-side, top-bottom) get a
+ * CRC each in the pass that computes the frame CRC: every visible row part
+ * is hashed from zero once and joined to the running CRC of its view and
+ * to the one of the frame with a precomputed shift. A view's CRC is that of
+ * its rows back to back without padding, the CRC the element logs for the
+ * view as a frame of its own when its rows need no padding. Frame-by-frame
+ * views are buffers of their own and only get numbered.
+ */
+typedef struct
+{
+  GstVideoMultiviewMode mode;
+  guint n_views;
+  gboolean frame_by_frame;      /* one view per buffer */
+  guint view;                   /* frame-by-frame: of the current buffer */
+  guint n_planes;               /* 0 unless views are packed */
+  gsize size;                   /* bytes the planes span */
+  GstVideocrcViewPlane planes[GST_VIDEO_MAX_PLANES];
+  guint32 poly;                 /* kernel the shifts were built for */
+  gint reflected;
+  gboolean prepared;
+  gboolean hashed;              /* crcs are of the current frame */
+  guint32 crcs[GST_VIDEOCRC_MAX_VIEWS];
+} GstVideocrcMultiview;
+
+void     gst_videocrc_multiview_init      (GstVideocrcMultiview * mv,
+                                           const GstVideoInfo * info);
+void     gst_videocrc_multiview_begin     (GstVideocrcMultiview * mv,
+                                           GstBuffer * buf);
+guint32  gst_videocrc_multiview_hash      (GstVideocrcMultiview * mv,
+                                           const VideocrcKernel * k,
+                                           guint32 crc, const guint8 * data,
+                                           gsize size);
+void     gst_videocrc_multiview_to_string (const GstVideocrcMultiview * mv,
+                                           gchar * str);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_MULTIVIEW_H__ */
@@ -0,0 +1,208 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * Per-thread hardware counters around the CRC phase. The group is opened
+ * for the calling thread only, user space only, so it works with the
+ * default perf_event_paranoid level of most distributions.
+ *
+ * Counting one thread is exact as long as that thread hashes the whole
+ * frame, which it does unless the band pool splits it: bands on pool
+ * workers would be missed and the frame would look cheaper by about the
+ * number of threads. The element therefore keeps such frames out of the
+ * averages and only counts them as partial.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstvideocrcperf.h"
+
+#ifdef __linux__
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static gint
+gst_videocrc_perf_gettid (void)
+{
+  return (gint) syscall (SYS_gettid);
+}
+
+static gint
+gst_videocrc_perf_event_open (guint32 type, guint64 config, gint group_fd)
+{
+  struct perf_event_attr attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.size = sizeof (attr);
+  attr.type = type;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  /* only the leader starts disabled, members follow it */
+  attr.disabled = group_fd == -1;
+
+  return (gint) syscall (SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+void
+gst_videocrc_perf_init (GstVideocrcPerf * perf)
+{
+  guint i;
+
+  for (i = 0; i < GST_VIDEOCRC_PERF_N; i++)
+    perf->fd[i] = -1;
+  perf->n_open = 0;
+  perf->tid = 0;
+}
+
+gboolean
+gst_videocrc_perf_open (GstVideocrcPerf * perf)
+{
+  static const struct
+  {
+    guint32 type;
+    guint64 config;
+  } events[GST_VIDEOCRC_PERF_N] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+  };
+  guint i;
+
+  gst_videocrc_perf_close (perf);
+
+  perf->fd[0] = gst_videocrc_perf_event_open (events[0].type,
+      events[0].config, -1);
+  if (perf->fd[0] < 0)
+    return FALSE;
+  perf->slot[0] = perf->n_open++;
+
+  for (i = 1; i < GST_VIDEOCRC_PERF_N; i++) {
+    perf->fd[i] = gst_videocrc_perf_event_open (events[i].type,
+        events[i].config, perf->fd[0]);
+    if (perf->fd[i] >= 0)
+      perf->slot[i] = perf->n_open++;
+  }
+
+  perf->tid = gst_videocrc_perf_gettid ();
+  ioctl (perf->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+  return TRUE;
+}
+
+void
+gst_videocrc_perf_close (GstVideocrcPerf * perf)
+{
+  guint i;
+
+  for (i = 0; i < GST_VIDEOCRC_PERF_N; i++) {
+    if (perf->fd[i] >= 0)
+      close (perf->fd[i]);
+    perf->fd[i] = -1;
+  }
+  perf->n_open = 0;
+  perf->tid = 0;
+}
+
+/* counters are per thread, a new streaming thread needs a new group */
+gboolean
+gst_videocrc_perf_is_current (GstVideocrcPerf * perf)
+{
+  return perf->fd[0] >= 0 && perf->tid == gst_videocrc_perf_gettid ();
+}
+
+static gboolean
+gst_videocrc_perf_read (GstVideocrcPerf * perf,
+    guint64 values[GST_VIDEOCRC_PERF_N])
+{
+  guint64 data[1 + GST_VIDEOCRC_PERF_N];
+  guint i;
+
+  if (read (perf->fd[0], data, (1 + perf->n_open) * sizeof (guint64)) <= 0)
+    return FALSE;
+
+  for (i = 0; i < GST_VIDEOCRC_PERF_N; i++)
+    values[i] = perf->fd[i] >= 0 ? data[1 + perf->slot[i]] : 0;
+
+  return TRUE;
+}
+
+/* FALSE when the counters could not be read, the frame is not measured */
+gboolean
+gst_videocrc_perf_begin (GstVideocrcPerf * perf)
+{
+  return gst_videocrc_perf_read (perf, perf->start);
+}
+
+gboolean
+gst_videocrc_perf_end (GstVideocrcPerf * perf,
+    guint64 delta[GST_VIDEOCRC_PERF_N])
+{
+  guint64 now[GST_VIDEOCRC_PERF_N];
+  guint i;
+
+  if (!gst_videocrc_perf_read (perf, now))
+    return FALSE;
+
+  for (i = 0; i < GST_VIDEOCRC_PERF_N; i++)
+    delta[i] = now[i] - perf->start[i];
+
+  return TRUE;
+}
+
+#else /* !__linux__ */
+
+void
+gst_videocrc_perf_init (GstVideocrcPerf * perf)
+{
+  perf->fd[0] = -1;
+}
+
+gboolean
+gst_videocrc_perf_open (GstVideocrcPerf * perf)
+{
+  return FALSE;
+}
+
+void
+gst_videocrc_perf_close (GstVideocrcPerf * perf)
+{
+}
+
+gboolean
+gst_videocrc_perf_is_current (GstVideocrcPerf * perf)
+{
+  return FALSE;
+}
+
+gboolean
+gst_videocrc_perf_begin (GstVideocrcPerf * perf)
+{
+  return FALSE;
+}
+
+gboolean
+gst_videocrc_perf_end (GstVideocrcPerf * perf,
+    guint64 delta[GST_VIDEOCRC_PERF_N])
+{
+  return FALSE;
+}
+
+#endif
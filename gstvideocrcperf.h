@@ -0,0 +1,54 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_PERF_H__
+#define __GST_VIDEOCRC_PERF_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_VIDEOCRC_PERF_CYCLES,
+  GST_VIDEOCRC_PERF_INSTRUCTIONS,
+  GST_VIDEOCRC_PERF_LLC_MISSES,
+  GST_VIDEOCRC_PERF_DTLB_MISSES,
+  GST_VIDEOCRC_PERF_N
+} GstVideocrcPerfCounter;
+
+typedef struct _GstVideocrcPerf GstVideocrcPerf;
+
+/**
+ * GstVideocrcPerf:
+ *
+ * One perf_event_open() counter group bound to the thread that opened it.
+ * Counters the kernel or the PMU refuses are left at -1 and read as 0.
+ */
+struct _GstVideocrcPerf
+{
+  gint fd[GST_VIDEOCRC_PERF_N];         /* group leader is fd[CYCLES] */
+  guint slot[GST_VIDEOCRC_PERF_N];      /* position in the group read */
+  guint n_open;
+  gint tid;                             /* thread the group counts */
+  guint64 start[GST_VIDEOCRC_PERF_N];
+};
+
+void     gst_videocrc_perf_init  (GstVideocrcPerf * perf);
+gboolean gst_videocrc_perf_open  (GstVideocrcPerf * perf);
+void     gst_videocrc_perf_close (GstVideocrcPerf * perf);
+gboolean gst_videocrc_perf_is_current (GstVideocrcPerf * perf);
+gboolean gst_videocrc_perf_begin (GstVideocrcPerf * perf);
+gboolean gst_videocrc_perf_end   (GstVideocrcPerf * perf,
+                                  guint64 delta[GST_VIDEOCRC_PERF_N]);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_PERF_H__ */
@@ -0,0 +1,216 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * Worker threads that hash horizontal bands of one plane in parallel. The
+ * streaming thread hashes the first band itself, the workers hash the
+ * others from a zero state, and the results are joined with
+ * videocrc_combine (), so the CRC equals the one of a sequential walk.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstvideocrcpool.h"
+
+typedef struct
+{
+  VideocrcPlane band;
+  guint32 crc;
+  VideocrcLumaStats stats;
+} GstVideocrcPoolTask;
+
+struct _GstVideocrcPool
+{
+  GMutex lock;
+  GCond work_cond;              /* a new generation of tasks is ready */
+  GCond done_cond;              /* pending dropped to 0 */
+  guint n_threads;              /* including the streaming thread */
+  GThread *threads[GST_VIDEOCRC_MAX_THREADS];
+  guint generation;
+  guint n_bands;
+  guint pending;
+  gboolean quit;
+  const VideocrcKernel *kernel;
+  guint stats_width;            /* 0 when no luma stats are wanted */
+  GstVideocrcPoolTask tasks[GST_VIDEOCRC_MAX_THREADS];
+};
+
+typedef struct
+{
+  GstVideocrcPool *pool;
+  guint index;                  /* task this worker owns */
+} GstVideocrcPoolWorker;
+
+static gpointer
+gst_videocrc_pool_worker (gpointer data)
+{
+  GstVideocrcPoolWorker *worker = data;
+  GstVideocrcPool *pool = worker->pool;
+  guint index = worker->index;
+  guint seen = 0;
+
+  g_free (worker);
+
+  g_mutex_lock (&pool->lock);
+  for (;;) {
+    while (!pool->quit && pool->generation == seen)
+      g_cond_wait (&pool->work_cond, &pool->lock);
+    if (pool->quit)
+      break;
+    seen = pool->generation;
+    if (index >= pool->n_bands)
+      continue;
+
+    g_mutex_unlock (&pool->lock);
+    pool->tasks[index].crc = videocrc_plane_update_stats (pool->kernel, 0,
+        &pool->tasks[index].band, pool->stats_width,
+        pool->stats_width ? &pool->tasks[index].stats : NULL);
+    g_mutex_lock (&pool->lock);
+
+    if (--pool->pending == 0)
+      g_cond_signal (&pool->done_cond);
+  }
+  g_mutex_unlock (&pool->lock);
+
+  return NULL;
+}
+
+GstVideocrcPool *
+gst_videocrc_pool_new (guint n_threads)
+{
+  GstVideocrcPool *pool;
+  guint i;
+
+  n_threads = CLAMP (n_threads, 1, GST_VIDEOCRC_MAX_THREADS);
+
+  pool = g_new0 (GstVideocrcPool, 1);
+  g_mutex_init (&pool->lock);
+  g_cond_init (&pool->work_cond);
+  g_cond_init (&pool->done_cond);
+  pool->n_threads = n_threads;
+
+  for (i = 1; i < n_threads; i++) {
+    GstVideocrcPoolWorker *worker = g_new (GstVideocrcPoolWorker, 1);
+
+    worker->pool = pool;
+    worker->index = i;
+    pool->threads[i] = g_thread_new ("videocrc-worker",
+        gst_videocrc_pool_worker, worker);
+  }
+
+  return pool;
+}
+
+void
+gst_videocrc_pool_free (GstVideocrcPool * pool)
+{
+  guint i;
+
+  if (pool == NULL)
+    return;
+
+  g_mutex_lock (&pool->lock);
+  pool->quit = TRUE;
+  g_cond_broadcast (&pool->work_cond);
+  g_mutex_unlock (&pool->lock);
+
+  for (i = 1; i < pool->n_threads; i++)
+    g_thread_join (pool->threads[i]);
+
+  g_mutex_clear (&pool->lock);
+  g_cond_clear (&pool->work_cond);
+  g_cond_clear (&pool->done_cond);
+  g_free (pool);
+}
+
+guint
+gst_videocrc_pool_threads (GstVideocrcPool * pool)
+{
+  return pool ? pool->n_threads : 1;
+}
+
+/* changes whenever bands are handed to the workers; read on the streaming
+ * thread, the only one that hands them out */
+guint
+gst_videocrc_pool_generation (GstVideocrcPool * pool)
+{
+  return pool ? pool->generation : 0;
+}
+
+guint32
+gst_videocrc_pool_plane_update (GstVideocrcPool * pool,
+    const VideocrcKernel * k, guint32 crc, const VideocrcPlane * plane,
+    guint n_bands)
+{
+  return gst_videocrc_pool_plane_update_stats (pool, k, crc, plane, n_bands,
+      0, NULL);
+}
+
+/* also adds the first @stats_width samples of every row to @stats, see
+ * videocrc_plane_update_stats () */
+guint32
+gst_videocrc_pool_plane_update_stats (GstVideocrcPool * pool,
+    const VideocrcKernel * k, guint32 crc, const VideocrcPlane * plane,
+    guint n_bands, guint stats_width, VideocrcLumaStats * stats)
+{
+  guint rows, i;
+
+  if (stats == NULL)
+    stats_width = 0;
+  if (pool)
+    n_bands = MIN (n_bands, pool->n_threads);
+  n_bands = MIN (n_bands, plane->height);
+  if (pool == NULL || n_bands <= 1)
+    return videocrc_plane_update_stats (k, crc, plane, stats_width,
+        stats_width ? stats : NULL);
+
+  rows = (plane->height + n_bands - 1) / n_bands;
+  n_bands = (plane->height + rows - 1) / rows;
+
+  g_mutex_lock (&pool->lock);
+  for (i = 1; i < n_bands; i++) {
+    pool->tasks[i].band = videocrc_plane_band (plane, i * rows,
+        MIN (rows, plane->height - i * rows));
+    memset (&pool->tasks[i].stats, 0, sizeof (VideocrcLumaStats));
+  }
+  pool->kernel = k;
+  pool->stats_width = stats_width;
+  pool->n_bands = n_bands;
+  pool->pending = n_bands - 1;
+  pool->generation++;
+  g_cond_broadcast (&pool->work_cond);
+  g_mutex_unlock (&pool->lock);
+
+  pool->tasks[0].band = videocrc_plane_band (plane, 0, rows);
+  crc = videocrc_plane_update_stats (k, crc, &pool->tasks[0].band,
+      stats_width, stats_width ? stats : NULL);
+
+  g_mutex_lock (&pool->lock);
+  while (pool->pending > 0)
+    g_cond_wait (&pool->done_cond, &pool->lock);
+  g_mutex_unlock (&pool->lock);
+
+  for (i = 1; i < n_bands; i++) {
+    crc = videocrc_combine (k, crc, pool->tasks[i].crc,
+        (guint64) pool->tasks[i].band.width * pool->tasks[i].band.height);
+    if (stats_width) {
+      stats->sum += pool->tasks[i].stats.sum;
+      stats->sum_sq += pool->tasks[i].stats.sum_sq;
+      stats->pixels += pool->tasks[i].stats.pixels;
+    }
+  }
+
+  return crc;
+}
@@ -0,0 +1,42 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_POOL_H__
+#define __GST_VIDEOCRC_POOL_H__
+
+#include <glib.h>
+#include "videocrc.h"
+
+G_BEGIN_DECLS
+
+#define GST_VIDEOCRC_MAX_THREADS 8
+
+typedef struct _GstVideocrcPool GstVideocrcPool;
+
+GstVideocrcPool *gst_videocrc_pool_new      (guint n_threads);
+void             gst_videocrc_pool_free     (GstVideocrcPool * pool);
+guint            gst_videocrc_pool_threads  (GstVideocrcPool * pool);
+guint            gst_videocrc_pool_generation (GstVideocrcPool * pool);
+guint32          gst_videocrc_pool_plane_update (GstVideocrcPool * pool,
+                                                 const VideocrcKernel * k,
+                                                 guint32 crc,
+                                                 const VideocrcPlane * plane,
+                                                 guint n_bands);
+guint32          gst_videocrc_pool_plane_update_stats (GstVideocrcPool * pool,
+                                                 const VideocrcKernel * k,
+                                                 guint32 crc,
+                                                 const VideocrcPlane * plane,
+                                                 guint n_bands,
+                                                 guint stats_width,
+                                                 VideocrcLumaStats * stats);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_POOL_H__ */
@@ -0,0 +1,53 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_PROBES_H__
+#define __GST_VIDEOCRC_PROBES_H__
+
+/*
+ * USDT tracepoints of the videocrc provider. With <sys/sdt.h> available each
+ * probe is a single nop until a tracer attaches, e.g.
+ *
+ *   bpftrace -e 'usdt:libgstvideocrc.so:videocrc:hash__end
+ *       { printf("%d %x\n", arg0, arg3); }' -p <pid>
+ *
+ * Without it the probes compile to nothing.
+ *
+ *   map__start    (frame)
+ *   map__end      (frame, mapped bytes)
+ *   hash__start   (frame, plane, bytes)
+ *   hash__end     (frame, plane, bytes, crc)
+ *   log__start    (frame, crc)
+ *   log__end      (frame, crc)
+ */
+
+#if defined(HAVE_SYS_SDT_H)
+#define GST_VIDEOCRC_HAVE_USDT 1
+#elif defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define GST_VIDEOCRC_HAVE_USDT 1
+#endif
+#endif
+
+#ifdef GST_VIDEOCRC_HAVE_USDT
+#include <sys/sdt.h>
+#define GST_VIDEOCRC_PROBE1(name, a)             DTRACE_PROBE1 (videocrc, name, a)
+#define GST_VIDEOCRC_PROBE2(name, a, b)          DTRACE_PROBE2 (videocrc, name, a, b)
+#define GST_VIDEOCRC_PROBE3(name, a, b, c)       DTRACE_PROBE3 (videocrc, name, a, b, c)
+#define GST_VIDEOCRC_PROBE4(name, a, b, c, d)    DTRACE_PROBE4 (videocrc, name, a, b, c, d)
+#else
+#define GST_VIDEOCRC_PROBE1(name, a)             do { } while (0)
+#define GST_VIDEOCRC_PROBE2(name, a, b)          do { } while (0)
+#define GST_VIDEOCRC_PROBE3(name, a, b, c)       do { } while (0)
+#define GST_VIDEOCRC_PROBE4(name, a, b, c, d)    do { } while (0)
+#endif
+
+#endif /* __GST_VIDEOCRC_PROBES_H__ */
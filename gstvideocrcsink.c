@@ -0,0 +1,512 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/**
+ * SECTION:element-videocrcsink
+ * @short_desc: logs the CRC of every frame and drops it
+ *
+ * Terminal counterpart of videocrc for runs where only the log matters. The
+ * CRCs and fingerprints are the ones videocrc logs for the same buffers, in
+ * the same "VideoFrame N crc X" format. render only takes a reference to the
+ * buffer and hands it to n-workers threads; a buffer goes back to its pool
+ * as soon as its hash is done and lines are written in frame order. At most
+ * max-pending buffers are held, render waits beyond that. The sink doesn't
+ * synchronise to the clock (sync=false) and keeps no last sample, so nothing
+ * holds on to decoder buffers.
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 uridecodebin uri=file:///path/to/video.mp4 ! videocrcsink location=crc.log
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <sys/mman.h>
+#include "gstvideocrc.h"
+#include "gstvideocrcsink.h"
+#ifdef QCOM_HARDWARE
+#include "../../gst-libs/gst/ionbuf/gstionbuf_meta.h"
+#endif
+
+#define DEFAULT_ALGORITHM GST_VIDEOCRC_ALGORITHM_LEGACY
+#define DEFAULT_CRC_MASK 0x04C11DB7
+#define DEFAULT_FINGERPRINT_BITS 64
+#define DEFAULT_N_WORKERS 0
+#define DEFAULT_MAX_PENDING 4
+#define GST_VIDEOCRC_SINK_MAX_WORKERS 16
+
+GST_DEBUG_CATEGORY_STATIC (gst_videocrc_sink_debug);
+#define GST_CAT_DEFAULT gst_videocrc_sink_debug
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+        GST_PAD_SINK,
+        GST_PAD_ALWAYS,
+        GST_STATIC_CAPS_ANY);
+
+enum
+{
+  PROP_0,
+  PROP_LOCATION,
+  PROP_ALGORITHM,
+  PROP_CRC_MASK,
+  PROP_FINGERPRINT_BITS,
+  PROP_N_WORKERS,
+  PROP_MAX_PENDING
+};
+
+#define parent_class gst_videocrc_sink_parent_class
+G_DEFINE_TYPE_WITH_CODE (GstVideocrcSink, gst_videocrc_sink,
+    GST_TYPE_BASE_SINK, GST_DEBUG_CATEGORY_INIT (gst_videocrc_sink_debug,
+        "videocrcsink", 0, "videocrcsink element"));
+
+static void gst_videocrc_sink_finalize (GObject * object);
+static void gst_videocrc_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_videocrc_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_videocrc_sink_start (GstBaseSink * bsink);
+static gboolean gst_videocrc_sink_stop (GstBaseSink * bsink);
+static gboolean gst_videocrc_sink_set_caps (GstBaseSink * bsink,
+    GstCaps * caps);
+static gboolean gst_videocrc_sink_event (GstBaseSink * bsink,
+    GstEvent * event);
+static gboolean gst_videocrc_sink_unlock (GstBaseSink * bsink);
+static gboolean gst_videocrc_sink_unlock_stop (GstBaseSink * bsink);
+static GstFlowReturn gst_videocrc_sink_render (GstBaseSink * bsink,
+    GstBuffer * buf);
+static void gst_videocrc_sink_work (gpointer data, gpointer user_data);
+
+static void
+gst_videocrc_sink_class_init (GstVideocrcSinkClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstBaseSinkClass *base_sink_class = GST_BASE_SINK_CLASS (klass);
+
+  gobject_class->set_property = gst_videocrc_sink_set_property;
+  gobject_class->get_property = gst_videocrc_sink_get_property;
+  gobject_class->finalize = gst_videocrc_sink_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "File Location",
+          "Location of the file to write CRC message", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_ALGORITHM,
+      g_param_spec_enum ("algorithm", "Algorithm",
+          "CRC algorithm, legacy uses crc-mask", GST_TYPE_VIDEOCRC_ALGORITHM,
+          DEFAULT_ALGORITHM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_CRC_MASK,
+      g_param_spec_uint ("crc-mask", "CRC polynomial",
+          "CRC computation will use CRC polynomial set by application",
+          0, G_MAXUINT, DEFAULT_CRC_MASK, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_FINGERPRINT_BITS,
+      g_param_spec_uint ("fingerprint-bits", "Fingerprint bits",
+          "Size of the perceptual fingerprint, 64 or 256", 64, 256,
+          DEFAULT_FINGERPRINT_BITS, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_N_WORKERS,
+      g_param_spec_uint ("n-workers", "Workers",
+          "Threads hashing buffers (0 = one per CPU)", 0,
+          GST_VIDEOCRC_SINK_MAX_WORKERS, DEFAULT_N_WORKERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_PENDING,
+      g_param_spec_uint ("max-pending", "Max pending",
+          "Buffers held before render waits for the workers", 1, 64,
+          DEFAULT_MAX_PENDING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  gst_element_class_set_metadata (GST_ELEMENT_CLASS (klass),
+      "Video CRC Sink",
+      "Sink/Video",
+      "Log the CRC of every video frame and discard it",
+      "VideoCRC contributors");
+  gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
+      &sinktemplate);
+
+  base_sink_class->start = GST_DEBUG_FUNCPTR (gst_videocrc_sink_start);
+  base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_videocrc_sink_stop);
+  base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_videocrc_sink_set_caps);
+  base_sink_class->event = GST_DEBUG_FUNCPTR (gst_videocrc_sink_event);
+  base_sink_class->unlock = GST_DEBUG_FUNCPTR (gst_videocrc_sink_unlock);
+  base_sink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_videocrc_sink_unlock_stop);
+  base_sink_class->render = GST_DEBUG_FUNCPTR (gst_videocrc_sink_render);
+}
+
+static void
+gst_videocrc_sink_init (GstVideocrcSink * sink)
+{
+  g_mutex_init (&sink->lock);
+  g_cond_init (&sink->cond);
+  sink->algorithm = DEFAULT_ALGORITHM;
+  sink->polynomial = DEFAULT_CRC_MASK;
+  sink->fingerprint_bits = DEFAULT_FINGERPRINT_BITS;
+  sink->n_workers = DEFAULT_N_WORKERS;
+  sink->max_pending = DEFAULT_MAX_PENDING;
+
+  /* drain as fast as upstream delivers, and hold no buffer once hashed */
+  gst_base_sink_set_sync (GST_BASE_SINK (sink), FALSE);
+  gst_base_sink_set_last_sample_enabled (GST_BASE_SINK (sink), FALSE);
+}
+
+static void
+gst_videocrc_sink_finalize (GObject * object)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (object);
+
+  g_mutex_clear (&sink->lock);
+  g_cond_clear (&sink->cond);
+  g_free (sink->filename);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gboolean
+gst_videocrc_sink_start (GstBaseSink * bsink)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (bsink);
+  GError *error = NULL;
+  guint n_workers;
+
+  gst_videocrc_build_kernel (&sink->kernel, sink->algorithm,
+      sink->polynomial);
+
+  if (sink->filename != NULL) {
+    sink->logfile = fopen (sink->filename, "w+");
+    if (sink->logfile == NULL) {
+      GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+          ("Could not open log \"%s\".", sink->filename), GST_ERROR_SYSTEM);
+      return FALSE;
+    }
+  }
+
+  n_workers = sink->n_workers ? sink->n_workers :
+      MIN (g_get_num_processors (), GST_VIDEOCRC_SINK_MAX_WORKERS);
+  sink->workers = g_thread_pool_new (gst_videocrc_sink_work, sink,
+      MIN (n_workers, sink->max_pending), FALSE, &error);
+  if (sink->workers == NULL) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, FAILED,
+        ("Could not start the hashing threads."), ("%s", error->message));
+    g_error_free (error);
+    if (sink->logfile)
+      fclose (sink->logfile);
+    sink->logfile = NULL;
+    return FALSE;
+  }
+
+  sink->jobs = g_new0 (GstVideocrcSinkJob, sink->max_pending);
+  sink->have_info = FALSE;
+  sink->frame_num = 0;
+  sink->next_log = 1;
+  sink->pending = 0;
+  sink->flushing = FALSE;
+  GST_DEBUG_OBJECT (sink, "%u workers, %u pending buffers",
+      MIN (n_workers, sink->max_pending), sink->max_pending);
+
+  return TRUE;
+}
+
+static gboolean
+gst_videocrc_sink_stop (GstBaseSink * bsink)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (bsink);
+
+  /* finishes the queued buffers first */
+  if (sink->workers)
+    g_thread_pool_free (sink->workers, FALSE, TRUE);
+  sink->workers = NULL;
+  g_free (sink->jobs);
+  sink->jobs = NULL;
+  if (sink->logfile != NULL) {
+    fclose (sink->logfile);
+    sink->logfile = NULL;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_videocrc_sink_set_caps (GstBaseSink * bsink, GstCaps * caps)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (bsink);
+
+  /* buffers already handed to the workers keep the layout they came with */
+  g_mutex_lock (&sink->lock);
+  while (sink->pending > 0)
+    g_cond_wait (&sink->cond, &sink->lock);
+  sink->have_info = gst_video_info_from_caps (&sink->info, caps);
+  g_mutex_unlock (&sink->lock);
+  GST_DEBUG_OBJECT (sink, "caps %" GST_PTR_FORMAT, caps);
+
+  return TRUE;
+}
+
+/* the whole queue is logged before EOS goes on */
+static gboolean
+gst_videocrc_sink_event (GstBaseSink * bsink, GstEvent * event)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (bsink);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    g_mutex_lock (&sink->lock);
+    while (sink->pending > 0 && !sink->flushing)
+      g_cond_wait (&sink->cond, &sink->lock);
+    if (sink->logfile)
+      fflush (sink->logfile);
+    g_mutex_unlock (&sink->lock);
+  }
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (bsink, event);
+}
+
+static gboolean
+gst_videocrc_sink_unlock (GstBaseSink * bsink)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (bsink);
+
+  g_mutex_lock (&sink->lock);
+  sink->flushing = TRUE;
+  g_cond_broadcast (&sink->cond);
+  g_mutex_unlock (&sink->lock);
+
+  return TRUE;
+}
+
+static gboolean
+gst_videocrc_sink_unlock_stop (GstBaseSink * bsink)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (bsink);
+
+  g_mutex_lock (&sink->lock);
+  sink->flushing = FALSE;
+  g_mutex_unlock (&sink->lock);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_videocrc_sink_render (GstBaseSink * bsink, GstBuffer * buf)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (bsink);
+  GstVideocrcSinkJob *job;
+
+  g_mutex_lock (&sink->lock);
+  while (sink->pending >= sink->max_pending && !sink->flushing)
+    g_cond_wait (&sink->cond, &sink->lock);
+  if (sink->flushing) {
+    g_mutex_unlock (&sink->lock);
+    return GST_FLOW_FLUSHING;
+  }
+  sink->frame_num++;
+  job = &sink->jobs[sink->frame_num % sink->max_pending];
+  job->buf = gst_buffer_ref (buf);
+  job->frame = sink->frame_num;
+  job->done = FALSE;
+  sink->pending++;
+  g_mutex_unlock (&sink->lock);
+
+  g_thread_pool_push (sink->workers, job, NULL);
+
+  return GST_FLOW_OK;
+}
+
+/* CRC as videocrc computes it: the NV12 walk for ION buffers, the memories
+ * back to back otherwise; fingerprints of the luma for algorithm=fingerprint */
+static void
+gst_videocrc_sink_hash (GstVideocrcSink * sink, GstVideocrcSinkJob * job)
+{
+  const VideocrcKernel *k = &sink->kernel;
+  const GstVideoInfo *info = &sink->info;
+  gboolean fingerprint = sink->algorithm == GST_VIDEOCRC_ALGORITHM_FINGERPRINT;
+  VideocrcPlane planes[VIDEOCRC_MAX_PLANES];
+  GstIonBufFdMeta *ion_meta;
+  GstMapInfo map_info;
+  GstMemory *mem;
+  guint8 *ptr;
+  guint i, n;
+
+  job->crc = 0;
+  job->fingerprint.n_bits = 0;
+
+  ion_meta = gst_buffer_get_ionfd_meta (job->buf);
+  if (ion_meta && sink->have_info) {
+    ptr = mmap (NULL, ion_meta->size, PROT_READ, MAP_SHARED, ion_meta->fd,
+        ion_meta->offset);
+    if (ptr == MAP_FAILED) {
+      GST_WARNING_OBJECT (sink, "could not map ION buffer of frame %u",
+          job->frame);
+      return;
+    }
+    n = videocrc_nv12_planes (planes, ptr, GST_VIDEO_INFO_WIDTH (info),
+        GST_VIDEO_INFO_HEIGHT (info),
+        GST_VIDEOCRC_ALIGN (GST_VIDEO_INFO_WIDTH (info),
+            GST_VIDEOCRC_ION_STRIDE),
+        GST_VIDEOCRC_ALIGN (GST_VIDEO_INFO_HEIGHT (info),
+            GST_VIDEOCRC_ION_SCANLINES));
+    if (fingerprint)
+      videocrc_fingerprint (&planes[0], sink->fingerprint_bits,
+          &job->fingerprint);
+    else
+      job->crc = videocrc_frame (k, planes, n);
+    munmap (ptr, ion_meta->size);
+  } else if (fingerprint && sink->have_info) {
+    if (!gst_buffer_map (job->buf, &map_info, GST_MAP_READ))
+      return;
+    if (map_info.size >= GST_VIDEO_INFO_SIZE (info)) {
+      planes[0].data = map_info.data;
+      planes[0].stride = GST_VIDEO_INFO_PLANE_STRIDE (info, 0);
+      planes[0].width = GST_VIDEO_INFO_WIDTH (info) & ~1u;
+      planes[0].height = GST_VIDEO_INFO_HEIGHT (info);
+      planes[0].step = 1;
+      videocrc_fingerprint (&planes[0], sink->fingerprint_bits,
+          &job->fingerprint);
+    }
+    gst_buffer_unmap (job->buf, &map_info);
+  } else {
+    job->crc = k->init;
+    n = gst_buffer_n_memory (job->buf);
+    for (i = 0; i < n; i++) {
+      mem = gst_buffer_peek_memory (job->buf, i);
+      if (!gst_memory_map (mem, &map_info, GST_MAP_READ)) {
+        GST_WARNING_OBJECT (sink, "could not map memory %u of frame %u", i,
+            job->frame);
+        continue;
+      }
+      job->crc = videocrc_update (k, job->crc, map_info.data, map_info.size);
+      gst_memory_unmap (mem, &map_info);
+    }
+    job->crc = ~job->crc;
+  }
+
+  if (job->fingerprint.n_bits)
+    job->crc = job->fingerprint.bits[0] >> 32;
+}
+
+static void
+gst_videocrc_sink_log (GstVideocrcSink * sink, const GstVideocrcSinkJob * job)
+{
+  gchar hex[VIDEOCRC_FINGERPRINT_STRLEN];
+
+  if (job->fingerprint.n_bits) {
+    videocrc_fingerprint_to_string (&job->fingerprint, hex);
+    GST_INFO_OBJECT (sink, "VideoFrame %u fingerprint %s", job->frame, hex);
+    if (sink->logfile)
+      fprintf (sink->logfile, "VideoFrame %u fingerprint %s\n", job->frame,
+          hex);
+  } else {
+    GST_INFO_OBJECT (sink, "VideoFrame %u crc %08X", job->frame, job->crc);
+    if (sink->logfile)
+      fprintf (sink->logfile, "VideoFrame %u crc %08X\n", job->frame,
+          job->crc);
+  }
+}
+
+/* hashes one buffer on a worker thread, gives it back upstream and logs
+ * every frame that is now next in order */
+static void
+gst_videocrc_sink_work (gpointer data, gpointer user_data)
+{
+  GstVideocrcSink *sink = user_data;
+  GstVideocrcSinkJob *job = data;
+
+  gst_videocrc_sink_hash (sink, job);
+  gst_buffer_unref (job->buf);
+  job->buf = NULL;
+
+  g_mutex_lock (&sink->lock);
+  job->done = TRUE;
+  for (job = &sink->jobs[sink->next_log % sink->max_pending];
+      sink->pending > 0 && job->done && job->frame == sink->next_log;
+      job = &sink->jobs[sink->next_log % sink->max_pending]) {
+    gst_videocrc_sink_log (sink, job);
+    job->done = FALSE;
+    sink->next_log++;
+    sink->pending--;
+  }
+  g_cond_broadcast (&sink->cond);
+  g_mutex_unlock (&sink->lock);
+}
+
+static void
+gst_videocrc_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (object);
+
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_free (sink->filename);
+      sink->filename = g_value_dup_string (value);
+      break;
+    case PROP_ALGORITHM:
+      sink->algorithm = g_value_get_enum (value);
+      break;
+    case PROP_CRC_MASK:
+      sink->polynomial = g_value_get_uint (value);
+      break;
+    case PROP_FINGERPRINT_BITS:
+      sink->fingerprint_bits = g_value_get_uint (value) > 64 ? 256 : 64;
+      break;
+    case PROP_N_WORKERS:
+      sink->n_workers = g_value_get_uint (value);
+      break;
+    case PROP_MAX_PENDING:
+      sink->max_pending = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_videocrc_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVideocrcSink *sink = GST_VIDEOCRC_SINK (object);
+
+  switch (prop_id) {
+    case PROP_LOCATION:
+      g_value_set_string (value, sink->filename);
+      break;
+    case PROP_ALGORITHM:
+      g_value_set_enum (value, sink->algorithm);
+      break;
+    case PROP_CRC_MASK:
+      g_value_set_uint (value, sink->polynomial);
+      break;
+    case PROP_FINGERPRINT_BITS:
+      g_value_set_uint (value, sink->fingerprint_bits);
+      break;
+    case PROP_N_WORKERS:
+      g_value_set_uint (value, sink->n_workers);
+      break;
+    case PROP_MAX_PENDING:
+      g_value_set_uint (value, sink->max_pending);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
@@ -0,0 +1,85 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_SINK_H__
+#define __GST_VIDEOCRC_SINK_H__
+
+#include <stdio.h>
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+#include <gst/video/video.h>
+#include "videocrc.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VIDEOCRC_SINK \
+  (gst_videocrc_sink_get_type())
+#define GST_VIDEOCRC_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VIDEOCRC_SINK,GstVideocrcSink))
+#define GST_VIDEOCRC_SINK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VIDEOCRC_SINK,GstVideocrcSinkClass))
+#define GST_IS_VIDEOCRC_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VIDEOCRC_SINK))
+#define GST_IS_VIDEOCRC_SINK_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_VIDEOCRC_SINK))
+typedef struct _GstVideocrcSink GstVideocrcSink;
+typedef struct _GstVideocrcSinkClass GstVideocrcSinkClass;
+
+/* a buffer between render and the log, slot frame % max_pending */
+typedef struct
+{
+  GstBuffer *buf;               /* released as soon as it is hashed */
+  guint32 frame;
+  gboolean done;
+  guint32 crc;
+  VideocrcFingerprint fingerprint;      /* n_bits 0 if CRCed */
+} GstVideocrcSinkJob;
+
+/**
+ * GstVideocrcSink:
+ *
+ * Opaque #GstVideocrcSink element structure
+ */
+struct _GstVideocrcSink
+{
+  GstBaseSink element;
+
+  /*< private > */
+  gchar *filename;
+  FILE *logfile;
+  guint algorithm;              /* GstVideocrcAlgorithm */
+  guint32 polynomial;
+  guint fingerprint_bits;
+  guint n_workers;              /* 0 = one per CPU */
+  guint max_pending;            /* buffers held at most */
+  VideocrcKernel kernel;
+  GstVideoInfo info;
+  gboolean have_info;           /* raw video caps */
+
+  GThreadPool *workers;
+  GMutex lock;                  /* guards what follows */
+  GCond cond;
+  GstVideocrcSinkJob *jobs;     /* max_pending slots */
+  guint32 frame_num;            /* frames rendered */
+  guint32 next_log;             /* next frame to log */
+  guint pending;                /* rendered, not logged yet */
+  gboolean flushing;
+};
+
+struct _GstVideocrcSinkClass
+{
+  GstBaseSinkClass parent_class;
+};
+
+GType gst_videocrc_sink_get_type (void);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_SINK_H__ */
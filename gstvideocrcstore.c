@@ -0,0 +1,190 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gstvideocrcstore.h"
+
+/* TRUE when @count entries of @size bytes from @offset are in the file */
+static gboolean
+gst_videocrc_store_fits (const GstVideocrcStore * store, guint64 offset,
+    guint64 count, gsize size)
+{
+  return offset <= store->size && count <= (store->size - offset) / size;
+}
+
+static gboolean
+gst_videocrc_store_valid (const GstVideocrcStore * store)
+{
+  const VideocrcStoreHeader *h = store->header;
+
+  return memcmp (h->magic, VIDEOCRC_STORE_MAGIC, sizeof (h->magic)) == 0 &&
+      h->byte_order == VIDEOCRC_STORE_BYTE_ORDER &&
+      h->key_frames > 0 && h->key_frames <= VIDEOCRC_STORE_MAX_KEY &&
+      h->n_buckets > h->n_streams && (h->n_buckets & (h->n_buckets - 1)) == 0
+      && h->streams % 8 == 0 && h->buckets % 8 == 0 && h->crcs % 4 == 0 &&
+      gst_videocrc_store_fits (store, h->streams, h->n_streams,
+      sizeof (VideocrcStoreStream)) &&
+      gst_videocrc_store_fits (store, h->buckets, h->n_buckets,
+      sizeof (VideocrcStoreBucket)) &&
+      gst_videocrc_store_fits (store, h->crcs, h->n_crcs, sizeof (guint32)) &&
+      h->names <= store->size;
+}
+
+/* maps @path shared, so every element on the host reads the same pages */
+gboolean
+gst_videocrc_store_open (GstVideocrcStore * store, const gchar * path)
+{
+  struct stat st;
+  gpointer map;
+  gint fd;
+
+  store->map = NULL;
+  fd = open (path, O_RDONLY);
+  if (fd < 0)
+    return FALSE;
+  if (fstat (fd, &st) < 0) {
+    close (fd);
+    return FALSE;
+  }
+  if ((gsize) st.st_size < sizeof (VideocrcStoreHeader)) {
+    close (fd);
+    errno = EINVAL;
+    return FALSE;
+  }
+  map = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    return FALSE;
+
+  store->map = map;
+  store->size = st.st_size;
+  store->header = map;
+  if (!gst_videocrc_store_valid (store)) {
+    gst_videocrc_store_close (store);
+    errno = EINVAL;
+    return FALSE;
+  }
+  gst_videocrc_store_reset (store);
+
+  return TRUE;
+}
+
+void
+gst_videocrc_store_close (GstVideocrcStore * store)
+{
+  if (store->map == NULL)
+    return;
+
+  munmap ((gpointer) store->map, store->size);
+  store->map = NULL;
+  store->stream = NULL;
+  store->crcs = NULL;
+}
+
+/* identifies again from the next frame 1 */
+void
+gst_videocrc_store_reset (GstVideocrcStore * store)
+{
+  store->state = GST_VIDEOCRC_STORE_COLLECTING;
+  store->n_key = 0;
+  store->stream = NULL;
+  store->crcs = NULL;
+}
+
+/* the stream whose first CRCs are the key, NULL if there is none */
+static const VideocrcStoreStream *
+gst_videocrc_store_lookup (const GstVideocrcStore * store)
+{
+  const VideocrcStoreHeader *h = store->header;
+  const VideocrcStoreBucket *buckets = (gconstpointer) (store->map +
+      h->buckets);
+  const VideocrcStoreStream *streams = (gconstpointer) (store->map +
+      h->streams);
+  const VideocrcStoreStream *s;
+  const guint32 *crcs = (gconstpointer) (store->map + h->crcs);
+  guint64 key = videocrc_store_key (store->key, store->n_key);
+  guint32 mask = h->n_buckets - 1, i, n;
+
+  for (i = key & mask, n = 0; n < h->n_buckets; i = (i + 1) & mask, n++) {
+    if (buckets[i].stream == 0 || buckets[i].stream > h->n_streams)
+      return NULL;
+    if (buckets[i].key != key)
+      continue;
+    s = &streams[buckets[i].stream - 1];
+    if (s->n_frames >= store->n_key && s->first <= h->n_crcs &&
+        s->n_frames <= h->n_crcs - s->first &&
+        memcmp (crcs + s->first, store->key,
+            store->n_key * sizeof (guint32)) == 0)
+      return s;
+  }
+
+  return NULL;
+}
+
+/* takes the CRC of @frame, counted from 1, while the stream is not known;
+ * returns TRUE when this identified it */
+gboolean
+gst_videocrc_store_add (GstVideocrcStore * store, guint frame, guint32 crc)
+{
+  const VideocrcStoreHeader *h = store->header;
+  const VideocrcStoreStream *s;
+  guintptr start, end;
+
+  if (store->state != GST_VIDEOCRC_STORE_COLLECTING)
+    return FALSE;
+  if (frame != store->n_key + 1) {
+    store->state = GST_VIDEOCRC_STORE_UNKNOWN;
+    return FALSE;
+  }
+  store->key[store->n_key++] = crc;
+  if (store->n_key < h->key_frames)
+    return FALSE;
+
+  s = gst_videocrc_store_lookup (store);
+  if (s == NULL) {
+    store->state = GST_VIDEOCRC_STORE_UNKNOWN;
+    return FALSE;
+  }
+  store->state = GST_VIDEOCRC_STORE_IDENTIFIED;
+  store->stream = s;
+  store->crcs = (const guint32 *) (store->map + h->crcs) + s->first;
+
+  /* the stream is read front to back from here on */
+  start = (guintptr) store->crcs & ~(guintptr) (getpagesize () - 1);
+  end = (guintptr) (store->crcs + s->n_frames);
+  madvise ((gpointer) start, end - start, MADV_WILLNEED);
+
+  return TRUE;
+}
+
+const gchar *
+gst_videocrc_store_name (const GstVideocrcStore * store)
+{
+  const gchar *names = (const gchar *) store->map + store->header->names;
+  gsize max = store->size - store->header->names;
+
+  if (store->stream == NULL || store->stream->name >= max ||
+      memchr (names + store->stream->name, '\0',
+          max - store->stream->name) == NULL)
+    return "?";
+
+  return names + store->stream->name;
+}
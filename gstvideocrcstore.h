@@ -0,0 +1,57 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_STORE_H__
+#define __GST_VIDEOCRC_STORE_H__
+
+#include <glib.h>
+#include "videocrc-store.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_VIDEOCRC_STORE_COLLECTING,        /* gathering the key frames */
+  GST_VIDEOCRC_STORE_IDENTIFIED,        /* verifying against stream */
+  GST_VIDEOCRC_STORE_UNKNOWN            /* not in the store, or a key frame
+                                         * was not hashed */
+} GstVideocrcStoreState;
+
+/**
+ * GstVideocrcStore:
+ *
+ * A reference store mapped read-only, see videocrc-store.h, and the stream
+ * it identified. The CRCs of frames 1 to key_frames are collected as they
+ * are hashed and looked up once the last one is in; a hit is confirmed
+ * against the stored CRCs, so a key collision can't select a wrong stream.
+ */
+typedef struct
+{
+  const guint8 *map;            /* NULL when no store is open */
+  gsize size;
+  const VideocrcStoreHeader *header;
+  GstVideocrcStoreState state;
+  guint32 key[VIDEOCRC_STORE_MAX_KEY];
+  guint n_key;
+  const VideocrcStoreStream *stream;    /* once identified */
+  const guint32 *crcs;                  /* of stream */
+} GstVideocrcStore;
+
+gboolean      gst_videocrc_store_open     (GstVideocrcStore * store,
+                                           const gchar * path);
+void          gst_videocrc_store_close    (GstVideocrcStore * store);
+void          gst_videocrc_store_reset    (GstVideocrcStore * store);
+gboolean      gst_videocrc_store_add      (GstVideocrcStore * store,
+                                           guint frame, guint32 crc);
+const gchar * gst_videocrc_store_name     (const GstVideocrcStore * store);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_STORE_H__ */
@@ -0,0 +1,307 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstvideocrctune.h"
+
+#define GST_VIDEOCRC_TUNE_SAMPLES 3     /* frames per candidate */
+
+enum
+{
+  STAGE_ENGINE,
+  STAGE_THREADS,
+  STAGE_CHUNK,
+  STAGE_DONE
+};
+
+static const guint tune_threads[] = { 1, 2, 4, 8 };
+static const guint tune_chunks[] = { 64, 256, 1024, 4096 };
+
+static gchar *
+gst_videocrc_tuner_cache_file (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "videocrc", "tuning.ini",
+      NULL);
+}
+
+static gchar *
+gst_videocrc_tuner_cpu_model (void)
+{
+  static const gchar *fields[] = { "model name", "Hardware", "CPU part" };
+  gchar *contents = NULL, *model = NULL;
+  gchar **lines;
+  guint f, i;
+
+  if (!g_file_get_contents ("/proc/cpuinfo", &contents, NULL, NULL))
+    return g_strdup ("unknown");
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (f = 0; f < G_N_ELEMENTS (fields) && model == NULL; f++) {
+    for (i = 0; lines[i] && model == NULL; i++) {
+      gchar *colon = strchr (lines[i], ':');
+
+      if (colon && g_str_has_prefix (lines[i], fields[f]))
+        model = g_strstrip (g_strdup (colon + 1));
+    }
+  }
+  g_strfreev (lines);
+  g_free (contents);
+
+  return model ? model : g_strdup ("unknown");
+}
+
+static const gchar *
+gst_videocrc_tuner_resolution_class (guint width, guint height)
+{
+  guint64 pixels = (guint64) width * height;
+
+  if (pixels <= 720 * 576)
+    return "sd";
+  if (pixels <= 1280 * 720)
+    return "hd";
+  if (pixels <= 1920 * 1088)
+    return "fhd";
+  if (pixels <= 4096 * 2160)
+    return "uhd";
+  return "8k";
+}
+
+/* fills @t with candidate @idx of @stage on top of the stage's base
+ * configuration, FALSE when the stage has no more candidates */
+static gboolean
+gst_videocrc_tuner_candidate (GstVideocrcTuner * tuner, guint stage,
+    guint idx, GstVideocrcTuning * t)
+{
+  *t = tuner->best;
+
+  switch (stage) {
+    case STAGE_ENGINE:
+      /* engines after the reference one, skipping unavailable ones */
+      for (t->engine = VIDEOCRC_ENGINE_AUTO + 1;
+          t->engine < VIDEOCRC_ENGINE_LAST; t->engine++) {
+        if ((tuner->engines & (1u << t->engine)) && idx-- == 0)
+          return TRUE;
+      }
+      return FALSE;
+    case STAGE_THREADS:
+      if (idx >= G_N_ELEMENTS (tune_threads) ||
+          tune_threads[idx] > tuner->max_threads)
+        return FALSE;
+      t->threads = tune_threads[idx];
+      return TRUE;
+    case STAGE_CHUNK:
+      if (idx >= G_N_ELEMENTS (tune_chunks))
+        return FALSE;
+      t->chunk = tune_chunks[idx];
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+typedef struct
+{
+  gchar *key;
+  GstVideocrcTuning best;
+} GstVideocrcTuneEntry;
+
+static gpointer
+gst_videocrc_tuner_write (gpointer data)
+{
+  GstVideocrcTuneEntry *entry = data;
+  GKeyFile *keyfile = g_key_file_new ();
+  gchar *file = gst_videocrc_tuner_cache_file ();
+  gchar *dir = g_path_get_dirname (file);
+  gchar *contents;
+  gsize len;
+
+  g_key_file_load_from_file (keyfile, file, G_KEY_FILE_KEEP_COMMENTS, NULL);
+  g_key_file_set_string (keyfile, entry->key, "engine",
+      videocrc_engine_name (entry->best.engine));
+  g_key_file_set_integer (keyfile, entry->key, "threads", entry->best.threads);
+  g_key_file_set_integer (keyfile, entry->key, "chunk", entry->best.chunk);
+
+  /* g_file_set_contents () renames into place, concurrent pipelines never
+   * see a partial file */
+  contents = g_key_file_to_data (keyfile, &len, NULL);
+  if (g_mkdir_with_parents (dir, 0755) == 0)
+    g_file_set_contents (file, contents, len, NULL);
+
+  g_free (contents);
+  g_free (dir);
+  g_free (file);
+  g_key_file_free (keyfile);
+  g_free (entry->key);
+  g_free (entry);
+
+  return NULL;
+}
+
+/* the cache file is read, rewritten and synced on a thread of its own, the
+ * streaming thread only hands the winner over */
+static void
+gst_videocrc_tuner_save (GstVideocrcTuner * tuner)
+{
+  GstVideocrcTuneEntry *entry = g_new (GstVideocrcTuneEntry, 1);
+  GThread *thread;
+
+  entry->key = g_strdup (tuner->key);
+  entry->best = tuner->best;
+  thread = g_thread_try_new ("videocrc-tune", gst_videocrc_tuner_write,
+      entry, NULL);
+  if (thread != NULL)
+    g_thread_unref (thread);
+  else
+    gst_videocrc_tuner_write (entry);
+}
+
+static gboolean
+gst_videocrc_tuner_load (GstVideocrcTuner * tuner)
+{
+  GKeyFile *keyfile = g_key_file_new ();
+  gchar *file = gst_videocrc_tuner_cache_file ();
+  gchar *engine = NULL;
+  gboolean ret = FALSE;
+
+  if (g_key_file_load_from_file (keyfile, file, G_KEY_FILE_NONE, NULL) &&
+      g_key_file_has_group (keyfile, tuner->key)) {
+    engine = g_key_file_get_string (keyfile, tuner->key, "engine", NULL);
+    tuner->best.engine = videocrc_engine_from_name (engine);
+    tuner->best.threads = CLAMP (g_key_file_get_integer (keyfile, tuner->key,
+            "threads", NULL), 1, (gint) tuner->max_threads);
+    tuner->best.chunk = CLAMP (g_key_file_get_integer (keyfile, tuner->key,
+            "chunk", NULL), 1, VIDEOCRC_MAX_CHUNK);
+    /* a cache written by a build with other engines is recalibrated */
+    ret = (tuner->engines & (1u << tuner->best.engine)) != 0;
+  }
+
+  g_free (engine);
+  g_free (file);
+  g_key_file_free (keyfile);
+
+  return ret;
+}
+
+void
+gst_videocrc_tuner_init (GstVideocrcTuner * tuner, guint max_threads)
+{
+  memset (tuner, 0, sizeof (GstVideocrcTuner));
+  tuner->max_threads = MAX (max_threads, 1);
+  tuner->best.engine = VIDEOCRC_ENGINE_AUTO;
+  tuner->best.threads = 1;
+  tuner->best.chunk = VIDEOCRC_DEFAULT_CHUNK;
+  tuner->current = tuner->best;
+}
+
+void
+gst_videocrc_tuner_clear (GstVideocrcTuner * tuner)
+{
+  g_free (tuner->key);
+  tuner->key = NULL;
+  tuner->state = GST_VIDEOCRC_TUNE_OFF;
+}
+
+/* returns TRUE when a cached configuration was found */
+gboolean
+gst_videocrc_tuner_begin (GstVideocrcTuner * tuner,
+    const VideocrcKernel * kernel, const gchar * format, guint width,
+    guint height, const gchar * memory)
+{
+  gchar *cpu = gst_videocrc_tuner_cpu_model ();
+  VideocrcEngine engine;
+
+  /* which engines apply depends on the polynomial, so it is in the key */
+  tuner->engines = 0;
+  for (engine = VIDEOCRC_ENGINE_AUTO + 1; engine < VIDEOCRC_ENGINE_LAST;
+      engine++)
+    if (videocrc_kernel_supports (kernel, engine))
+      tuner->engines |= 1u << engine;
+
+  g_free (tuner->key);
+  tuner->key = g_strdup_printf ("%s|%s|%s|%s|%u|%08X%s", cpu, format,
+      gst_videocrc_tuner_resolution_class (width, height), memory,
+      tuner->max_threads, kernel->poly, kernel->reflected ? "r" : "");
+  /* group names can't hold brackets */
+  g_strdelimit (tuner->key, "[]", '_');
+  g_free (cpu);
+
+  if (gst_videocrc_tuner_load (tuner)) {
+    tuner->state = GST_VIDEOCRC_TUNE_CACHED;
+    tuner->current = tuner->best;
+    return TRUE;
+  }
+
+  tuner->state = GST_VIDEOCRC_TUNE_CALIBRATING;
+  tuner->best.engine = VIDEOCRC_ENGINE_AUTO;
+  tuner->best.threads = 1;
+  tuner->best.chunk = VIDEOCRC_DEFAULT_CHUNK;
+  tuner->stage = STAGE_ENGINE;
+  tuner->candidate = 0;
+  tuner->sample = 0;
+  tuner->candidate_ns = G_MAXUINT64;
+  tuner->best_ns = G_MAXUINT64;
+  gst_videocrc_tuner_candidate (tuner, tuner->stage, 0, &tuner->current);
+
+  return FALSE;
+}
+
+void
+gst_videocrc_tuner_record (GstVideocrcTuner * tuner, guint64 hash_ns)
+{
+  if (tuner->state != GST_VIDEOCRC_TUNE_CALIBRATING)
+    return;
+
+  tuner->candidate_ns = MIN (tuner->candidate_ns, hash_ns);
+  if (++tuner->sample < GST_VIDEOCRC_TUNE_SAMPLES)
+    return;
+
+  if (tuner->candidate_ns < tuner->best_ns) {
+    tuner->best_ns = tuner->candidate_ns;
+    tuner->best = tuner->current;
+  }
+  tuner->sample = 0;
+  tuner->candidate_ns = G_MAXUINT64;
+
+  /* next candidate of this stage, or the first of the next stage that has
+   * any; the stage winner is the base configuration of the next stage */
+  tuner->candidate++;
+  while (!gst_videocrc_tuner_candidate (tuner, tuner->stage,
+          tuner->candidate, &tuner->current)) {
+    if (++tuner->stage == STAGE_DONE) {
+      tuner->current = tuner->best;
+      tuner->state = GST_VIDEOCRC_TUNE_CALIBRATED;
+      gst_videocrc_tuner_save (tuner);
+      return;
+    }
+    tuner->candidate = 0;
+    tuner->best_ns = G_MAXUINT64;
+  }
+}
+
+const gchar *
+gst_videocrc_tuner_state_name (GstVideocrcTuneState state)
+{
+  switch (state) {
+    case GST_VIDEOCRC_TUNE_CALIBRATING:
+      return "calibrating";
+    case GST_VIDEOCRC_TUNE_CALIBRATED:
+      return "calibrated";
+    case GST_VIDEOCRC_TUNE_CACHED:
+      return "cached";
+    default:
+      return "off";
+  }
+}
@@ -0,0 +1,79 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __GST_VIDEOCRC_TUNE_H__
+#define __GST_VIDEOCRC_TUNE_H__
+
+#include <glib.h>
+#include "videocrc.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_VIDEOCRC_TUNE_OFF,
+  GST_VIDEOCRC_TUNE_CALIBRATING,
+  GST_VIDEOCRC_TUNE_CALIBRATED,
+  GST_VIDEOCRC_TUNE_CACHED
+} GstVideocrcTuneState;
+
+/**
+ * GstVideocrcTuning:
+ *
+ * One hashing configuration. Every configuration yields the same CRC, they
+ * only differ in speed.
+ */
+typedef struct
+{
+  VideocrcEngine engine;
+  guint threads;
+  guint chunk;
+} GstVideocrcTuning;
+
+typedef struct _GstVideocrcTuner GstVideocrcTuner;
+
+/**
+ * GstVideocrcTuner:
+ *
+ * Calibrates on the first frames of a stream, so the measurements include
+ * the real memory type, and keeps the winners in a cache file under the
+ * user cache directory keyed by CPU model, format, resolution class,
+ * memory type and polynomial. The stages tune the engine, then the thread count, then the
+ * chunk size, each candidate keeping its fastest of a few frames.
+ */
+struct _GstVideocrcTuner
+{
+  GstVideocrcTuneState state;
+  gchar *key;
+  guint max_threads;
+  guint engines;                /* engines the kernel supports, by bit */
+  GstVideocrcTuning current;    /* configuration to use for the next frame */
+  GstVideocrcTuning best;
+  guint stage;
+  guint candidate;
+  guint sample;
+  guint64 candidate_ns;
+  guint64 best_ns;
+};
+
+void        gst_videocrc_tuner_init   (GstVideocrcTuner * tuner,
+                                       guint max_threads);
+void        gst_videocrc_tuner_clear  (GstVideocrcTuner * tuner);
+gboolean    gst_videocrc_tuner_begin  (GstVideocrcTuner * tuner,
+                                       const VideocrcKernel * kernel,
+                                       const gchar * format, guint width,
+                                       guint height, const gchar * memory);
+void        gst_videocrc_tuner_record (GstVideocrcTuner * tuner,
+                                       guint64 hash_ns);
+const gchar *gst_videocrc_tuner_state_name (GstVideocrcTuneState state);
+
+G_END_DECLS
+#endif /* __GST_VIDEOCRC_TUNE_H__ */
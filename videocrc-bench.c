@@ -0,0 +1,310 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * videocrc-bench: what the videocrc element costs per frame beyond the CRC.
+ *
+ *   videocrc-bench [-f FORMAT] [-W WIDTH -H HEIGHT] [-n FRAMES] [-o LOG]
+ *                  [-p PROPERTY=VALUE]... [-a]
+ *
+ * One frame (I420 QCIF, 176x144, by default) is pushed FRAMES times from a
+ * pad of our own into identity, then into videocrc logging to LOG
+ * (/dev/null by default), and the time per push is printed in nanoseconds
+ * next to the CRC of the same bytes through libvideocrc alone. The frame
+ * stays referenced while it is pushed, as behind a tee, so an element that
+ * wants it writable pays for a copy. What videocrc costs beyond identity
+ * and the CRC is its per-frame bookkeeping. -p sets a videocrc property,
+ * to time a mode, e.g. -p digests=crc64 -p hash-chain=true.
+ *
+ * -a also counts heap allocations (malloc and friends, interposed below)
+ * while the timed frames go through, after the warm-up, and fails when
+ * videocrc makes more than identity: the steady state must not allocate,
+ * or a hundred instances in a process contend for the allocator. Frames
+ * that post messages (mismatches, alarms) do allocate them.
+ *
+ * The plugin must be found through GST_PLUGIN_PATH. Run without GST_DEBUG
+ * to see the cost of a production pipeline.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "videocrc.h"
+
+#define WARMUP 1000             /* frames pushed before timing */
+#define MAX_PROPERTIES 32
+
+/* glibc's allocator under the interposed entry points */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *p, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+
+static gint counting;           /* count allocations while set */
+static gint n_allocs;
+
+static inline void
+count_alloc (void)
+{
+  if (g_atomic_int_get (&counting))
+    g_atomic_int_inc (&n_allocs);
+}
+
+void *
+malloc (size_t size)
+{
+  count_alloc ();
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  count_alloc ();
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *p, size_t size)
+{
+  count_alloc ();
+  return __libc_realloc (p, size);
+}
+
+void *
+memalign (size_t alignment, size_t size)
+{
+  count_alloc ();
+  return __libc_memalign (alignment, size);
+}
+
+void *
+aligned_alloc (size_t alignment, size_t size)
+{
+  count_alloc ();
+  return __libc_memalign (alignment, size);
+}
+
+int
+posix_memalign (void **p, size_t alignment, size_t size)
+{
+  count_alloc ();
+  *p = __libc_memalign (alignment, size);
+  return *p ? 0 : ENOMEM;
+}
+
+static void
+usage (const char *argv0)
+{
+  fprintf (stderr, "usage: %s [-f FORMAT] [-W WIDTH -H HEIGHT] [-n FRAMES] "
+      "[-o LOG] [-p PROPERTY=VALUE]... [-a]\n", argv0);
+  exit (2);
+}
+
+static GstFlowReturn
+bench_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_OK;
+}
+
+/* ns per frame through @element, which is consumed; @allocs gets the
+ * heap allocations made while timing */
+static gdouble
+bench_element (GstElement * element, GstCaps * caps, GstBuffer * buf,
+    guint n_frames, guint * allocs)
+{
+  GstPad *src, *sink, *element_sink, *element_src;
+  GstSegment segment;
+  GstClockTime start, elapsed;
+  guint i;
+
+  src = gst_pad_new ("src", GST_PAD_SRC);
+  sink = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sink, bench_chain);
+  element_sink = gst_element_get_static_pad (element, "sink");
+  element_src = gst_element_get_static_pad (element, "src");
+  gst_pad_link (src, element_sink);
+  gst_pad_link (element_src, sink);
+  gst_pad_set_active (src, TRUE);
+  gst_pad_set_active (sink, TRUE);
+  gst_element_set_state (element, GST_STATE_PLAYING);
+
+  gst_pad_push_event (src, gst_event_new_stream_start ("videocrc-bench"));
+  gst_pad_push_event (src, gst_event_new_caps (caps));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (src, gst_event_new_segment (&segment));
+
+  for (i = 0; i < WARMUP; i++)
+    gst_pad_push (src, gst_buffer_ref (buf));
+  g_atomic_int_set (&n_allocs, 0);
+  g_atomic_int_set (&counting, 1);
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < n_frames; i++)
+    gst_pad_push (src, gst_buffer_ref (buf));
+  elapsed = gst_util_get_timestamp () - start;
+  g_atomic_int_set (&counting, 0);
+  *allocs = g_atomic_int_get (&n_allocs);
+
+  gst_pad_push_event (src, gst_event_new_eos ());
+  gst_element_set_state (element, GST_STATE_NULL);
+  gst_pad_set_active (src, FALSE);
+  gst_pad_set_active (sink, FALSE);
+  gst_object_unref (element_sink);
+  gst_object_unref (element_src);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (element);
+
+  return (gdouble) elapsed / n_frames;
+}
+
+/* ns per frame of the element's default CRC over @data */
+static gdouble
+bench_hash (const guint8 * data, gsize size, guint n_frames)
+{
+  static VideocrcKernel k;
+  GstClockTime start, elapsed;
+  volatile guint32 crc;
+  guint i;
+
+  videocrc_kernel_init (&k, VIDEOCRC_DEFAULT_POLY, 0, VIDEOCRC_ENGINE_AUTO);
+  for (i = 0; i < WARMUP; i++)
+    crc = videocrc_buffer (&k, data, size);
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < n_frames; i++)
+    crc = videocrc_buffer (&k, data, size);
+  elapsed = gst_util_get_timestamp () - start;
+  (void) crc;
+
+  return (gdouble) elapsed / n_frames;
+}
+
+static GstElement *
+make_element (const gchar * factory)
+{
+  GstElement *element = gst_element_factory_make (factory, NULL);
+
+  if (element == NULL) {
+    fprintf (stderr, "no %s element, is GST_PLUGIN_PATH set?\n", factory);
+    exit (1);
+  }
+
+  return element;
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *format = "I420", *output = "/dev/null";
+  gchar *properties[MAX_PROPERTIES], *value;
+  guint n_properties = 0, identity_allocs, videocrc_allocs;
+  gboolean check_allocs = FALSE;
+  guint width = 176, height = 144, n_frames = 100000;
+  GstElement *videocrc;
+  GstVideoInfo info;
+  GstMapInfo map;
+  GstBuffer *buf;
+  GstCaps *caps;
+  gdouble hash_ns, identity_ns, videocrc_ns;
+  gsize i;
+  int opt;
+
+  gst_init (&argc, &argv);
+
+  while ((opt = getopt (argc, argv, "f:W:H:n:o:p:a")) != -1) {
+    switch (opt) {
+      case 'f':
+        format = optarg;
+        break;
+      case 'W':
+        width = strtoul (optarg, NULL, 0);
+        break;
+      case 'H':
+        height = strtoul (optarg, NULL, 0);
+        break;
+      case 'n':
+        n_frames = strtoul (optarg, NULL, 0);
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'p':
+        if (n_properties == MAX_PROPERTIES || !strchr (optarg, '='))
+          usage (argv[0]);
+        properties[n_properties++] = optarg;
+        break;
+      case 'a':
+        check_allocs = TRUE;
+        break;
+      default:
+        usage (argv[0]);
+    }
+  }
+  if (optind != argc || width == 0 || height == 0 || n_frames == 0)
+    usage (argv[0]);
+
+  gst_video_info_init (&info);
+  if (!gst_video_info_set_format (&info, gst_video_format_from_string (format),
+          width, height)) {
+    fprintf (stderr, "can't describe %s %ux%u\n", format, width, height);
+    return 1;
+  }
+  caps = gst_video_info_to_caps (&info);
+
+  buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < map.size; i++)
+    map.data[i] = i * 7;
+
+  printf ("%s %ux%u, %" G_GSIZE_FORMAT " bytes, %u frames\n", format, width,
+      height, map.size, n_frames);
+
+  hash_ns = bench_hash (map.data, map.size, n_frames);
+  gst_buffer_unmap (buf, &map);
+  identity_ns = bench_element (make_element ("identity"), caps, buf,
+      n_frames, &identity_allocs);
+  videocrc = make_element ("videocrc");
+  g_object_set (videocrc, "location", output, NULL);
+  for (i = 0; i < n_properties; i++) {
+    value = strchr (properties[i], '=');
+    *value++ = '\0';
+    if (!g_object_class_find_property (G_OBJECT_GET_CLASS (videocrc),
+            properties[i])) {
+      fprintf (stderr, "videocrc has no property %s\n", properties[i]);
+      return 1;
+    }
+    gst_util_set_object_arg (G_OBJECT (videocrc), properties[i], value);
+  }
+  videocrc_ns = bench_element (videocrc, caps, buf, n_frames,
+      &videocrc_allocs);
+
+  printf ("crc alone  %10.1f ns/frame\n", hash_ns);
+  printf ("identity   %10.1f ns/frame\n", identity_ns);
+  printf ("videocrc   %10.1f ns/frame\n", videocrc_ns);
+  printf ("overhead   %10.1f ns/frame (videocrc - identity - crc)\n",
+      videocrc_ns - identity_ns - hash_ns);
+  if (check_allocs)
+    printf ("allocations: identity %u, videocrc %u in %u frames\n",
+        identity_allocs, videocrc_allocs, n_frames);
+
+  gst_buffer_unref (buf);
+  gst_caps_unref (caps);
+
+  return check_allocs && videocrc_allocs > identity_allocs ? 1 : 0;
+}
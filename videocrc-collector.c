@@ -0,0 +1,239 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * videocrc-collector: reference collector for videocrc elements streaming
+ * their CRC records with socket-path=PATH.
+ *
+ *   videocrc-collector [-d DIR] PATH
+ *
+ * Records of all connected streams are merged on stdout in arrival order as
+ * "NAME VideoFrame N crc XXXXXXXX". With -d each stream is also written to
+ * DIR/NAME.log in the element's own log format. Records carry only the
+ * first 32 bits of a fingerprint, logged as "fingerprint XXXXXXXX...".
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "videocrc-socket.h"
+
+#define MAX_CLIENTS 1024
+
+typedef struct
+{
+  char name[VIDEOCRC_SOCK_NAME_LEN];
+  uint64_t dropped;
+  FILE *log;
+} Client;
+
+static struct pollfd fds[1 + MAX_CLIENTS];
+static Client clients[1 + MAX_CLIENTS];
+static int n_fds;
+static const char *log_dir;
+
+static void
+usage (const char *argv0)
+{
+  fprintf (stderr, "usage: %s [-d DIR] PATH\n", argv0);
+  exit (2);
+}
+
+static void
+client_close (int i)
+{
+  if (clients[i].log)
+    fclose (clients[i].log);
+  close (fds[i].fd);
+  n_fds--;
+  fds[i] = fds[n_fds];
+  clients[i] = clients[n_fds];
+}
+
+static void
+client_hello (Client * c, const VideocrcSockHeader * h)
+{
+  char path[4096];
+  char *p;
+
+  memcpy (c->name, h->name, sizeof (c->name));
+  c->name[sizeof (c->name) - 1] = '\0';
+  /* the name ends up in a file name */
+  for (p = c->name; *p; p++)
+    if (*p == '/')
+      *p = '_';
+  c->dropped = h->dropped;
+
+  fprintf (stderr, "# %s connected (pid %" PRId64 ")\n", c->name, h->pid);
+
+  if (log_dir) {
+    snprintf (path, sizeof (path), "%s/%s.log", log_dir, c->name);
+    c->log = fopen (path, "w");
+    if (c->log == NULL)
+      fprintf (stderr, "%s: %s\n", path, strerror (errno));
+  }
+}
+
+static void
+client_records (Client * c, const VideocrcSockPacket * pkt)
+{
+  const VideocrcSockHeader *h = &pkt->header;
+  uint32_t i;
+
+  if (h->dropped != c->dropped) {
+    printf ("# %s dropped %" PRIu64 " records\n", c->name,
+        h->dropped - c->dropped);
+    c->dropped = h->dropped;
+  }
+
+  for (i = 0; i < h->count; i++) {
+    const VideocrcSockRecord *r = &pkt->records[i];
+
+    if (r->flags & VIDEOCRC_SOCK_FLAG_SKIPPED) {
+      printf ("%s VideoFrame %" PRIu64 " skipped\n", c->name, r->frame);
+      if (c->log)
+        fprintf (c->log, "VideoFrame %" PRIu64 " skipped\n", r->frame);
+      continue;
+    }
+    if (r->flags & VIDEOCRC_SOCK_FLAG_FINGERPRINT) {
+      printf ("%s VideoFrame %" PRIu64 " fingerprint %08X...\n", c->name,
+          r->frame, r->crc);
+      /* only the first 32 bits travel, marked so a reference reader
+       * leaves the frame unverified rather than taking it for a 32-bit
+       * fingerprint */
+      if (c->log)
+        fprintf (c->log, "VideoFrame %" PRIu64 " fingerprint %08X...\n",
+            r->frame, r->crc);
+      continue;
+    }
+    printf ("%s VideoFrame %" PRIu64 " crc %08X\n", c->name, r->frame, r->crc);
+    if (c->log)
+      fprintf (c->log, "VideoFrame %" PRIu64 " crc %08X\n", r->frame, r->crc);
+  }
+}
+
+/* returns 0 when the client went away or sent garbage */
+static int
+client_read (int i)
+{
+  VideocrcSockPacket pkt;
+  const VideocrcSockHeader *h = &pkt.header;
+  ssize_t len;
+
+  len = recv (fds[i].fd, &pkt, sizeof (pkt), 0);
+  if (len < 0)
+    return errno == EAGAIN || errno == EINTR;
+  if (len < (ssize_t) sizeof (VideocrcSockHeader))
+    return 0;
+  if (h->magic != VIDEOCRC_SOCK_MAGIC || h->version != VIDEOCRC_SOCK_VERSION
+      || h->count > VIDEOCRC_SOCK_MAX_BATCH
+      || (size_t) len != VIDEOCRC_SOCK_PACKET_SIZE (h->count))
+    return 0;
+
+  switch (h->type) {
+    case VIDEOCRC_SOCK_HELLO:
+      client_hello (&clients[i], h);
+      break;
+    case VIDEOCRC_SOCK_RECORDS:
+      client_records (&clients[i], &pkt);
+      break;
+    default:
+      return 0;
+  }
+
+  return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct sockaddr_un addr;
+  int opt, lfd, i;
+
+  while ((opt = getopt (argc, argv, "d:")) != -1) {
+    switch (opt) {
+      case 'd':
+        log_dir = optarg;
+        break;
+      default:
+        usage (argv[0]);
+    }
+  }
+  if (optind != argc - 1)
+    usage (argv[0]);
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen (argv[optind]) >= sizeof (addr.sun_path)) {
+    fprintf (stderr, "%s: path too long\n", argv[optind]);
+    return 1;
+  }
+  strcpy (addr.sun_path, argv[optind]);
+
+  lfd = socket (AF_UNIX, SOCK_SEQPACKET, 0);
+  unlink (addr.sun_path);
+  if (lfd < 0 || bind (lfd, (struct sockaddr *) &addr, sizeof (addr)) < 0
+      || listen (lfd, 64) < 0) {
+    perror (argv[optind]);
+    return 1;
+  }
+
+  fds[0].fd = lfd;
+  fds[0].events = POLLIN;
+  n_fds = 1;
+
+  for (;;) {
+    if (poll (fds, n_fds, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror ("poll");
+      return 1;
+    }
+
+    /* walk backwards, client_close () moves the last entry into the hole */
+    for (i = n_fds - 1; i > 0; i--) {
+      if (fds[i].revents & POLLIN) {
+        if (!client_read (i)) {
+          fprintf (stderr, "# %s disconnected\n", clients[i].name);
+          client_close (i);
+        }
+      } else if (fds[i].revents & (POLLHUP | POLLERR)) {
+        fprintf (stderr, "# %s disconnected\n", clients[i].name);
+        client_close (i);
+      }
+    }
+    fflush (stdout);
+
+    if (fds[0].revents & POLLIN) {
+      int cfd = accept (lfd, NULL, NULL);
+
+      if (cfd >= 0 && n_fds < 1 + MAX_CLIENTS) {
+        fds[n_fds].fd = cfd;
+        fds[n_fds].events = POLLIN;
+        fds[n_fds].revents = 0;
+        memset (&clients[n_fds], 0, sizeof (Client));
+        strcpy (clients[n_fds].name, "unnamed");
+        n_fds++;
+      } else if (cfd >= 0) {
+        close (cfd);
+      }
+    }
+  }
+
+  return 0;
+}
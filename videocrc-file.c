@@ -0,0 +1,410 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * videocrc-file: CRC log of a raw YUV or Y4M file without a pipeline.
+ *
+ *   videocrc-file [-f nv12|i420|y4m] [-W WIDTH -H HEIGHT] [-s STRIDE]
+ *                 [-S ROWS] [-a] [-l] [-p POLY] [-e ENGINE] [-j THREADS]
+ *                 [-o LOG] FILE
+ *   videocrc-file -T
+ *
+ * The file is memory-mapped and frames are hashed in parallel. The log has
+ * the element's format, "VideoFrame N crc XXXXXXXX" with N counted from 1.
+ *
+ * By default every byte of a frame is hashed, which is what the element
+ * logs for buffers without an ION fd. -l hashes with the element's plane
+ * walk instead (luma, then Cb, then Cr, inverted after each), as done for
+ * ION buffers. -a applies the element's ION alignment, 128 bytes per row
+ * and 32 rows per plane, to a raw NV12 dump; -s and -S set them directly.
+ *
+ * For Y4M the frame payload is hashed as stored, which matches what y4mdec
+ * pushes when the width is a multiple of 8.
+ *
+ * -e forces a CRC engine (bytewise, slice8, pmull, armv8-crc). -T checks
+ * every engine this CPU has against the bytewise reference for several
+ * polynomials, lengths and alignments; cross-built for AArch64 it runs
+ * under qemu-aarch64 on a development host.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "videocrc.h"
+
+#define ALIGN(num, to) (((num) + ((to) - 1)) & ~((to) - 1))
+#define GRAB 16                 /* frames a worker takes at once */
+
+typedef enum
+{
+  FORMAT_NONE,
+  FORMAT_NV12,
+  FORMAT_I420,
+  FORMAT_Y4M
+} Format;
+
+typedef struct
+{
+  VideocrcKernel kernel;
+  Format format;
+  int legacy;
+  uint32_t width, height, stride, rows;
+  const uint8_t **frames;       /* start of each frame's payload */
+  size_t frame_size;
+  size_t n_frames;
+  size_t next;                  /* next frame to hash, atomic */
+  uint32_t *crcs;
+  unsigned int fingerprint_bits;        /* 0 = CRCs */
+  VideocrcFingerprint *fingerprints;
+} Job;
+
+static void
+usage (const char *argv0)
+{
+  fprintf (stderr, "usage: %s [-f nv12|i420|y4m] [-W WIDTH -H HEIGHT] "
+      "[-s STRIDE] [-S ROWS] [-a] [-l] [-p POLY] [-e ENGINE] [-j THREADS] "
+      "[-P BITS] [-o LOG] FILE\n       %s -T\n", argv0, argv0);
+  exit (2);
+}
+
+/* every engine against the bytewise reference, returns the failure count */
+static int
+self_test (void)
+{
+  static const struct
+  {
+    uint32_t poly;
+    int reflected;
+  } polys[] = {
+    { VIDEOCRC_DEFAULT_POLY, 0 },
+    { VIDEOCRC_CRC32C_POLY, 0 },
+    { 0x814141ABu, 0 },         /* CRC-32Q */
+    { VIDEOCRC_CRC32_POLY, 1 },
+    { VIDEOCRC_CRC32C_POLY, 1 },
+    { 0x741B8CD7u, 1 },         /* CRC-32K */
+  };
+  static VideocrcKernel ref, k;
+  uint8_t buf[2048 + 16];
+  size_t p, len, off;
+  uint32_t seed = 1, crc;
+  int e, bad, failures = 0;
+
+  for (off = 0; off < sizeof (buf); off++) {
+    seed = seed * 1103515245u + 12345u;
+    buf[off] = seed >> 16;
+  }
+
+  for (p = 0; p < sizeof (polys) / sizeof (polys[0]); p++) {
+    videocrc_kernel_init (&ref, polys[p].poly, polys[p].reflected,
+        VIDEOCRC_ENGINE_BYTEWISE);
+    for (e = VIDEOCRC_ENGINE_AUTO + 1; e < VIDEOCRC_ENGINE_LAST; e++) {
+      videocrc_kernel_init (&k, polys[p].poly, polys[p].reflected, e);
+      if (k.engine != (VideocrcEngine) e)
+        continue;
+      bad = 0;
+      for (len = 0; len <= 2048; len += len < 256 ? 1 : 61) {
+        for (off = 0; off < 16; off++) {
+          crc = seed = seed * 1103515245u + 12345u;
+          if (videocrc_update (&ref, crc, buf + off, len) !=
+              videocrc_update (&k, crc, buf + off, len))
+            bad++;
+        }
+      }
+      printf ("%-10s %08X%s %s\n", videocrc_engine_name (e), polys[p].poly,
+          polys[p].reflected ? " reflected" : "", bad ? "FAILED" : "ok");
+      failures += bad;
+    }
+  }
+
+  return failures;
+}
+
+static uint32_t
+hash_frame (const Job * job, const uint8_t * data)
+{
+  VideocrcPlane planes[VIDEOCRC_MAX_PLANES];
+  unsigned int n;
+
+  if (!job->legacy)
+    return videocrc_buffer (&job->kernel, data, job->frame_size);
+
+  if (job->format == FORMAT_NV12)
+    n = videocrc_nv12_planes (planes, data, job->width, job->height,
+        job->stride, job->rows);
+  else
+    n = videocrc_i420_planes (planes, data, job->width, job->height,
+        job->stride, (job->stride + 1) / 2);
+
+  return videocrc_frame (&job->kernel, planes, n);
+}
+
+/* of the luma plane, which starts every supported format */
+static void
+fingerprint_frame (const Job * job, const uint8_t * data,
+    VideocrcFingerprint * fp)
+{
+  VideocrcPlane luma;
+
+  luma.data = data;
+  luma.stride = job->stride;
+  luma.width = job->width;
+  luma.height = job->height;
+  luma.step = 1;
+  videocrc_fingerprint (&luma, job->fingerprint_bits, fp);
+}
+
+static void *
+worker (void *data)
+{
+  Job *job = data;
+  size_t first, i;
+
+  for (;;) {
+    first = __atomic_fetch_add (&job->next, GRAB, __ATOMIC_RELAXED);
+    if (first >= job->n_frames)
+      break;
+    for (i = first; i < first + GRAB && i < job->n_frames; i++) {
+      if (job->fingerprint_bits)
+        fingerprint_frame (job, job->frames[i], &job->fingerprints[i]);
+      else
+        job->crcs[i] = hash_frame (job, job->frames[i]);
+    }
+  }
+
+  return NULL;
+}
+
+/* fills job->frames with the payload of every FRAME, returns 0 on a
+ * malformed stream */
+static int
+index_y4m (Job * job, const uint8_t * data, size_t size)
+{
+  const uint8_t *p = data, *end = data + size, *eol;
+  size_t alloc = 0;
+  char header[256];
+  const char *c;
+
+  eol = memchr (p, '\n', size);
+  if (eol == NULL || (size_t) (eol - p) >= sizeof (header))
+    return 0;
+  memcpy (header, p, eol - p);
+  header[eol - p] = '\0';
+  p = eol + 1;
+
+  for (c = strchr (header, ' '); c; c = strchr (c + 1, ' ')) {
+    if (c[1] == 'W')
+      job->width = strtoul (c + 2, NULL, 10);
+    else if (c[1] == 'H')
+      job->height = strtoul (c + 2, NULL, 10);
+    else if (c[1] == 'C' && strncmp (c + 2, "420", 3) != 0) {
+      fprintf (stderr, "only 4:2:0 Y4M is supported\n");
+      return 0;
+    }
+  }
+  if (job->width == 0 || job->height == 0)
+    return 0;
+
+  job->stride = job->width;
+  job->frame_size = (size_t) job->width * job->height +
+      2 * (size_t) ((job->width + 1) / 2) * ((job->height + 1) / 2);
+
+  while (p < end) {
+    if (end - p < 5 || memcmp (p, "FRAME", 5) != 0)
+      return 0;
+    eol = memchr (p, '\n', end - p);
+    if (eol == NULL || (size_t) (end - eol - 1) < job->frame_size) {
+      /* a reference log must not silently stop short */
+      fprintf (stderr, "frame %zu is truncated\n", job->n_frames + 1);
+      return 0;
+    }
+    if (job->n_frames == alloc) {
+      alloc = alloc ? 2 * alloc : 1024;
+      job->frames = realloc (job->frames, alloc * sizeof (*job->frames));
+    }
+    job->frames[job->n_frames++] = eol + 1;
+    p = eol + 1 + job->frame_size;
+  }
+
+  return 1;
+}
+
+static void
+index_raw (Job * job, const uint8_t * data, size_t size)
+{
+  size_t i;
+
+  if (job->format == FORMAT_NV12)
+    job->frame_size = (size_t) job->stride * job->rows +
+        (size_t) job->stride * ((job->rows + 1) / 2);
+  else
+    job->frame_size = (size_t) job->stride * job->height +
+        2 * (size_t) ((job->stride + 1) / 2) * ((job->height + 1) / 2);
+
+  job->n_frames = size / job->frame_size;
+  job->frames = malloc ((job->n_frames + 1) * sizeof (*job->frames));
+  for (i = 0; i < job->n_frames; i++)
+    job->frames[i] = data + i * job->frame_size;
+}
+
+int
+main (int argc, char **argv)
+{
+  Job job;
+  const char *format = NULL, *output = NULL;
+  uint32_t poly = VIDEOCRC_DEFAULT_POLY;
+  VideocrcEngine engine = VIDEOCRC_ENGINE_AUTO;
+  int opt, fd, align = 0;
+  long n_threads = sysconf (_SC_NPROCESSORS_ONLN);
+  pthread_t *threads;
+  const uint8_t *data;
+  struct stat st;
+  FILE *log = stdout;
+  size_t i;
+
+  memset (&job, 0, sizeof (job));
+
+  while ((opt = getopt (argc, argv, "f:W:H:s:S:alp:e:j:o:P:T")) != -1) {
+    switch (opt) {
+      case 'f':
+        format = optarg;
+        break;
+      case 'W':
+        job.width = strtoul (optarg, NULL, 0);
+        break;
+      case 'H':
+        job.height = strtoul (optarg, NULL, 0);
+        break;
+      case 's':
+        job.stride = strtoul (optarg, NULL, 0);
+        break;
+      case 'S':
+        job.rows = strtoul (optarg, NULL, 0);
+        break;
+      case 'a':
+        align = 1;
+        break;
+      case 'l':
+        job.legacy = 1;
+        break;
+      case 'p':
+        poly = strtoul (optarg, NULL, 0);
+        break;
+      case 'e':
+        engine = videocrc_engine_from_name (optarg);
+        if (!videocrc_engine_available (engine)) {
+          fprintf (stderr, "engine %s not available\n", optarg);
+          return 1;
+        }
+        break;
+      case 'T':
+        return self_test () ? 1 : 0;
+      case 'j':
+        n_threads = strtol (optarg, NULL, 0);
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'P':
+        job.fingerprint_bits = strtoul (optarg, NULL, 0) > 64 ? 256 : 64;
+        break;
+      default:
+        usage (argv[0]);
+    }
+  }
+  if (optind != argc - 1)
+    usage (argv[0]);
+  if (n_threads < 1)
+    n_threads = 1;
+
+  fd = open (argv[optind], O_RDONLY);
+  if (fd < 0 || fstat (fd, &st) < 0) {
+    perror (argv[optind]);
+    return 1;
+  }
+  if (st.st_size == 0)
+    return 0;
+  data = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED) {
+    perror ("mmap");
+    return 1;
+  }
+  madvise ((void *) data, st.st_size, MADV_SEQUENTIAL);
+
+  if (format == NULL)
+    job.format = st.st_size >= 10 && memcmp (data, "YUV4MPEG2 ", 10) == 0 ?
+        FORMAT_Y4M : FORMAT_NONE;
+  else if (strcmp (format, "nv12") == 0)
+    job.format = FORMAT_NV12;
+  else if (strcmp (format, "i420") == 0)
+    job.format = FORMAT_I420;
+  else if (strcmp (format, "y4m") == 0)
+    job.format = FORMAT_Y4M;
+
+  if (job.format == FORMAT_Y4M) {
+    if (!index_y4m (&job, data, st.st_size)) {
+      fprintf (stderr, "%s: malformed Y4M stream\n", argv[optind]);
+      return 1;
+    }
+  } else if (job.format != FORMAT_NONE && job.width && job.height) {
+    if (job.stride == 0)
+      job.stride = align ? ALIGN (job.width, 128) : job.width;
+    if (job.rows == 0)
+      job.rows = align ? ALIGN (job.height, 32) : job.height;
+    index_raw (&job, data, st.st_size);
+  } else {
+    fprintf (stderr, "raw input needs -f nv12|i420, -W and -H\n");
+    return 1;
+  }
+
+  videocrc_kernel_init (&job.kernel, poly, 0, engine);
+  if (job.kernel.engine != engine && engine != VIDEOCRC_ENGINE_AUTO)
+    fprintf (stderr, "engine %s can't do this polynomial, using %s\n",
+        videocrc_engine_name (engine), videocrc_engine_name (job.kernel.engine));
+  job.crcs = malloc ((job.n_frames + 1) * sizeof (uint32_t));
+  if (job.fingerprint_bits)
+    job.fingerprints = malloc ((job.n_frames + 1) *
+        sizeof (VideocrcFingerprint));
+
+  if ((size_t) n_threads > job.n_frames / GRAB + 1)
+    n_threads = job.n_frames / GRAB + 1;
+  threads = malloc (n_threads * sizeof (pthread_t));
+  for (i = 0; i < (size_t) n_threads; i++)
+    pthread_create (&threads[i], NULL, worker, &job);
+  for (i = 0; i < (size_t) n_threads; i++)
+    pthread_join (threads[i], NULL);
+
+  if (output && (log = fopen (output, "w")) == NULL) {
+    perror (output);
+    return 1;
+  }
+  for (i = 0; i < job.n_frames; i++) {
+    if (job.fingerprint_bits) {
+      char hex[VIDEOCRC_FINGERPRINT_STRLEN];
+
+      videocrc_fingerprint_to_string (&job.fingerprints[i], hex);
+      fprintf (log, "VideoFrame %zu fingerprint %s\n", i + 1, hex);
+    } else {
+      fprintf (log, "VideoFrame %zu crc %08X\n", i + 1, job.crcs[i]);
+    }
+  }
+  if (log != stdout)
+    fclose (log);
+
+  return 0;
+}
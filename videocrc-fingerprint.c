@@ -0,0 +1,217 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * Perceptual fingerprint of a luma plane: the plane is box-averaged to a
+ * VIDEOCRC_FINGERPRINT_GRID square grid in one pass over its rows, the grid
+ * goes through a 2D DCT-II and every coefficient of the low-frequency
+ * corner (8x8 for 64 bits, 16x16 for 256 bits) gives one bit, set when it
+ * is above the corner's median. Re-encoding, scaling and mild filtering
+ * keep most bits, so frames are matched by Hamming distance.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "videocrc.h"
+
+#define GRID VIDEOCRC_FINGERPRINT_GRID
+#define VIDEOCRC_PI 3.14159265358979323846
+
+/* sum of @n bytes */
+static uint32_t
+videocrc_sum_u8 (const uint8_t * p, size_t n)
+{
+  uint32_t sum = 0;
+
+#if defined (__SSE2__)
+  __m128i acc = _mm_setzero_si128 ();
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; n >= 16; n -= 16, p += 16)
+    acc = _mm_add_epi64 (acc,
+        _mm_sad_epu8 (_mm_loadu_si128 ((const __m128i *) p), zero));
+  sum = _mm_cvtsi128_si32 (acc) + _mm_cvtsi128_si32 (_mm_srli_si128 (acc, 8));
+#elif defined (__ARM_NEON)
+  uint32x4_t acc = vdupq_n_u32 (0);
+
+  for (; n >= 16; n -= 16, p += 16)
+    acc = vpadalq_u16 (acc, vpaddlq_u8 (vld1q_u8 (p)));
+  sum = vgetq_lane_u32 (acc, 0) + vgetq_lane_u32 (acc, 1) +
+      vgetq_lane_u32 (acc, 2) + vgetq_lane_u32 (acc, 3);
+#endif
+
+  for (; n > 0; n--)
+    sum += *p++;
+
+  return sum;
+}
+
+/* sum of @n samples @step bytes apart */
+static uint32_t
+videocrc_sum_step (const uint8_t * p, size_t n, uint32_t step)
+{
+  uint32_t sum = 0;
+
+  if (step == 1)
+    return videocrc_sum_u8 (p, n);
+
+  for (; n > 0; n--, p += step)
+    sum += *p;
+
+  return sum;
+}
+
+/* first and one past last source index of grid cell @i, never empty */
+static void
+videocrc_cell (uint32_t i, uint32_t size, uint32_t * first, uint32_t * end)
+{
+  *first = (uint64_t) i * size / GRID;
+  *end = (uint64_t) (i + 1) * size / GRID;
+  if (*end <= *first)
+    *end = *first + 1;
+}
+
+static int
+videocrc_compare_double (const void *a, const void *b)
+{
+  double va = *(const double *) a;
+  double vb = *(const double *) b;
+
+  return (va > vb) - (va < vb);
+}
+
+void
+videocrc_fingerprint (const VideocrcPlane * luma, unsigned int n_bits,
+    VideocrcFingerprint * fp)
+{
+  double grid[GRID][GRID], basis[16][GRID], rows[16][GRID];
+  double coef[16 * 16], sorted[16 * 16], median;
+  uint64_t sums[GRID];
+  uint32_t x0[GRID], x1[GRID], y0, y1, gx, gy, y, k, l, i, n;
+  const uint8_t *row;
+
+  memset (fp, 0, sizeof (VideocrcFingerprint));
+  n = n_bits > 64 ? 16 : 8;
+  fp->n_bits = n * n;
+  if (luma->width == 0 || luma->height == 0)
+    return;
+
+  /* box average, rows in memory order */
+  for (gx = 0; gx < GRID; gx++)
+    videocrc_cell (gx, luma->width, &x0[gx], &x1[gx]);
+  for (gy = 0; gy < GRID; gy++) {
+    videocrc_cell (gy, luma->height, &y0, &y1);
+    memset (sums, 0, sizeof (sums));
+    for (y = y0; y < y1 && y < luma->height; y++) {
+      row = luma->data + (size_t) y * luma->stride;
+      for (gx = 0; gx < GRID && x0[gx] < luma->width; gx++)
+        sums[gx] += videocrc_sum_step (row + (size_t) x0[gx] * luma->step,
+            x1[gx] - x0[gx], luma->step);
+    }
+    for (gx = 0; gx < GRID; gx++)
+      grid[gy][gx] = x0[gx] < luma->width ?
+          (double) sums[gx] / ((y1 - y0) * (x1[gx] - x0[gx])) : 0.0;
+  }
+
+  /* low-frequency corner of the DCT-II, rows then columns */
+  for (k = 0; k < n; k++)
+    for (i = 0; i < GRID; i++)
+      basis[k][i] = cos (VIDEOCRC_PI * (2 * i + 1) * k / (2 * GRID));
+  for (k = 0; k < n; k++)
+    for (gx = 0; gx < GRID; gx++) {
+      rows[k][gx] = 0.0;
+      for (gy = 0; gy < GRID; gy++)
+        rows[k][gx] += basis[k][gy] * grid[gy][gx];
+    }
+  for (k = 0; k < n; k++)
+    for (l = 0; l < n; l++) {
+      coef[k * n + l] = 0.0;
+      for (gx = 0; gx < GRID; gx++)
+        coef[k * n + l] += rows[k][gx] * basis[l][gx];
+    }
+
+  memcpy (sorted, coef, n * n * sizeof (double));
+  qsort (sorted, n * n, sizeof (double), videocrc_compare_double);
+  median = (sorted[n * n / 2 - 1] + sorted[n * n / 2]) / 2;
+
+  /* bit 0 is the most significant bit of the first word */
+  for (i = 0; i < n * n; i++)
+    if (coef[i] > median)
+      fp->bits[i / 64] |= (uint64_t) 1 << (63 - i % 64);
+}
+
+unsigned int
+videocrc_fingerprint_distance (const VideocrcFingerprint * a,
+    const VideocrcFingerprint * b)
+{
+  unsigned int i, d = 0;
+  uint64_t v;
+
+  if (a->n_bits != b->n_bits)
+    return VIDEOCRC_FINGERPRINT_MAX_BITS;
+
+  for (i = 0; i < (a->n_bits + 63) / 64; i++)
+    for (v = a->bits[i] ^ b->bits[i]; v; v &= v - 1)
+      d++;
+
+  return d;
+}
+
+void
+videocrc_fingerprint_to_string (const VideocrcFingerprint * fp, char *str)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  unsigned int i;
+
+  for (i = 0; i < fp->n_bits / 4; i++)
+    *str++ = hex[(fp->bits[i / 16] >> (60 - 4 * (i % 16))) & 0xF];
+  *str = '\0';
+}
+
+int
+videocrc_fingerprint_from_string (VideocrcFingerprint * fp, const char *str)
+{
+  unsigned int i, len = 0;
+  int v;
+
+  memset (fp, 0, sizeof (VideocrcFingerprint));
+  while (str[len] && str[len] != ' ' && str[len] != '\n')
+    len++;
+  if (len != 16 && len != 64)
+    return 0;
+
+  for (i = 0; i < len; i++) {
+    if (str[i] >= '0' && str[i] <= '9')
+      v = str[i] - '0';
+    else if (str[i] >= 'A' && str[i] <= 'F')
+      v = str[i] - 'A' + 10;
+    else if (str[i] >= 'a' && str[i] <= 'f')
+      v = str[i] - 'a' + 10;
+    else
+      return 0;
+    fp->bits[i / 16] |= (uint64_t) v << (60 - 4 * (i % 16));
+  }
+  fp->n_bits = len * 4;
+
+  return 1;
+}
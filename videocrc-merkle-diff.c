@@ -0,0 +1,170 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * videocrc-merkle-diff: the first frame where two recordings differ, from
+ * the Merkle indexes the videocrc element wrote with merkle-index=FILE.
+ *
+ *   videocrc-merkle-diff [-q] INDEX_A INDEX_B
+ *
+ * The peaks over the frames both indexes have are compared from the left;
+ * under the first peak that differs only the mismatching child is followed
+ * down to a leaf, so two hours at 60 fps take some 40 node reads instead of
+ * two logs. Prints "identical, N frames", or the first frame that differs
+ * (or where the shorter recording ends) as numbered in the CRC log, with
+ * the nodes read; -q prints nothing. Exits 0 when identical, 1 when the
+ * recordings differ and 2 on errors. A partly written index is compared as
+ * far as its nodes are complete.
+ */
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "videocrc-merkle.h"
+
+typedef struct
+{
+  const char *path;
+  int fd;
+  uint64_t n_leaves;
+} MerkleIndex;
+
+static uint64_t n_reads;
+
+static void
+usage (const char *argv0)
+{
+  fprintf (stderr, "usage: %s [-q] INDEX_A INDEX_B\n", argv0);
+  exit (2);
+}
+
+static void
+index_open (MerkleIndex * index, const char *path)
+{
+  VideocrcMerkleHeader header;
+  struct stat st;
+
+  index->path = path;
+  index->fd = open (path, O_RDONLY);
+  if (index->fd < 0 || fstat (index->fd, &st) != 0) {
+    perror (path);
+    exit (2);
+  }
+  if (pread (index->fd, &header, sizeof (header), 0) != sizeof (header) ||
+      memcmp (header.magic, VIDEOCRC_MERKLE_MAGIC, sizeof (header.magic))) {
+    fprintf (stderr, "%s: not a videocrc Merkle index\n", path);
+    exit (2);
+  }
+  index->n_leaves = videocrc_merkle_leaves ((st.st_size -
+          VIDEOCRC_MERKLE_HEADER) / VIDEOCRC_MERKLE_NODE);
+}
+
+static void
+index_node (const MerkleIndex * index, unsigned h, uint64_t i, uint8_t * node)
+{
+  off_t offset = VIDEOCRC_MERKLE_HEADER +
+      videocrc_merkle_pos (h, i) * VIDEOCRC_MERKLE_NODE;
+
+  if (pread (index->fd, node, VIDEOCRC_MERKLE_NODE, offset) !=
+      VIDEOCRC_MERKLE_NODE) {
+    fprintf (stderr, "%s: can't read node %u/%" PRIu64 "\n", index->path, h,
+        i);
+    exit (2);
+  }
+  n_reads++;
+}
+
+static int
+node_differs (const MerkleIndex * a, const MerkleIndex * b, unsigned h,
+    uint64_t i)
+{
+  uint8_t node_a[VIDEOCRC_MERKLE_NODE], node_b[VIDEOCRC_MERKLE_NODE];
+
+  index_node (a, h, i, node_a);
+  index_node (b, h, i, node_b);
+
+  return memcmp (node_a, node_b, VIDEOCRC_MERKLE_NODE) != 0;
+}
+
+/* index of the first leaf that differs under node (@h, @i), which does:
+ * when the left child matches the difference is in the right one */
+static uint64_t
+descend (const MerkleIndex * a, const MerkleIndex * b, unsigned h, uint64_t i)
+{
+  while (h > 0) {
+    h--;
+    i *= 2;
+    if (!node_differs (a, b, h, i))
+      i++;
+  }
+
+  return i;
+}
+
+int
+main (int argc, char **argv)
+{
+  MerkleIndex a, b;
+  uint64_t n, start = 0, first;
+  int quiet = 0, opt, h;
+
+  while ((opt = getopt (argc, argv, "q")) != -1) {
+    switch (opt) {
+      case 'q':
+        quiet = 1;
+        break;
+      default:
+        usage (argv[0]);
+    }
+  }
+  if (argc - optind != 2)
+    usage (argv[0]);
+
+  index_open (&a, argv[optind]);
+  index_open (&b, argv[optind + 1]);
+  n = a.n_leaves < b.n_leaves ? a.n_leaves : b.n_leaves;
+
+  /* the peaks over n frames, the highest first */
+  first = n;
+  for (h = 63; h >= 0; h--) {
+    if (!(n & (UINT64_C (1) << h)))
+      continue;
+    if (node_differs (&a, &b, h, start >> h)) {
+      first = descend (&a, &b, h, start >> h);
+      break;
+    }
+    start += UINT64_C (1) << h;
+  }
+
+  if (first == n && a.n_leaves == b.n_leaves) {
+    if (!quiet)
+      printf ("identical, %" PRIu64 " frames (%" PRIu64 " nodes read)\n", n,
+          n_reads);
+    return 0;
+  }
+
+  if (!quiet) {
+    if (first < n)
+      printf ("first difference at frame %" PRIu64 " (%" PRIu64
+          " nodes read)\n", first + 1, n_reads);
+    else
+      printf ("first difference at frame %" PRIu64 ": %s ends after %"
+          PRIu64 " frames (%" PRIu64 " nodes read)\n", n + 1,
+          a.n_leaves < b.n_leaves ? a.path : b.path, n, n_reads);
+  }
+
+  return 1;
+}
@@ -0,0 +1,83 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __VIDEOCRC_MERKLE_H__
+#define __VIDEOCRC_MERKLE_H__
+
+/*
+ * Layout of the Merkle index written by the videocrc element when
+ * merkle-index is set, and read by videocrc-merkle-diff.
+ *
+ * Leaf i is the SHA-256 of frame i + 1's hash-chain record (see
+ * gstvideocrcchain.h) with its PTS all ones, so two runs of the same
+ * content give the same leaves. The node of height h and index i is the
+ * SHA-256 of its two children side by side and covers frames
+ * i * 2^h + 1 to (i + 1) * 2^h. Nodes are appended in the order they
+ * complete (a Merkle mountain range), which is post-order: the nodes over
+ * the first n frames are the same in any longer index, and node (h, i) is
+ * at videocrc_merkle_pos (h, i) whatever the length of the recording.
+ *
+ * The file is a 32-byte header followed by the 32-byte nodes. The header
+ * has the frame count once the element reached EOS or stopped, 0 while it
+ * writes; a reader can always take the longest complete range from the
+ * file size with videocrc_merkle_leaves ().
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VIDEOCRC_MERKLE_MAGIC   "VCRCMRK1"
+#define VIDEOCRC_MERKLE_NODE    32              /* bytes, a SHA-256 */
+#define VIDEOCRC_MERKLE_HEADER  32              /* bytes */
+
+typedef struct
+{
+  char magic[8];                /* VIDEOCRC_MERKLE_MAGIC, no terminator */
+  uint8_t n_leaves[8];          /* little-endian, 0 until complete */
+  uint8_t reserved[16];
+} VideocrcMerkleHeader;
+
+/* nodes in a range over @n_leaves frames */
+static inline uint64_t
+videocrc_merkle_size (uint64_t n_leaves)
+{
+  return 2 * n_leaves - __builtin_popcountll (n_leaves);
+}
+
+/* node of height @h and index @i, counted from the first node; it follows
+ * every node over the frames before its last one and its h descendants
+ * ending on that frame */
+static inline uint64_t
+videocrc_merkle_pos (unsigned h, uint64_t i)
+{
+  return videocrc_merkle_size (((i + 1) << h) - 1) + h;
+}
+
+/* frames whose range is complete within @n_nodes nodes */
+static inline uint64_t
+videocrc_merkle_leaves (uint64_t n_nodes)
+{
+  uint64_t n = n_nodes / 2 + 32;      /* size (n) >= 2n - 64 */
+
+  while (n > 0 && videocrc_merkle_size (n) > n_nodes)
+    n--;
+
+  return n;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VIDEOCRC_MERKLE_H__ */
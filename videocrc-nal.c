@@ -0,0 +1,192 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * Units of encoded elementary streams: NAL units of H.264 and H.265 Annex B
+ * byte-streams, found with a vectorised start-code scan, and OBUs of AV1
+ * low-overhead streams, found from their size fields. Each unit is hashed
+ * window by window right behind the scan, while the bytes are still cached.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "videocrc.h"
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* bytes scanned before they are hashed */
+#define VIDEOCRC_UNIT_WINDOW 4096
+
+size_t
+videocrc_find_start_code (const uint8_t * data, size_t len)
+{
+  size_t i = 0;
+
+#if defined (__SSE2__)
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i one = _mm_set1_epi8 (1);
+  __m128i a, b, c;
+  int mask;
+
+  /* a match at i needs data[i + 2], so the last vector ends 2 bytes early */
+  for (; i + 18 <= len; i += 16) {
+    a = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i)), zero);
+    b = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i + 1)),
+        zero);
+    c = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i + 2)),
+        one);
+    mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_and_si128 (a, b), c));
+    if (mask)
+      return i + __builtin_ctz (mask);
+  }
+#elif defined (__ARM_NEON)
+  uint64x2_t m;
+
+  /* the vector only finds the block, the scalar loop the position */
+  for (; i + 18 <= len; i += 16) {
+    m = vreinterpretq_u64_u8 (vandq_u8 (vandq_u8 (vceqq_u8 (vld1q_u8 (data +
+                        i), vdupq_n_u8 (0)), vceqq_u8 (vld1q_u8 (data + i + 1),
+                    vdupq_n_u8 (0))), vceqq_u8 (vld1q_u8 (data + i + 2),
+                vdupq_n_u8 (1))));
+    if (vgetq_lane_u64 (m, 0) | vgetq_lane_u64 (m, 1))
+      break;
+  }
+#endif
+
+  for (; i + 3 <= len; i++)
+    if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+      return i;
+
+  return len;
+}
+
+static void
+videocrc_unit_classify (VideocrcCodec codec, VideocrcUnit * unit,
+    uint8_t header)
+{
+  switch (codec) {
+    case VIDEOCRC_CODEC_H264:
+      unit->type = header & 0x1f;
+      unit->kind = unit->type == 6 ? VIDEOCRC_UNIT_SEI :
+          unit->type == 9 ? VIDEOCRC_UNIT_AUD : VIDEOCRC_UNIT_OTHER;
+      break;
+    case VIDEOCRC_CODEC_H265:
+      unit->type = (header >> 1) & 0x3f;
+      unit->kind = (unit->type == 39 || unit->type == 40) ? VIDEOCRC_UNIT_SEI :
+          unit->type == 35 ? VIDEOCRC_UNIT_AUD : VIDEOCRC_UNIT_OTHER;
+      break;
+    case VIDEOCRC_CODEC_AV1:
+      unit->type = (header >> 3) & 0xf;
+      unit->kind = unit->type == 5 ? VIDEOCRC_UNIT_SEI :
+          unit->type == 2 ? VIDEOCRC_UNIT_AUD : VIDEOCRC_UNIT_OTHER;
+      break;
+    default:
+      unit->type = 0;
+      unit->kind = VIDEOCRC_UNIT_OTHER;
+      break;
+  }
+}
+
+/* a NAL unit runs from after its start code to the next one, without the
+ * trailing zero bytes, which belong to the stream and not to the unit */
+static size_t
+videocrc_unit_next_annexb (const VideocrcKernel * k, VideocrcCodec codec,
+    const uint8_t * data, size_t size, size_t pos, VideocrcUnit * unit)
+{
+  size_t start, scan, hashed, end, stop, last, n, sc;
+  uint32_t crc = k->init;
+
+  pos += videocrc_find_start_code (data + pos, size - pos);
+  if (pos >= size)
+    return 0;
+
+  start = scan = hashed = pos + 3;
+  for (;;) {
+    end = scan + VIDEOCRC_UNIT_WINDOW < size ? scan + VIDEOCRC_UNIT_WINDOW :
+        size;
+    n = (end + 2 < size ? end + 2 : size) - scan;
+    sc = videocrc_find_start_code (data + scan, n);
+    stop = sc < end - scan ? scan + sc : end;
+
+    /* zeros before the window end are hashed with the next window if the
+     * unit goes on */
+    for (last = stop; last > hashed && data[last - 1] == 0; last--);
+    crc = k->update (k, crc, data + hashed, last - hashed);
+    hashed = last;
+    if (stop < end || end == size)
+      break;
+    scan = end;
+  }
+
+  unit->offset = start;
+  unit->size = hashed - start;
+  unit->crc = ~crc;
+  videocrc_unit_classify (codec, unit, unit->size ? data[start] : 0);
+
+  return stop;
+}
+
+/* an OBU with obu_has_size_field set ends where its leb128 size says, one
+ * without it at the end of the buffer */
+static size_t
+videocrc_unit_next_obu (const VideocrcKernel * k, const uint8_t * data,
+    size_t size, size_t pos, VideocrcUnit * unit)
+{
+  uint64_t payload = 0;
+  size_t header;
+  unsigned int i;
+
+  if (pos >= size)
+    return 0;
+
+  header = 1 + ((data[pos] >> 2) & 1);
+  if (data[pos] & 0x02) {
+    for (i = 0; i < 8; i++) {
+      if (pos + header >= size)
+        return 0;
+      payload |= (uint64_t) (data[pos + header] & 0x7f) << (7 * i);
+      if (!(data[pos + header++] & 0x80))
+        break;
+    }
+  }
+  if (pos + header > size)
+    return 0;
+  if (!(data[pos] & 0x02) || payload > size - pos - header)
+    payload = size - pos - header;
+
+  unit->offset = pos;
+  unit->size = header + payload;
+  unit->crc = ~k->update (k, k->init, data + pos, unit->size);
+  videocrc_unit_classify (VIDEOCRC_CODEC_AV1, unit, data[pos]);
+
+  return pos + unit->size;
+}
+
+size_t
+videocrc_unit_next (const VideocrcKernel * k, VideocrcCodec codec,
+    const uint8_t * data, size_t size, size_t pos, VideocrcUnit * unit)
+{
+  switch (codec) {
+    case VIDEOCRC_CODEC_H264:
+    case VIDEOCRC_CODEC_H265:
+      return videocrc_unit_next_annexb (k, codec, data, size, pos, unit);
+    case VIDEOCRC_CODEC_AV1:
+      return videocrc_unit_next_obu (k, data, size, pos, unit);
+    default:
+      return 0;
+  }
+}
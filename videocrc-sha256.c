@@ -0,0 +1,229 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * SHA-256 fed one 64-byte block at a time, for hash chains that cost one
+ * compression per record. The compression uses the x86 SHA extensions or
+ * the ARMv8 SHA-2 instructions when the CPU has them, portable C otherwise.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "videocrc.h"
+
+#if defined (__aarch64__) && defined (__linux__) && !defined (__AARCH64EB__)
+#define VIDEOCRC_HAVE_AARCH64 1
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#elif (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define VIDEOCRC_HAVE_SHA_NI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static const uint32_t videocrc_sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t videocrc_sha256_iv[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
+  0x1f83d9ab, 0x5be0cd19
+};
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void
+videocrc_sha256_compress_c (uint32_t * state, const uint8_t * block)
+{
+  uint32_t w[64], s[8], t1, t2;
+  int i;
+
+  for (i = 0; i < 16; i++)
+    w[i] = ((uint32_t) block[4 * i] << 24) |
+        ((uint32_t) block[4 * i + 1] << 16) |
+        ((uint32_t) block[4 * i + 2] << 8) | block[4 * i + 3];
+  for (i = 16; i < 64; i++)
+    w[i] = w[i - 16] + w[i - 7] +
+        (ROR32 (w[i - 15], 7) ^ ROR32 (w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+        (ROR32 (w[i - 2], 17) ^ ROR32 (w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+  memcpy (s, state, sizeof (s));
+  for (i = 0; i < 64; i++) {
+    t1 = s[7] + (ROR32 (s[4], 6) ^ ROR32 (s[4], 11) ^ ROR32 (s[4], 25)) +
+        ((s[4] & s[5]) ^ (~s[4] & s[6])) + videocrc_sha256_k[i] + w[i];
+    t2 = (ROR32 (s[0], 2) ^ ROR32 (s[0], 13) ^ ROR32 (s[0], 22)) +
+        ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+    memmove (s + 1, s, 7 * sizeof (uint32_t));
+    s[4] += t1;
+    s[0] = t1 + t2;
+  }
+
+  for (i = 0; i < 8; i++)
+    state[i] += s[i];
+}
+
+#ifdef VIDEOCRC_HAVE_SHA_NI
+/* message words are kept four to a register, m[i & 3] holding W[4i..4i+3];
+ * the rounds want the state as ABEF and CDGH */
+__attribute__ ((target ("sha,sse4.1")))
+static void
+videocrc_sha256_compress_sha_ni (uint32_t * state, const uint8_t * block)
+{
+  const __m128i bswap = _mm_set_epi64x (0x0c0d0e0f08090a0bULL,
+      0x0405060700010203ULL);
+  __m128i abef, cdgh, abef_save, cdgh_save, m[4], wk, tmp;
+  int i;
+
+  tmp = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *) state), 0xB1);
+  cdgh = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *) (state + 4)),
+      0x1B);
+  abef = _mm_alignr_epi8 (tmp, cdgh, 8);
+  cdgh = _mm_blend_epi16 (cdgh, tmp, 0xF0);
+  abef_save = abef;
+  cdgh_save = cdgh;
+
+  for (i = 0; i < 4; i++)
+    m[i] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (block +
+                16 * i)), bswap);
+
+  for (i = 0; i < 16; i++) {
+    if (i >= 4) {
+      tmp = _mm_add_epi32 (_mm_sha256msg1_epu32 (m[i & 3], m[(i + 1) & 3]),
+          _mm_alignr_epi8 (m[(i + 3) & 3], m[(i + 2) & 3], 4));
+      m[i & 3] = _mm_sha256msg2_epu32 (tmp, m[(i + 3) & 3]);
+    }
+    wk = _mm_add_epi32 (m[i & 3],
+        _mm_loadu_si128 ((const __m128i *) (videocrc_sha256_k + 4 * i)));
+    cdgh = _mm_sha256rnds2_epu32 (cdgh, abef, wk);
+    abef = _mm_sha256rnds2_epu32 (abef, cdgh, _mm_shuffle_epi32 (wk, 0x0E));
+  }
+
+  abef = _mm_add_epi32 (abef, abef_save);
+  cdgh = _mm_add_epi32 (cdgh, cdgh_save);
+  tmp = _mm_shuffle_epi32 (abef, 0x1B);
+  cdgh = _mm_shuffle_epi32 (cdgh, 0xB1);
+  _mm_storeu_si128 ((__m128i *) state, _mm_blend_epi16 (tmp, cdgh, 0xF0));
+  _mm_storeu_si128 ((__m128i *) (state + 4), _mm_alignr_epi8 (cdgh, tmp, 8));
+}
+
+static int
+videocrc_sha256_have_sha_ni (void)
+{
+  unsigned int eax, ebx, ecx, edx;
+
+  /* SSE4.1 is CPUID.1:ECX bit 19, SHA is CPUID.(7,0):EBX bit 29 */
+  if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx) || !(ecx & (1u << 19)))
+    return 0;
+  if (__get_cpuid_max (0, NULL) < 7)
+    return 0;
+  __cpuid_count (7, 0, eax, ebx, ecx, edx);
+
+  return (ebx & (1u << 29)) != 0;
+}
+#endif
+
+#ifdef VIDEOCRC_HAVE_AARCH64
+/* the instructions are only used after the HWCAP check */
+#pragma GCC push_options
+#pragma GCC target ("+crypto")
+#include <arm_neon.h>
+
+static void
+videocrc_sha256_compress_armv8 (uint32_t * state, const uint8_t * block)
+{
+  uint32x4_t abcd, efgh, abcd0, m[4], wk;
+  const uint32x4_t abcd_save = vld1q_u32 (state);
+  const uint32x4_t efgh_save = vld1q_u32 (state + 4);
+  int i;
+
+  for (i = 0; i < 4; i++)
+    m[i] = vreinterpretq_u32_u8 (vrev32q_u8 (vld1q_u8 (block + 16 * i)));
+
+  abcd = abcd_save;
+  efgh = efgh_save;
+  for (i = 0; i < 16; i++) {
+    if (i >= 4)
+      m[i & 3] = vsha256su1q_u32 (vsha256su0q_u32 (m[i & 3],
+              m[(i + 1) & 3]), m[(i + 2) & 3], m[(i + 3) & 3]);
+    wk = vaddq_u32 (m[i & 3], vld1q_u32 (videocrc_sha256_k + 4 * i));
+    abcd0 = abcd;
+    abcd = vsha256hq_u32 (abcd, efgh, wk);
+    efgh = vsha256h2q_u32 (efgh, abcd0, wk);
+  }
+
+  vst1q_u32 (state, vaddq_u32 (abcd, abcd_save));
+  vst1q_u32 (state + 4, vaddq_u32 (efgh, efgh_save));
+}
+#pragma GCC pop_options
+#endif
+
+void
+videocrc_sha256_init (VideocrcSha256 * s)
+{
+  memcpy (s->state, videocrc_sha256_iv, sizeof (s->state));
+  s->n_blocks = 0;
+  s->compress = videocrc_sha256_compress_c;
+  s->engine = "c";
+
+#if defined (VIDEOCRC_HAVE_SHA_NI)
+  if (videocrc_sha256_have_sha_ni ()) {
+    s->compress = videocrc_sha256_compress_sha_ni;
+    s->engine = "sha-ni";
+  }
+#elif defined (VIDEOCRC_HAVE_AARCH64)
+  if (getauxval (AT_HWCAP) & HWCAP_SHA2) {
+    s->compress = videocrc_sha256_compress_armv8;
+    s->engine = "armv8-sha2";
+  }
+#endif
+}
+
+/* the running state, big-endian like a digest */
+void
+videocrc_sha256_chain_value (const VideocrcSha256 * s, uint8_t * value)
+{
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    value[4 * i] = s->state[i] >> 24;
+    value[4 * i + 1] = s->state[i] >> 16;
+    value[4 * i + 2] = s->state[i] >> 8;
+    value[4 * i + 3] = s->state[i];
+  }
+}
+
+void
+videocrc_sha256_final (const VideocrcSha256 * s, uint8_t * digest)
+{
+  VideocrcSha256 last = *s;
+  uint8_t pad[VIDEOCRC_SHA256_BLOCK] = { 0x80 };
+  uint64_t bits = s->n_blocks * VIDEOCRC_SHA256_BLOCK * 8;
+  int i;
+
+  for (i = 0; i < 8; i++)
+    pad[VIDEOCRC_SHA256_BLOCK - 1 - i] = bits >> (8 * i);
+  videocrc_sha256_block (&last, pad);
+  videocrc_sha256_chain_value (&last, digest);
+}
@@ -0,0 +1,138 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * videocrc-shm-reader: prints the statistics and recent CRC records that a
+ * videocrc element publishes with shm-name=NAME.
+ *
+ *   videocrc-shm-reader [-f] [-n COUNT] NAME
+ *
+ * -f keeps following the ring and prints new records as they are written,
+ * in the same format as the element's CRC log.
+ */
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "videocrc-shm.h"
+
+static void
+usage (const char *argv0)
+{
+  fprintf (stderr, "usage: %s [-f] [-n COUNT] NAME\n", argv0);
+  exit (2);
+}
+
+static void
+print_stats (const VideocrcShmHeader * shm)
+{
+  VideocrcShmStats s;
+
+  if (!videocrc_shm_read_stats (shm, &s)) {
+    fprintf (stderr, "statistics busy, writer may have died\n");
+    return;
+  }
+
+  printf ("pid %" PRId64 " frames %" PRIu64 " bytes %" PRIu64
+      " mean-ns %" PRIu64 " max-ns %" PRIu64 " gbps %.3f last-crc %08X\n",
+      shm->pid, s.frames, s.bytes, s.frames ? s.total_ns / s.frames : 0,
+      s.max_ns, s.hash_ns ? (double) s.bytes / s.hash_ns : 0.0, s.last_crc);
+}
+
+/* print records [from, head) that are still in the ring, returns head */
+static uint64_t
+print_records (const VideocrcShmHeader * shm, uint64_t from)
+{
+  VideocrcShmRecord r;
+  uint64_t head = videocrc_shm_head (shm);
+  uint64_t idx;
+
+  if (head - from > VIDEOCRC_SHM_RING_SIZE) {
+    printf ("# %" PRIu64 " records lost\n",
+        head - from - VIDEOCRC_SHM_RING_SIZE);
+    from = head - VIDEOCRC_SHM_RING_SIZE;
+  }
+
+  for (idx = from; idx < head; idx++) {
+    if (!videocrc_shm_read_record (shm, idx, &r)) {
+      printf ("# record %" PRIu64 " overwritten\n", idx);
+      continue;
+    }
+    if (r.flags & VIDEOCRC_SHM_FLAG_SKIPPED)
+      printf ("VideoFrame %" PRIu64 " skipped\n", r.frame);
+    else if (r.flags & VIDEOCRC_SHM_FLAG_FINGERPRINT)
+      printf ("VideoFrame %" PRIu64 " fingerprint %08X...\n", r.frame, r.crc);
+    else
+      printf ("VideoFrame %" PRIu64 " crc %08X\n", r.frame, r.crc);
+  }
+  fflush (stdout);
+
+  return head;
+}
+
+int
+main (int argc, char **argv)
+{
+  const VideocrcShmHeader *shm;
+  uint64_t count = 16, head, next;
+  int follow = 0;
+  int opt, fd;
+
+  while ((opt = getopt (argc, argv, "fn:")) != -1) {
+    switch (opt) {
+      case 'f':
+        follow = 1;
+        break;
+      case 'n':
+        count = strtoull (optarg, NULL, 0);
+        break;
+      default:
+        usage (argv[0]);
+    }
+  }
+  if (optind != argc - 1)
+    usage (argv[0]);
+
+  fd = shm_open (argv[optind], O_RDONLY, 0);
+  if (fd < 0) {
+    perror (argv[optind]);
+    return 1;
+  }
+  shm = mmap (NULL, sizeof (*shm), PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (shm == MAP_FAILED) {
+    perror ("mmap");
+    return 1;
+  }
+  if (shm->magic != VIDEOCRC_SHM_MAGIC || shm->version != VIDEOCRC_SHM_VERSION
+      || shm->ring_size != VIDEOCRC_SHM_RING_SIZE
+      || shm->record_size != sizeof (VideocrcShmRecord)) {
+    fprintf (stderr, "%s: not a videocrc segment or unsupported version\n",
+        argv[optind]);
+    return 1;
+  }
+
+  print_stats (shm);
+  head = videocrc_shm_head (shm);
+  next = print_records (shm, head > count ? head - count : 0);
+
+  while (follow) {
+    usleep (100000);
+    next = print_records (shm, next);
+  }
+
+  return 0;
+}
@@ -0,0 +1,168 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __VIDEOCRC_SHM_H__
+#define __VIDEOCRC_SHM_H__
+
+/*
+ * Layout of the shared-memory segment published by the videocrc element
+ * when shm-name is set, and read by videocrc-shm-reader or any other
+ * monitor. The segment holds the running statistics and a ring of the most
+ * recent CRC records. There is a single writer, the element's streaming
+ * thread, and any number of readers that never write to the segment.
+ *
+ * Every record and the statistics block carry a sequence number that is
+ * odd while the writer updates them (a seqlock). Record slot i of lap n is
+ * complete when its sequence is 2 * (n * ring_size + i) + 2, so a reader
+ * also detects a slot that was overwritten by a later lap.
+ *
+ * Only fixed-width fields are used and the segment is native-endian; it is
+ * meant for processes on the same host.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VIDEOCRC_SHM_MAGIC      0x43524356u     /* "VCRC" */
+#define VIDEOCRC_SHM_VERSION    1
+#define VIDEOCRC_SHM_RING_SIZE  1024            /* records, power of two */
+#define VIDEOCRC_SHM_NO_PTS     UINT64_MAX
+
+/* record flags */
+#define VIDEOCRC_SHM_FLAG_SKIPPED  (1u << 0)    /* not hashed, crc is 0 */
+#define VIDEOCRC_SHM_FLAG_FINGERPRINT (1u << 1) /* crc holds the first 32
+                                                 * fingerprint bits */
+
+typedef struct
+{
+  uint64_t seq;
+  uint64_t frame;               /* frame number as in the CRC log */
+  uint64_t pts;                 /* ns, VIDEOCRC_SHM_NO_PTS if unknown */
+  uint64_t timestamp;           /* CLOCK_MONOTONIC ns when recorded */
+  uint32_t crc;
+  uint32_t flags;
+} VideocrcShmRecord;
+
+typedef struct
+{
+  uint64_t seq;
+  uint64_t frames;
+  uint64_t bytes;
+  uint64_t total_ns;            /* accumulated per-frame time */
+  uint64_t hash_ns;             /* accumulated CRC time */
+  uint64_t max_ns;
+  uint32_t last_crc;
+  uint32_t reserved;
+} VideocrcShmStats;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t ring_size;
+  uint32_t record_size;
+  int64_t pid;                  /* writer process */
+  uint64_t head;                /* records written so far */
+  VideocrcShmStats stats;
+  VideocrcShmRecord ring[VIDEOCRC_SHM_RING_SIZE];
+} VideocrcShmHeader;
+
+/* writer side, single thread */
+
+static inline void
+videocrc_shm_write_record (VideocrcShmHeader * shm, const VideocrcShmRecord * r)
+{
+  uint64_t idx = shm->head;
+  VideocrcShmRecord *slot = &shm->ring[idx & (VIDEOCRC_SHM_RING_SIZE - 1)];
+
+  __atomic_store_n (&slot->seq, 2 * idx + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+  slot->frame = r->frame;
+  slot->pts = r->pts;
+  slot->timestamp = r->timestamp;
+  slot->crc = r->crc;
+  slot->flags = r->flags;
+  __atomic_store_n (&slot->seq, 2 * idx + 2, __ATOMIC_RELEASE);
+  __atomic_store_n (&shm->head, idx + 1, __ATOMIC_RELEASE);
+}
+
+static inline void
+videocrc_shm_write_stats (VideocrcShmHeader * shm, const VideocrcShmStats * s)
+{
+  uint64_t seq = shm->stats.seq;
+
+  __atomic_store_n (&shm->stats.seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+  shm->stats.frames = s->frames;
+  shm->stats.bytes = s->bytes;
+  shm->stats.total_ns = s->total_ns;
+  shm->stats.hash_ns = s->hash_ns;
+  shm->stats.max_ns = s->max_ns;
+  shm->stats.last_crc = s->last_crc;
+  __atomic_store_n (&shm->stats.seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* reader side, never blocks the writer and never waits for it for long */
+
+static inline uint64_t
+videocrc_shm_head (const VideocrcShmHeader * shm)
+{
+  return __atomic_load_n (&shm->head, __ATOMIC_ACQUIRE);
+}
+
+/* returns 1 and fills @r if record @idx is still in the ring */
+static inline int
+videocrc_shm_read_record (const VideocrcShmHeader * shm, uint64_t idx,
+    VideocrcShmRecord * r)
+{
+  const VideocrcShmRecord *slot =
+      &shm->ring[idx & (VIDEOCRC_SHM_RING_SIZE - 1)];
+  uint64_t seq;
+
+  seq = __atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE);
+  if (seq != 2 * idx + 2)
+    return 0;
+  memcpy (r, slot, sizeof (*r));
+  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+
+  return __atomic_load_n (&slot->seq, __ATOMIC_RELAXED) == seq;
+}
+
+/* returns 0 if no consistent snapshot was seen, e.g. the writer died in
+ * the middle of an update */
+static inline int
+videocrc_shm_read_stats (const VideocrcShmHeader * shm, VideocrcShmStats * s)
+{
+  uint64_t seq;
+  int attempts;
+
+  for (attempts = 0; attempts < 1000; attempts++) {
+    seq = __atomic_load_n (&shm->stats.seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+      continue;
+    memcpy (s, &shm->stats, sizeof (*s));
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    if (__atomic_load_n (&shm->stats.seq, __ATOMIC_RELAXED) == seq)
+      return 1;
+  }
+
+  return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VIDEOCRC_SHM_H__ */
@@ -0,0 +1,84 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __VIDEOCRC_SOCKET_H__
+#define __VIDEOCRC_SOCKET_H__
+
+/*
+ * Packets sent by the videocrc element to a local collector over a
+ * SOCK_SEQPACKET Unix socket when socket-path is set. Each packet is one
+ * VideocrcSockPacket: a header followed by header.count records. The first
+ * packet of a connection is a HELLO carrying the stream name and no records.
+ *
+ * The sender never blocks: when the collector falls behind a whole batch is
+ * dropped, and header.dropped carries the total of records dropped on this
+ * stream so far, so the collector can report gaps.
+ *
+ * Fixed-width fields, native-endian, same-host only.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VIDEOCRC_SOCK_MAGIC      0x53524356u    /* "VCRS" */
+#define VIDEOCRC_SOCK_VERSION    1
+#define VIDEOCRC_SOCK_MAX_BATCH  64
+#define VIDEOCRC_SOCK_NAME_LEN   64
+
+/* record flags */
+#define VIDEOCRC_SOCK_FLAG_SKIPPED  (1u << 0)   /* not hashed, crc is 0 */
+#define VIDEOCRC_SOCK_FLAG_FINGERPRINT (1u << 1) /* crc holds the first 32
+                                                  * fingerprint bits */
+
+typedef enum
+{
+  VIDEOCRC_SOCK_HELLO = 1,
+  VIDEOCRC_SOCK_RECORDS = 2
+} VideocrcSockType;
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t type;                /* VideocrcSockType */
+  uint32_t count;               /* records following the header */
+  uint32_t reserved;
+  int64_t pid;
+  uint64_t dropped;             /* records dropped on this stream so far */
+  char name[VIDEOCRC_SOCK_NAME_LEN];    /* NUL terminated stream name */
+} VideocrcSockHeader;
+
+typedef struct
+{
+  uint64_t frame;
+  uint64_t pts;                 /* ns, UINT64_MAX if unknown */
+  uint64_t timestamp;           /* CLOCK_MONOTONIC ns when recorded */
+  uint32_t crc;
+  uint32_t flags;
+} VideocrcSockRecord;
+
+typedef struct
+{
+  VideocrcSockHeader header;
+  VideocrcSockRecord records[VIDEOCRC_SOCK_MAX_BATCH];
+} VideocrcSockPacket;
+
+#define VIDEOCRC_SOCK_PACKET_SIZE(count) \
+  (sizeof (VideocrcSockHeader) + (count) * sizeof (VideocrcSockRecord))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VIDEOCRC_SOCKET_H__ */
@@ -0,0 +1,260 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+/*
+ * videocrc-store-build: a reference store for the videocrc element's
+ * reference-store property, from the CRC logs of many streams.
+ *
+ *   videocrc-store-build [-k FRAMES] -o STORE LOG...
+ *
+ * Each LOG is a CRC log of the element or of videocrc-file; its stream is
+ * named after the file, less directory and extension. The CRCs of the
+ * first FRAMES frames (8 by default, at most 64) key the stream, so every
+ * stream needs that many and no two may start alike: a stream starting
+ * like one already in the store is left out with a warning, pick a larger
+ * -k. A log is taken up to its first frame without a crc line, skipped or
+ * fingerprinted frames can't be verified against.
+ *
+ * STORE is written next to its final name and renamed over it, so elements
+ * that have the old store mapped keep it until they stop.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "videocrc-store.h"
+
+#define ALIGN(num, to) (((num) + ((to) - 1)) & ~((uint64_t) (to) - 1))
+
+typedef struct
+{
+  char *name;
+  uint32_t *crcs;
+  uint32_t n_frames;
+  uint64_t key;
+} Stream;
+
+static void
+usage (const char *argv0)
+{
+  fprintf (stderr, "usage: %s [-k FRAMES] -o STORE LOG...\n", argv0);
+  exit (2);
+}
+
+static void *
+xrealloc (void *p, size_t size)
+{
+  p = realloc (p, size);
+  if (p == NULL) {
+    fprintf (stderr, "out of memory\n");
+    exit (1);
+  }
+
+  return p;
+}
+
+/* the file name of @path without its extension */
+static char *
+stream_name (const char *path)
+{
+  const char *base = strrchr (path, '/');
+  char *name, *dot;
+
+  name = strdup (base ? base + 1 : path);
+  dot = strrchr (name, '.');
+  if (dot != NULL && dot != name)
+    *dot = '\0';
+
+  return name;
+}
+
+/* the CRCs of frames 1, 2, ... of the log at @path, up to the first gap */
+static int
+read_log (Stream * stream, const char *path)
+{
+  char *line = NULL, kind[16];
+  size_t line_size = 0, allocated = 0;
+  uint32_t frame, crc, gap = 0;
+  int pos;
+  FILE *f;
+
+  f = fopen (path, "r");
+  if (f == NULL) {
+    perror (path);
+    return 0;
+  }
+
+  stream->name = stream_name (path);
+  stream->crcs = NULL;
+  stream->n_frames = 0;
+  while (getline (&line, &line_size, f) > 0) {
+    pos = 0;
+    if (sscanf (line, "VideoFrame %u %15s %n", &frame, kind, &pos) < 2 ||
+        frame == 0 || pos == 0 || strcmp (kind, "crc") != 0 ||
+        sscanf (line + pos, "%X", &crc) != 1)
+      continue;
+    if (frame != stream->n_frames + 1) {
+      if (frame > stream->n_frames + 1 && gap == 0)
+        gap = stream->n_frames + 1;
+      continue;
+    }
+    if (gap != 0)
+      continue;
+    if (stream->n_frames == allocated) {
+      allocated = allocated ? 2 * allocated : 4096;
+      stream->crcs = xrealloc (stream->crcs, allocated * sizeof (uint32_t));
+    }
+    stream->crcs[stream->n_frames++] = crc;
+  }
+  free (line);
+  fclose (f);
+
+  if (gap != 0)
+    fprintf (stderr, "%s: no crc for frame %u, taking the %u frames "
+        "before\n", path, gap, stream->n_frames);
+
+  return 1;
+}
+
+static int
+write_store (const char *path, const Stream * streams, uint32_t n_streams,
+    uint32_t key_frames)
+{
+  VideocrcStoreHeader header;
+  VideocrcStoreStream entry;
+  VideocrcStoreBucket *buckets;
+  uint64_t names_size = 0, first = 0;
+  uint32_t i, b, mask;
+  char *tmp;
+  FILE *f = NULL;
+  int fd, ok;
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, VIDEOCRC_STORE_MAGIC, sizeof (header.magic));
+  header.byte_order = VIDEOCRC_STORE_BYTE_ORDER;
+  header.key_frames = key_frames;
+  header.n_streams = n_streams;
+  for (header.n_buckets = 2; header.n_buckets < 2 * n_streams;)
+    header.n_buckets *= 2;
+  for (i = 0; i < n_streams; i++)
+    header.n_crcs += streams[i].n_frames;
+  header.streams = ALIGN (sizeof (header), 8);
+  header.buckets = header.streams + n_streams * sizeof (entry);
+  header.crcs = header.buckets + header.n_buckets *
+      sizeof (VideocrcStoreBucket);
+  header.names = header.crcs + header.n_crcs * sizeof (uint32_t);
+
+  buckets = calloc (header.n_buckets, sizeof (VideocrcStoreBucket));
+  mask = header.n_buckets - 1;
+  for (i = 0; i < n_streams; i++) {
+    for (b = streams[i].key & mask; buckets[b].stream; b = (b + 1) & mask);
+    buckets[b].key = streams[i].key;
+    buckets[b].stream = i + 1;
+  }
+
+  tmp = xrealloc (NULL, strlen (path) + 8);
+  sprintf (tmp, "%s.XXXXXX", path);
+  fd = mkstemp (tmp);
+  /* every job on the host maps it */
+  if (fd < 0 || fchmod (fd, 0644) != 0 || (f = fdopen (fd, "w")) == NULL) {
+    perror (path);
+    return 0;
+  }
+  ok = fwrite (&header, sizeof (header), 1, f) == 1;
+  ok &= fseek (f, header.streams, SEEK_SET) == 0;
+  for (i = 0; i < n_streams; i++) {
+    entry.first = first;
+    entry.n_frames = streams[i].n_frames;
+    entry.name = names_size;
+    ok &= fwrite (&entry, sizeof (entry), 1, f) == 1;
+    first += streams[i].n_frames;
+    names_size += strlen (streams[i].name) + 1;
+  }
+  ok &= fwrite (buckets, sizeof (VideocrcStoreBucket), header.n_buckets, f)
+      == header.n_buckets;
+  for (i = 0; i < n_streams; i++)
+    ok &= fwrite (streams[i].crcs, sizeof (uint32_t), streams[i].n_frames,
+        f) == streams[i].n_frames;
+  for (i = 0; i < n_streams; i++)
+    ok &= fwrite (streams[i].name, strlen (streams[i].name) + 1, 1, f) == 1;
+  ok &= fclose (f) == 0;
+  free (buckets);
+
+  if (!ok || rename (tmp, path) != 0) {
+    perror (path);
+    unlink (tmp);
+    free (tmp);
+    return 0;
+  }
+  free (tmp);
+
+  printf ("%s: %u streams, %" PRIu64 " frames, key of %u frames, %"
+      PRIu64 " bytes\n", path, n_streams, (uint64_t) header.n_crcs,
+      key_frames, header.names + names_size);
+
+  return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *output = NULL;
+  unsigned long key_frames = 8;
+  Stream *streams;
+  uint32_t n_streams = 0, i;
+  int opt, j;
+
+  while ((opt = getopt (argc, argv, "k:o:")) != -1) {
+    switch (opt) {
+      case 'k':
+        key_frames = strtoul (optarg, NULL, 0);
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      default:
+        usage (argv[0]);
+    }
+  }
+  if (output == NULL || optind == argc || key_frames == 0 ||
+      key_frames > VIDEOCRC_STORE_MAX_KEY)
+    usage (argv[0]);
+
+  streams = xrealloc (NULL, (argc - optind) * sizeof (Stream));
+  for (j = optind; j < argc; j++) {
+    Stream *s = &streams[n_streams];
+
+    if (!read_log (s, argv[j]))
+      return 1;
+    if (s->n_frames < key_frames) {
+      fprintf (stderr, "%s: %u frames, fewer than the key, left out\n",
+          argv[j], s->n_frames);
+      continue;
+    }
+    s->key = videocrc_store_key (s->crcs, key_frames);
+    for (i = 0; i < n_streams; i++)
+      if (streams[i].key == s->key &&
+          memcmp (streams[i].crcs, s->crcs, key_frames * 4) == 0)
+        break;
+    if (i < n_streams) {
+      fprintf (stderr, "%s: starts like %s, left out, try a larger -k\n",
+          argv[j], streams[i].name);
+      continue;
+    }
+    n_streams++;
+  }
+
+  return write_store (output, streams, n_streams, key_frames) ? 0 : 1;
+}
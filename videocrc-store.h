@@ -0,0 +1,88 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __VIDEOCRC_STORE_H__
+#define __VIDEOCRC_STORE_H__
+
+/*
+ * Layout of a reference store, the CRC sequences of many streams written
+ * by videocrc-store-build and mapped read-only by the videocrc element
+ * when reference-store is set. Every process verifying against the store
+ * shares its pages through the page cache.
+ *
+ * A stream is found by a key over the CRCs of its first key_frames frames:
+ * the buckets are an open-addressing table of keys, probed linearly from
+ * key & (n_buckets - 1) up to an empty bucket. The file is
+ *
+ *   header | streams[n_streams] | buckets[n_buckets] | crcs[n_crcs] | names
+ *
+ * with the stream's CRCs from crcs[first], and its name a NUL-terminated
+ * string at names + name. The store is native-endian, byte_order tells a
+ * reader whether it was built on a host like its own.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VIDEOCRC_STORE_MAGIC      "VCRCSTO1"
+#define VIDEOCRC_STORE_BYTE_ORDER 0x01020304u
+#define VIDEOCRC_STORE_MAX_KEY    64            /* frames in a key */
+
+typedef struct
+{
+  char magic[8];                /* VIDEOCRC_STORE_MAGIC, no terminator */
+  uint32_t byte_order;          /* VIDEOCRC_STORE_BYTE_ORDER */
+  uint32_t key_frames;          /* 1 to VIDEOCRC_STORE_MAX_KEY */
+  uint32_t n_streams;
+  uint32_t n_buckets;           /* power of two, more than n_streams */
+  uint64_t streams;             /* offsets of the tables in the file */
+  uint64_t buckets;
+  uint64_t crcs;
+  uint64_t names;
+  uint64_t n_crcs;
+} VideocrcStoreHeader;
+
+typedef struct
+{
+  uint64_t first;               /* index of its first CRC in crcs */
+  uint32_t n_frames;
+  uint32_t name;                /* offset of its name in names */
+} VideocrcStoreStream;
+
+typedef struct
+{
+  uint64_t key;
+  uint32_t stream;              /* index + 1, 0 for an empty bucket */
+  uint32_t reserved;
+} VideocrcStoreBucket;
+
+/* FNV-1a over the little-endian bytes of the first @n CRCs */
+static inline uint64_t
+videocrc_store_key (const uint32_t * crcs, unsigned n)
+{
+  uint64_t key = 0xcbf29ce484222325ull;
+  unsigned i, b;
+
+  for (i = 0; i < n; i++)
+    for (b = 0; b < 32; b += 8)
+      key = (key ^ ((crcs[i] >> b) & 0xFF)) * 0x100000001b3ull;
+
+  return key;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VIDEOCRC_STORE_H__ */
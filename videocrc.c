@@ -0,0 +1,690 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "videocrc.h"
+
+#if defined (__aarch64__) && defined (__linux__) && !defined (__AARCH64EB__)
+#define VIDEOCRC_HAVE_AARCH64 1
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) && !defined (VIDEOCRC_HAVE_AARCH64)
+#include <arm_neon.h>
+#endif
+
+/* bytes of a row summed before the 32-bit square lanes are flushed */
+#define VIDEOCRC_STATS_BLOCK (4096 * 16)
+
+static uint32_t
+videocrc_reflect32 (uint32_t v)
+{
+  uint32_t r = 0;
+  int i;
+
+  for (i = 0; i < 32; i++, v >>= 1)
+    r = (r << 1) | (v & 1);
+
+  return r;
+}
+
+static inline uint32_t
+videocrc_min32 (uint32_t a, uint32_t b)
+{
+  return a < b ? a : b;
+}
+
+static inline uint32_t
+videocrc_load_be32 (const uint8_t * p)
+{
+  return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+      ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline uint32_t
+videocrc_load_le32 (const uint8_t * p)
+{
+  return ((uint32_t) p[3] << 24) | ((uint32_t) p[2] << 16) |
+      ((uint32_t) p[1] << 8) | p[0];
+}
+
+static uint32_t
+videocrc_update_bytewise (const VideocrcKernel * k, uint32_t crc,
+    const uint8_t * data, size_t len)
+{
+  const uint32_t *t = k->table[0];
+  size_t i;
+
+  if (k->reflected) {
+    for (i = 0; i < len; i++)
+      crc = (crc >> 8) ^ t[(crc ^ data[i]) & 0xFF];
+  } else {
+    for (i = 0; i < len; i++)
+      crc = (crc << 8) ^ t[(crc >> 24) ^ data[i]];
+  }
+
+  return crc;
+}
+
+static uint32_t
+videocrc_update_slice8 (const VideocrcKernel * k, uint32_t crc,
+    const uint8_t * data, size_t len)
+{
+  const uint32_t (*t)[256] = k->table;
+  uint32_t a, b;
+
+  if (k->reflected) {
+    for (; len >= 8; len -= 8, data += 8) {
+      a = crc ^ videocrc_load_le32 (data);
+      b = videocrc_load_le32 (data + 4);
+      crc = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^
+          t[5][(a >> 16) & 0xFF] ^ t[4][a >> 24] ^
+          t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF] ^
+          t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+    }
+  } else {
+    for (; len >= 8; len -= 8, data += 8) {
+      a = crc ^ videocrc_load_be32 (data);
+      b = videocrc_load_be32 (data + 4);
+      crc = t[7][a >> 24] ^ t[6][(a >> 16) & 0xFF] ^
+          t[5][(a >> 8) & 0xFF] ^ t[4][a & 0xFF] ^
+          t[3][b >> 24] ^ t[2][(b >> 16) & 0xFF] ^
+          t[1][(b >> 8) & 0xFF] ^ t[0][b & 0xFF];
+    }
+  }
+
+  return videocrc_update_bytewise (k, crc, data, len);
+}
+
+#ifdef VIDEOCRC_HAVE_AARCH64
+/* the instructions are only used after the HWCAP check, so the file is
+ * still built for the baseline architecture */
+#pragma GCC push_options
+#pragma GCC target ("+crc+crypto")
+#include <arm_acle.h>
+#include <arm_neon.h>
+
+/* 16 bytes as a big-endian 128-bit number, lane 0 holding the low half */
+static inline uint64x2_t
+videocrc_load_be128 (const uint8_t * p)
+{
+  uint64x2_t v = vreinterpretq_u64_u8 (vrev64q_u8 (vld1q_u8 (p)));
+
+  return vextq_u64 (v, v, 1);
+}
+
+/* a 128-bit value @x followed by @k_lo's distance of zero bits, reduced to
+ * 128 bits: the high half times x^(d + 64), the low half times x^d */
+static inline uint64x2_t
+videocrc_fold (uint64x2_t x, uint32_t k_hi, uint32_t k_lo)
+{
+  poly128_t hi = vmull_p64 ((poly64_t) vgetq_lane_u64 (x, 1), k_hi);
+  poly128_t lo = vmull_p64 ((poly64_t) vgetq_lane_u64 (x, 0), k_lo);
+
+  return veorq_u64 (vreinterpretq_u64_p128 (hi), vreinterpretq_u64_p128 (lo));
+}
+
+/* MSB-first CRC by folding: four 128-bit accumulators advance 64 bytes per
+ * step, are folded into one, and the last 128 bits go through the tables.
+ * Any polynomial works, the fold constants come from the kernel. */
+static uint32_t
+videocrc_update_pmull (const VideocrcKernel * k, uint32_t crc,
+    const uint8_t * data, size_t len)
+{
+  uint64x2_t x0, x1, x2, x3;
+  uint8_t last[16];
+  uint64_t v;
+  int i;
+
+  if (len < 64)
+    return videocrc_update_slice8 (k, crc, data, len);
+
+  /* the running value enters as the first 32 bits of the message */
+  x0 = veorq_u64 (videocrc_load_be128 (data),
+      vsetq_lane_u64 ((uint64_t) crc << 32, vdupq_n_u64 (0), 1));
+  x1 = videocrc_load_be128 (data + 16);
+  x2 = videocrc_load_be128 (data + 32);
+  x3 = videocrc_load_be128 (data + 48);
+  data += 64;
+  len -= 64;
+
+  for (; len >= 64; len -= 64, data += 64) {
+    x0 = veorq_u64 (videocrc_fold (x0, k->fold[3], k->fold[2]),
+        videocrc_load_be128 (data));
+    x1 = veorq_u64 (videocrc_fold (x1, k->fold[3], k->fold[2]),
+        videocrc_load_be128 (data + 16));
+    x2 = veorq_u64 (videocrc_fold (x2, k->fold[3], k->fold[2]),
+        videocrc_load_be128 (data + 32));
+    x3 = veorq_u64 (videocrc_fold (x3, k->fold[3], k->fold[2]),
+        videocrc_load_be128 (data + 48));
+  }
+
+  x0 = veorq_u64 (videocrc_fold (x0, k->fold[1], k->fold[0]), x1);
+  x0 = veorq_u64 (videocrc_fold (x0, k->fold[1], k->fold[0]), x2);
+  x0 = veorq_u64 (videocrc_fold (x0, k->fold[1], k->fold[0]), x3);
+  for (; len >= 16; len -= 16, data += 16)
+    x0 = veorq_u64 (videocrc_fold (x0, k->fold[1], k->fold[0]),
+        videocrc_load_be128 (data));
+
+  /* the CRC from zero of what is left is the running value */
+  for (i = 0, v = vgetq_lane_u64 (x0, 1); i < 8; i++)
+    last[i] = v >> (56 - 8 * i);
+  for (i = 0, v = vgetq_lane_u64 (x0, 0); i < 8; i++)
+    last[8 + i] = v >> (56 - 8 * i);
+  crc = videocrc_update_slice8 (k, 0, last, sizeof (last));
+
+  return videocrc_update_slice8 (k, crc, data, len);
+}
+
+static uint32_t
+videocrc_update_armv8_crc (const VideocrcKernel * k, uint32_t crc,
+    const uint8_t * data, size_t len)
+{
+  uint64_t v;
+
+  if (k->poly == VIDEOCRC_CRC32C_POLY) {
+    for (; len >= 8; len -= 8, data += 8) {
+      memcpy (&v, data, sizeof (v));
+      crc = __crc32cd (crc, v);
+    }
+    for (; len > 0; len--)
+      crc = __crc32cb (crc, *data++);
+  } else {
+    for (; len >= 8; len -= 8, data += 8) {
+      memcpy (&v, data, sizeof (v));
+      crc = __crc32d (crc, v);
+    }
+    for (; len > 0; len--)
+      crc = __crc32b (crc, *data++);
+  }
+
+  return crc;
+}
+#pragma GCC pop_options
+
+#define VIDEOCRC_PMULL_UPDATE videocrc_update_pmull
+#define VIDEOCRC_PMULL_HWCAP HWCAP_PMULL
+#define VIDEOCRC_ARMV8_CRC_UPDATE videocrc_update_armv8_crc
+#define VIDEOCRC_ARMV8_CRC_HWCAP HWCAP_CRC32
+#else
+#define VIDEOCRC_PMULL_UPDATE NULL
+#define VIDEOCRC_PMULL_HWCAP 0
+#define VIDEOCRC_ARMV8_CRC_UPDATE NULL
+#define VIDEOCRC_ARMV8_CRC_HWCAP 0
+#endif
+
+static int
+videocrc_supports_msb_first (const VideocrcKernel * k)
+{
+  return !k->reflected;
+}
+
+static int
+videocrc_supports_crc32_presets (const VideocrcKernel * k)
+{
+  return k->reflected && (k->poly == VIDEOCRC_CRC32_POLY ||
+      k->poly == VIDEOCRC_CRC32C_POLY);
+}
+
+static const struct
+{
+  const char *name;
+  VideocrcUpdateFunc update;
+  unsigned long hwcap;          /* AT_HWCAP bits the engine needs */
+  int (*supports) (const VideocrcKernel * k);
+} videocrc_engines[VIDEOCRC_ENGINE_LAST] = {
+  { "auto", NULL, 0, NULL },
+  { "bytewise", videocrc_update_bytewise, 0, NULL },
+  { "slice8", videocrc_update_slice8, 0, NULL },
+  { "pmull", VIDEOCRC_PMULL_UPDATE, VIDEOCRC_PMULL_HWCAP,
+      videocrc_supports_msb_first },
+  { "armv8-crc", VIDEOCRC_ARMV8_CRC_UPDATE, VIDEOCRC_ARMV8_CRC_HWCAP,
+      videocrc_supports_crc32_presets },
+};
+
+/* preference of VIDEOCRC_ENGINE_AUTO, the first one the kernel supports */
+static const VideocrcEngine videocrc_auto_engines[] = {
+  VIDEOCRC_ENGINE_ARMV8_CRC,
+  VIDEOCRC_ENGINE_PMULL,
+  VIDEOCRC_ENGINE_SLICE8,
+};
+
+const char *
+videocrc_engine_name (VideocrcEngine engine)
+{
+  if (engine >= VIDEOCRC_ENGINE_LAST)
+    return "unknown";
+
+  return videocrc_engines[engine].name;
+}
+
+VideocrcEngine
+videocrc_engine_from_name (const char *name)
+{
+  int i;
+
+  for (i = 0; name && i < VIDEOCRC_ENGINE_LAST; i++)
+    if (strcmp (name, videocrc_engines[i].name) == 0)
+      return i;
+
+  return VIDEOCRC_ENGINE_AUTO;
+}
+
+int
+videocrc_engine_available (VideocrcEngine engine)
+{
+  if (engine <= VIDEOCRC_ENGINE_AUTO || engine >= VIDEOCRC_ENGINE_LAST ||
+      videocrc_engines[engine].update == NULL)
+    return 0;
+
+#ifdef VIDEOCRC_HAVE_AARCH64
+  if ((getauxval (AT_HWCAP) & videocrc_engines[engine].hwcap) !=
+      videocrc_engines[engine].hwcap)
+    return 0;
+#endif
+
+  return 1;
+}
+
+int
+videocrc_kernel_supports (const VideocrcKernel * k, VideocrcEngine engine)
+{
+  return videocrc_engine_available (engine) &&
+      (videocrc_engines[engine].supports == NULL ||
+      videocrc_engines[engine].supports (k));
+}
+
+void
+videocrc_kernel_set_chunk (VideocrcKernel * k, uint32_t chunk)
+{
+  if (chunk == 0)
+    chunk = VIDEOCRC_DEFAULT_CHUNK;
+  k->chunk = chunk > VIDEOCRC_MAX_CHUNK ? VIDEOCRC_MAX_CHUNK : chunk;
+}
+
+/* a * b mod poly, both in the MSB-first representation */
+static uint32_t
+videocrc_mulmod (uint32_t a, uint32_t b, uint32_t poly)
+{
+  uint32_t r = 0;
+  int i;
+
+  for (i = 31; i >= 0; i--) {
+    r = (r & 0x80000000u) ? (r << 1) ^ poly : r << 1;
+    if (b & (1u << i))
+      r ^= a;
+  }
+
+  return r;
+}
+
+uint32_t
+videocrc_shift (const VideocrcKernel * k, uint32_t crc, uint64_t len)
+{
+  int i;
+
+  /* a reflected register is the mirror image of the MSB-first one */
+  if (k->reflected)
+    crc = videocrc_reflect32 (crc);
+
+  for (i = 0; len; i++, len >>= 1)
+    if (len & 1)
+      crc = videocrc_mulmod (crc, k->shift[i], k->poly);
+
+  return k->reflected ? videocrc_reflect32 (crc) : crc;
+}
+
+void
+videocrc_shift_table_init (const VideocrcKernel * k, VideocrcShiftTable * t,
+    uint64_t len)
+{
+  uint32_t basis[32];
+  unsigned int i, v;
+
+  /* the shift is linear: the XOR of the shifts of the bits that are set */
+  for (i = 0; i < 32; i++)
+    basis[i] = videocrc_shift (k, (uint32_t) 1 << i, len);
+  for (i = 0; i < 4; i++) {
+    t->table[i][0] = 0;
+    for (v = 1; v < 256; v++)
+      t->table[i][v] = t->table[i][v & (v - 1)] ^
+          basis[8 * i + __builtin_ctz (v)];
+  }
+}
+
+/* returns 0 if @engine can't run here or doesn't support the kernel's
+ * polynomial, the kernel keeps its previous engine then */
+int
+videocrc_kernel_set_engine (VideocrcKernel * k, VideocrcEngine engine)
+{
+  unsigned int i;
+
+  for (i = 0; engine == VIDEOCRC_ENGINE_AUTO; i++)
+    if (videocrc_kernel_supports (k, videocrc_auto_engines[i]))
+      engine = videocrc_auto_engines[i];
+
+  if (!videocrc_kernel_supports (k, engine))
+    return 0;
+
+  k->engine = engine;
+  k->update = videocrc_engines[engine].update;
+
+  return 1;
+}
+
+void
+videocrc_kernel_init (VideocrcKernel * k, uint32_t poly, int reflected,
+    VideocrcEngine engine)
+{
+  uint32_t rpoly = videocrc_reflect32 (poly);
+  uint32_t remainder;
+  int i, j;
+
+  k->poly = poly;
+  k->reflected = reflected;
+  k->init = reflected ? 0xFFFFFFFFu : 0;
+
+  for (i = 0; i < 256; i++) {
+    if (reflected) {
+      remainder = i;
+      for (j = 0; j < 8; j++)
+        remainder = (remainder & 1) ? (remainder >> 1) ^ rpoly :
+            remainder >> 1;
+    } else {
+      remainder = (uint32_t) i << 24;
+      for (j = 0; j < 8; j++)
+        remainder = (remainder & 0x80000000u) ? (remainder << 1) ^ poly :
+            remainder << 1;
+    }
+    k->table[0][i] = remainder;
+  }
+
+  for (j = 1; j < 8; j++) {
+    for (i = 0; i < 256; i++) {
+      remainder = k->table[j - 1][i];
+      k->table[j][i] = reflected ?
+          (remainder >> 8) ^ k->table[0][remainder & 0xFF] :
+          (remainder << 8) ^ k->table[0][remainder >> 24];
+    }
+  }
+
+  /* x^8, then square for every further power of two */
+  k->shift[0] = 0x100;
+  for (i = 1; i < 64; i++)
+    k->shift[i] = videocrc_mulmod (k->shift[i - 1], k->shift[i - 1], poly);
+
+  /* distances of the folding engine: x^128 = shift[4], x^512 = shift[6] and
+   * both times x^64 = shift[3] */
+  k->fold[0] = k->shift[4];
+  k->fold[1] = videocrc_mulmod (k->shift[4], k->shift[3], poly);
+  k->fold[2] = k->shift[6];
+  k->fold[3] = videocrc_mulmod (k->shift[6], k->shift[3], poly);
+
+  k->chunk = VIDEOCRC_DEFAULT_CHUNK;
+  k->engine = VIDEOCRC_ENGINE_BYTEWISE;
+  k->update = videocrc_update_bytewise;
+  if (!videocrc_kernel_set_engine (k, engine))
+    videocrc_kernel_set_engine (k, VIDEOCRC_ENGINE_AUTO);
+}
+
+uint32_t
+videocrc_plane_update (const VideocrcKernel * k, uint32_t crc,
+    const VideocrcPlane * plane)
+{
+  uint8_t gather[VIDEOCRC_MAX_CHUNK];
+  const uint8_t *row = plane->data;
+  uint32_t y, x, n, i;
+
+  for (y = 0; y < plane->height; y++, row += plane->stride) {
+    if (plane->step == 1) {
+      crc = k->update (k, crc, row, plane->width);
+      continue;
+    }
+
+    for (x = 0; x < plane->width; x += n) {
+      const uint8_t *src = row + (size_t) x * plane->step;
+
+      n = plane->width - x;
+      if (n > k->chunk)
+        n = k->chunk;
+      for (i = 0; i < n; i++)
+        gather[i] = src[(size_t) i * plane->step];
+      crc = k->update (k, crc, gather, n);
+    }
+  }
+
+  return crc;
+}
+
+static void
+videocrc_row_stats (const uint8_t * p, size_t n, VideocrcLumaStats * stats)
+{
+  uint64_t sum = 0, sum_sq = 0;
+  size_t block, i;
+
+  stats->pixels += n;
+
+#if defined (__SSE2__)
+  for (; n >= 16; n -= block) {
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i s = _mm_setzero_si128 (), sq = _mm_setzero_si128 (), v, lo, hi;
+    uint32_t lanes[4];
+
+    block = n < VIDEOCRC_STATS_BLOCK ? n & ~(size_t) 15 : VIDEOCRC_STATS_BLOCK;
+    for (i = 0; i < block; i += 16, p += 16) {
+      v = _mm_loadu_si128 ((const __m128i *) p);
+      lo = _mm_unpacklo_epi8 (v, zero);
+      hi = _mm_unpackhi_epi8 (v, zero);
+      s = _mm_add_epi64 (s, _mm_sad_epu8 (v, zero));
+      sq = _mm_add_epi32 (sq, _mm_add_epi32 (_mm_madd_epi16 (lo, lo),
+              _mm_madd_epi16 (hi, hi)));
+    }
+    _mm_storeu_si128 ((__m128i *) lanes, sq);
+    sum += (uint32_t) _mm_cvtsi128_si32 (s) +
+        (uint32_t) _mm_cvtsi128_si32 (_mm_srli_si128 (s, 8));
+    sum_sq += (uint64_t) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+#elif defined (__ARM_NEON)
+  for (; n >= 16; n -= block) {
+    uint32x4_t s = vdupq_n_u32 (0), sq = vdupq_n_u32 (0);
+    uint8x16_t v;
+
+    block = n < VIDEOCRC_STATS_BLOCK ? n & ~(size_t) 15 : VIDEOCRC_STATS_BLOCK;
+    for (i = 0; i < block; i += 16, p += 16) {
+      v = vld1q_u8 (p);
+      s = vpadalq_u16 (s, vpaddlq_u8 (v));
+      sq = vpadalq_u16 (sq, vmull_u8 (vget_low_u8 (v), vget_low_u8 (v)));
+      sq = vpadalq_u16 (sq, vmull_u8 (vget_high_u8 (v), vget_high_u8 (v)));
+    }
+    sum += (uint64_t) vgetq_lane_u32 (s, 0) + vgetq_lane_u32 (s, 1) +
+        vgetq_lane_u32 (s, 2) + vgetq_lane_u32 (s, 3);
+    sum_sq += (uint64_t) vgetq_lane_u32 (sq, 0) + vgetq_lane_u32 (sq, 1) +
+        vgetq_lane_u32 (sq, 2) + vgetq_lane_u32 (sq, 3);
+  }
+#endif
+
+  for (; n > 0; n--, p++) {
+    sum += *p;
+    sum_sq += (uint32_t) *p * *p;
+  }
+
+  stats->sum += sum;
+  stats->sum_sq += sum_sq;
+}
+
+uint32_t
+videocrc_plane_update_stats (const VideocrcKernel * k, uint32_t crc,
+    const VideocrcPlane * plane, uint32_t stats_width,
+    VideocrcLumaStats * stats)
+{
+  const uint8_t *row = plane->data;
+  uint32_t y;
+
+  if (stats == NULL || plane->step != 1)
+    return videocrc_plane_update (k, crc, plane);
+
+  stats_width = videocrc_min32 (stats_width, plane->width);
+  for (y = 0; y < plane->height; y++, row += plane->stride) {
+    crc = k->update (k, crc, row, plane->width);
+    videocrc_row_stats (row, stats_width, stats);
+  }
+
+  return crc;
+}
+
+void
+videocrc64_init (VideocrcKernel64 * k)
+{
+  uint64_t poly = 0, c;
+  uint32_t i, j;
+
+  for (i = 0; i < 64; i++)
+    if (VIDEOCRC_CRC64_POLY & ((uint64_t) 1 << i))
+      poly |= (uint64_t) 1 << (63 - i);
+
+  for (i = 0; i < 256; i++) {
+    c = i;
+    for (j = 0; j < 8; j++)
+      c = (c >> 1) ^ ((c & 1) ? poly : 0);
+    k->table[0][i] = c;
+  }
+  for (i = 0; i < 256; i++)
+    for (j = 1; j < 8; j++)
+      k->table[j][i] = (k->table[j - 1][i] >> 8) ^
+          k->table[0][k->table[j - 1][i] & 0xFF];
+}
+
+uint64_t
+videocrc64_update (const VideocrcKernel64 * k, uint64_t crc,
+    const uint8_t * data, size_t len)
+{
+  const uint64_t (*t)[256] = k->table;
+
+  for (; len >= 8; len -= 8, data += 8) {
+    crc ^= videocrc_load_le32 (data) |
+        (uint64_t) videocrc_load_le32 (data + 4) << 32;
+    crc = t[7][crc & 0xFF] ^ t[6][(crc >> 8) & 0xFF] ^
+        t[5][(crc >> 16) & 0xFF] ^ t[4][(crc >> 24) & 0xFF] ^
+        t[3][(crc >> 32) & 0xFF] ^ t[2][(crc >> 40) & 0xFF] ^
+        t[1][(crc >> 48) & 0xFF] ^ t[0][crc >> 56];
+  }
+  for (; len > 0; len--, data++)
+    crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+
+  return crc;
+}
+
+uint32_t
+videocrc_buffer (const VideocrcKernel * k, const uint8_t * data, size_t len)
+{
+  return ~k->update (k, k->init, data, len);
+}
+
+uint32_t
+videocrc_frame (const VideocrcKernel * k, const VideocrcPlane * planes,
+    unsigned int n_planes)
+{
+  uint32_t crc = k->init;
+  unsigned int i;
+
+  for (i = 0; i < n_planes; i++)
+    crc = ~videocrc_plane_update (k, crc, &planes[i]);
+
+  return crc;
+}
+
+void
+videocrc_frames (const VideocrcKernel * k, const VideocrcFrame * frames,
+    size_t n_frames, uint32_t * crcs)
+{
+  size_t i;
+
+  for (i = 0; i < n_frames; i++)
+    crcs[i] = videocrc_frame (k, frames[i].planes, frames[i].n_planes);
+}
+
+unsigned int
+videocrc_nv12_planes (VideocrcPlane * planes, const uint8_t * base,
+    uint32_t width, uint32_t height, uint32_t stride_w, uint32_t stride_h)
+{
+  const uint8_t *chroma = base + (size_t) stride_w * stride_h;
+
+  /* luma is walked in pixel pairs, an odd last column is not hashed */
+  planes[0].data = base;
+  planes[0].stride = stride_w;
+  planes[0].width = width & ~1u;
+  planes[0].height = height;
+  planes[0].step = 1;
+
+  planes[1].data = chroma;
+  planes[1].stride = stride_w;
+  planes[1].width = (width + 1) / 2;
+  planes[1].height = height / 2;
+  planes[1].step = 2;
+
+  planes[2] = planes[1];
+  planes[2].data = chroma + 1;
+
+  return 3;
+}
+
+unsigned int
+videocrc_i420_planes (VideocrcPlane * planes, const uint8_t * base,
+    uint32_t width, uint32_t height, uint32_t stride_y, uint32_t stride_uv)
+{
+  size_t chroma_size = (size_t) stride_uv * ((height + 1) / 2);
+
+  planes[0].data = base;
+  planes[0].stride = stride_y;
+  planes[0].width = width & ~1u;
+  planes[0].height = height;
+  planes[0].step = 1;
+
+  planes[1].data = base + (size_t) stride_y * height;
+  planes[1].stride = stride_uv;
+  planes[1].width = (width + 1) / 2;
+  planes[1].height = height / 2;
+  planes[1].step = 1;
+
+  planes[2] = planes[1];
+  planes[2].data = planes[1].data + chroma_size;
+
+  return 3;
+}
+
+void
+videocrc_planes_crop (VideocrcPlane * planes, unsigned int n_planes,
+    uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+  unsigned int i, shift;
+  uint32_t px, py, pw, ph;
+
+  for (i = 0; i < n_planes; i++) {
+    shift = i > 0;
+    px = videocrc_min32 (x >> shift, planes[i].width);
+    py = videocrc_min32 (y >> shift, planes[i].height);
+    pw = width ? (width + shift) >> shift : planes[i].width;
+    ph = height ? (height + shift) >> shift : planes[i].height;
+
+    planes[i].data += (size_t) py * planes[i].stride +
+        (size_t) px * planes[i].step;
+    planes[i].width = videocrc_min32 (pw, planes[i].width - px);
+    planes[i].height = videocrc_min32 (ph, planes[i].height - py);
+  }
+}
@@ -0,0 +1,312 @@
+/*
+* This file is part of VideoCRC
+*
+* License terms: LGPL V2.1.
+*
+* VideoCRC is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License version 2.1 as
+* published by the Free Software Foundation.
+*
+*/
+
+#ifndef __VIDEOCRC_H__
+#define __VIDEOCRC_H__
+
+/*
+ * libvideocrc: the CRC kernels and plane walks of the videocrc element,
+ * usable without GStreamer.
+ *
+ * A frame CRC follows the element's scheme: start from the kernel's initial
+ * value, run every plane through the CRC in order and invert the running
+ * value after each plane. The legacy NV12 walk hashes the luma rows, then
+ * every Cb sample, then every Cr sample of the interleaved chroma plane.
+ *
+ * All functions are thread safe for a kernel that is not being initialized.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VIDEOCRC_DEFAULT_POLY   0x04C11DB7u
+#define VIDEOCRC_CRC32_POLY     0x04C11DB7u     /* IEEE 802.3, reflected */
+#define VIDEOCRC_CRC32C_POLY    0x1EDC6F41u     /* Castagnoli, reflected */
+#define VIDEOCRC_MAX_PLANES     4
+#define VIDEOCRC_DEFAULT_CHUNK  256     /* bytes gathered per update */
+#define VIDEOCRC_MAX_CHUNK      4096
+
+typedef enum
+{
+  VIDEOCRC_ENGINE_AUTO = 0,     /* fastest engine available */
+  VIDEOCRC_ENGINE_BYTEWISE,     /* one table lookup per byte, reference */
+  VIDEOCRC_ENGINE_SLICE8,       /* eight bytes per step, eight tables */
+  VIDEOCRC_ENGINE_PMULL,        /* AArch64 carry-less multiply folding,
+                                 * any MSB-first polynomial */
+  VIDEOCRC_ENGINE_ARMV8_CRC,    /* AArch64 CRC32 instructions, reflected
+                                 * CRC-32 and CRC-32C only */
+  VIDEOCRC_ENGINE_LAST
+} VideocrcEngine;
+
+typedef struct _VideocrcKernel VideocrcKernel;
+
+typedef uint32_t (*VideocrcUpdateFunc) (const VideocrcKernel * k,
+    uint32_t crc, const uint8_t * data, size_t len);
+
+struct _VideocrcKernel
+{
+  uint32_t poly;                /* normal (MSB-first) representation */
+  int reflected;                /* process bits LSB first */
+  uint32_t init;                /* frame CRCs start from this value */
+  VideocrcEngine engine;
+  VideocrcUpdateFunc update;
+  uint32_t chunk;               /* interleaved samples gathered per update */
+  uint32_t table[8][256];
+  uint32_t shift[64];           /* x^(8 * 2^i) mod poly, for combining */
+  uint32_t fold[4];             /* x^128, x^192, x^512, x^576 mod poly */
+};
+
+/**
+ * VideocrcPlane:
+ * @data: first sample of the plane
+ * @stride: bytes between the starts of two rows
+ * @width: samples per row
+ * @height: rows
+ * @step: bytes between two samples of a row, 1 for planar data and 2 for
+ *   one component of interleaved chroma
+ */
+typedef struct
+{
+  const uint8_t *data;
+  size_t stride;
+  uint32_t width;
+  uint32_t height;
+  uint32_t step;
+} VideocrcPlane;
+
+typedef struct
+{
+  VideocrcPlane planes[VIDEOCRC_MAX_PLANES];
+  unsigned int n_planes;
+} VideocrcFrame;
+
+/* kernels */
+void        videocrc_kernel_init (VideocrcKernel * k, uint32_t poly,
+                                  int reflected, VideocrcEngine engine);
+int         videocrc_kernel_set_engine (VideocrcKernel * k,
+                                        VideocrcEngine engine);
+const char *videocrc_engine_name (VideocrcEngine engine);
+VideocrcEngine videocrc_engine_from_name (const char * name);
+int         videocrc_engine_available (VideocrcEngine engine);
+int         videocrc_kernel_supports (const VideocrcKernel * k,
+                                      VideocrcEngine engine);
+void        videocrc_kernel_set_chunk (VideocrcKernel * k, uint32_t chunk);
+
+/* raw running update, no initial value and no final inversion */
+static inline uint32_t
+videocrc_update (const VideocrcKernel * k, uint32_t crc, const uint8_t * data,
+    size_t len)
+{
+  return k->update (k, crc, data, len);
+}
+
+uint32_t    videocrc_plane_update (const VideocrcKernel * k, uint32_t crc,
+                                   const VideocrcPlane * plane);
+
+/* luma sums gathered while hashing, for black frame detection */
+typedef struct
+{
+  uint64_t sum;
+  uint64_t sum_sq;
+  uint64_t pixels;
+} VideocrcLumaStats;
+
+/* videocrc_plane_update () that also adds the first @stats_width samples of
+ * every row to @stats right after the row is hashed, while it is still in
+ * the L1 cache; @plane must have step 1, @stats may be NULL */
+uint32_t    videocrc_plane_update_stats (const VideocrcKernel * k,
+                                         uint32_t crc,
+                                         const VideocrcPlane * plane,
+                                         uint32_t stats_width,
+                                         VideocrcLumaStats * stats);
+
+/* running value after @len zero bytes; since the CRC is linear,
+ * update (crc, A + B) == shift (update (crc, A), |B|) ^ update (0, B), which
+ * lets independent parts of a stream be hashed separately and joined */
+uint32_t    videocrc_shift (const VideocrcKernel * k, uint32_t crc,
+                            uint64_t len);
+
+static inline uint32_t
+videocrc_combine (const VideocrcKernel * k, uint32_t crc_a, uint32_t crc0_b,
+    uint64_t len_b)
+{
+  return videocrc_shift (k, crc_a, len_b) ^ crc0_b;
+}
+
+/* videocrc_shift () by a length known in advance, in four table lookups
+ * instead of a multiplication per bit of the length */
+typedef struct
+{
+  uint32_t table[4][256];
+} VideocrcShiftTable;
+
+void        videocrc_shift_table_init (const VideocrcKernel * k,
+                                       VideocrcShiftTable * t, uint64_t len);
+
+static inline uint32_t
+videocrc_shift_apply (const VideocrcShiftTable * t, uint32_t crc)
+{
+  return t->table[0][crc & 0xFF] ^ t->table[1][(crc >> 8) & 0xFF] ^
+      t->table[2][(crc >> 16) & 0xFF] ^ t->table[3][crc >> 24];
+}
+
+/* a band of @rows rows of @plane starting at @row */
+static inline VideocrcPlane
+videocrc_plane_band (const VideocrcPlane * plane, uint32_t row, uint32_t rows)
+{
+  VideocrcPlane band = *plane;
+
+  band.data = plane->data + (size_t) row * plane->stride;
+  band.height = rows;
+
+  return band;
+}
+
+/* single-frame, plane-descriptor and batch entry points */
+uint32_t    videocrc_buffer (const VideocrcKernel * k, const uint8_t * data,
+                             size_t len);
+uint32_t    videocrc_frame (const VideocrcKernel * k,
+                            const VideocrcPlane * planes,
+                            unsigned int n_planes);
+void        videocrc_frames (const VideocrcKernel * k,
+                             const VideocrcFrame * frames, size_t n_frames,
+                             uint32_t * crcs);
+
+/* describe the legacy NV12 walk of a frame at @base, chroma starts at
+ * stride_w * stride_h; returns the number of planes (3) */
+unsigned int videocrc_nv12_planes (VideocrcPlane * planes,
+                                   const uint8_t * base, uint32_t width,
+                                   uint32_t height, uint32_t stride_w,
+                                   uint32_t stride_h);
+
+/* the same walk over planar 4:2:0 (I420/YV12 order as stored) */
+unsigned int videocrc_i420_planes (VideocrcPlane * planes,
+                                   const uint8_t * base, uint32_t width,
+                                   uint32_t height, uint32_t stride_y,
+                                   uint32_t stride_uv);
+
+/* perceptual fingerprints of a luma plane, see videocrc-fingerprint.c */
+#define VIDEOCRC_FINGERPRINT_GRID       32
+#define VIDEOCRC_FINGERPRINT_MAX_BITS   256
+#define VIDEOCRC_FINGERPRINT_STRLEN     (VIDEOCRC_FINGERPRINT_MAX_BITS / 4 + 1)
+
+typedef struct
+{
+  uint64_t bits[VIDEOCRC_FINGERPRINT_MAX_BITS / 64];
+  unsigned int n_bits;          /* 64 or 256 */
+} VideocrcFingerprint;
+
+void        videocrc_fingerprint (const VideocrcPlane * luma,
+                                  unsigned int n_bits,
+                                  VideocrcFingerprint * fp);
+unsigned int videocrc_fingerprint_distance (const VideocrcFingerprint * a,
+                                            const VideocrcFingerprint * b);
+/* upper case hex, @str holds VIDEOCRC_FINGERPRINT_STRLEN bytes */
+void        videocrc_fingerprint_to_string (const VideocrcFingerprint * fp,
+                                            char * str);
+/* parses 16 or 64 hex digits, returns 0 on anything else */
+int         videocrc_fingerprint_from_string (VideocrcFingerprint * fp,
+                                              const char * str);
+
+/* restrict a 4:2:0 walk to the luma rectangle at (@x, @y), the chroma
+ * planes following at half resolution; a @width or @height of 0 extends to
+ * the edge and the rectangle is clipped to the planes */
+void        videocrc_planes_crop (VideocrcPlane * planes,
+                                  unsigned int n_planes, uint32_t x,
+                                  uint32_t y, uint32_t width,
+                                  uint32_t height);
+
+/* CRC-64/XZ: ECMA-182 polynomial, reflected, slice-by-8 tables */
+#define VIDEOCRC_CRC64_POLY 0x42F0E1EBA9EA3693ULL
+
+typedef struct
+{
+  uint64_t table[8][256];
+} VideocrcKernel64;
+
+void        videocrc64_init (VideocrcKernel64 * k);
+
+/* raw running update like videocrc_update (); CRC-64/XZ starts from ~0 and
+ * is inverted at the end */
+uint64_t    videocrc64_update (const VideocrcKernel64 * k, uint64_t crc,
+                               const uint8_t * data, size_t len);
+
+/* SHA-256 one 64-byte block at a time, see videocrc-sha256.c */
+#define VIDEOCRC_SHA256_BLOCK   64
+#define VIDEOCRC_SHA256_LEN     32
+
+typedef struct
+{
+  uint32_t state[8];
+  uint64_t n_blocks;
+  void (*compress) (uint32_t * state, const uint8_t * block);
+  const char *engine;           /* "sha-ni", "armv8-sha2" or "c" */
+} VideocrcSha256;
+
+void        videocrc_sha256_init (VideocrcSha256 * s);
+
+static inline void
+videocrc_sha256_block (VideocrcSha256 * s, const uint8_t * block)
+{
+  s->compress (s->state, block);
+  s->n_blocks++;
+}
+
+/* the state after the blocks so far, VIDEOCRC_SHA256_LEN bytes */
+void        videocrc_sha256_chain_value (const VideocrcSha256 * s,
+                                         uint8_t * value);
+/* SHA-256 of the blocks so far, @s can take more blocks afterwards */
+void        videocrc_sha256_final (const VideocrcSha256 * s,
+                                   uint8_t * digest);
+
+/* units of encoded elementary streams, see videocrc-nal.c */
+typedef enum
+{
+  VIDEOCRC_CODEC_NONE,
+  VIDEOCRC_CODEC_H264,          /* Annex B byte-stream */
+  VIDEOCRC_CODEC_H265,          /* Annex B byte-stream */
+  VIDEOCRC_CODEC_AV1            /* low-overhead OBU stream */
+} VideocrcCodec;
+
+typedef enum
+{
+  VIDEOCRC_UNIT_OTHER,
+  VIDEOCRC_UNIT_SEI,            /* SEI, AV1 metadata */
+  VIDEOCRC_UNIT_AUD             /* access unit or temporal delimiter */
+} VideocrcUnitKind;
+
+typedef struct
+{
+  size_t offset;                /* of the NAL or OBU header */
+  size_t size;                  /* without start code and trailing zeros */
+  unsigned int type;            /* nal_unit_type or obu_type */
+  VideocrcUnitKind kind;
+  uint32_t crc;                 /* of the unit alone, like videocrc_buffer */
+} VideocrcUnit;
+
+/* offset of the first 00 00 01 in @data, @len if there is none */
+size_t      videocrc_find_start_code (const uint8_t * data, size_t len);
+
+/* hashes the first unit at or after @pos into @unit and returns where the
+ * next one may start, 0 when there is none */
+size_t      videocrc_unit_next (const VideocrcKernel * k, VideocrcCodec codec,
+                                const uint8_t * data, size_t size,
+                                size_t pos, VideocrcUnit * unit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VIDEOCRC_H__ */